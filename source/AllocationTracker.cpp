@@ -0,0 +1,121 @@
+#include "AllocationTracker.h"
+#include "Macros.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace dae
+{
+    namespace
+    {
+        constexpr uint32_t SHARD_COUNT{64};
+
+        struct alignas(64) AllocationShard
+        {
+            std::atomic<uint64_t> allocationCount {0};
+            std::atomic<uint64_t> allocatedBytes  {0};
+        };
+
+        //Constant initialized, operator new can run before any dynamic initializer
+        constinit AllocationShard g_AllocationShards[SHARD_COUNT] {};
+
+        [[maybe_unused]] void CountAllocation(std::size_t size)
+        {
+            static constinit std::atomic<uint32_t> nextIdx{0};
+            thread_local const uint32_t shardIdx{nextIdx.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT};
+
+            AllocationShard& shard{g_AllocationShards[shardIdx]};
+            shard.allocationCount.fetch_add(1, std::memory_order_relaxed);
+            shard.allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        }
+    }
+
+    namespace AllocationTracker
+    {
+        bool IsEnabled()
+        {
+            return ALLOCATION_TRACKING;
+        }
+
+        uint64_t GetAllocationCount()
+        {
+            uint64_t total{0};
+            for (const AllocationShard& shard : g_AllocationShards)
+            {
+                total += shard.allocationCount.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        uint64_t GetAllocatedBytes()
+        {
+            uint64_t total{0};
+            for (const AllocationShard& shard : g_AllocationShards)
+            {
+                total += shard.allocatedBytes.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+    }
+}
+
+#if ALLOCATION_TRACKING
+#pragma region Global Operator New
+//The nothrow and sized forms of the standard library forward to these
+void* operator new(std::size_t size)
+{
+    dae::CountAllocation(size);
+    if (void* pMemory{std::malloc(size == 0 ? 1 : size)}) return pMemory;
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    dae::CountAllocation(size);
+    const std::size_t alignmentBytes{static_cast<std::size_t>(alignment)};
+    //aligned_alloc wants a multiple of the alignment
+    const std::size_t alignedSize{(size + alignmentBytes - 1) / alignmentBytes * alignmentBytes};
+#ifdef _MSC_VER
+    if (void* pMemory{_aligned_malloc(alignedSize == 0 ? alignmentBytes : alignedSize, alignmentBytes)}) return pMemory;
+#else
+    if (void* pMemory{std::aligned_alloc(alignmentBytes, alignedSize == 0 ? alignmentBytes : alignedSize)}) return pMemory;
+#endif
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return ::operator new(size, alignment);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete(void* pMemory, std::align_val_t) noexcept
+{
+#ifdef _MSC_VER
+    _aligned_free(pMemory);
+#else
+    std::free(pMemory);
+#endif
+}
+
+void operator delete[](void* pMemory, std::align_val_t alignment) noexcept
+{
+    ::operator delete(pMemory, alignment);
+}
+#pragma endregion
+#endif
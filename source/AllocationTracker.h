@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace dae
+{
+    /**
+     * \brief Heap allocations made through the global operator new since the program started, see ALLOCATION_TRACKING \n
+     * Every thread counts on its own cache line, the getters sum all of them, so a frame's count is the difference of two reads
+     */
+    namespace AllocationTracker
+    {
+        /**
+         * \brief false if ALLOCATION_TRACKING is off, the counts then always stay 0
+         */
+        bool IsEnabled();
+
+        uint64_t GetAllocationCount();
+        uint64_t GetAllocatedBytes();
+    }
+}
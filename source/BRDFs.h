@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Math.h"
+#include "SIMD.h"
 
 #include <algorithm>
 
@@ -107,5 +108,74 @@ namespace dae
             const float k{numeratorSq / 8.0f};
             return GeometryFunction_SchlickGGX(n, v, k) * GeometryFunction_SchlickGGX(n, l, k);
         }
+
+        //WIDE BRDFs
+        //==========
+        //The same BRDFs for Float4 or Float8 lanes over SoA batches (or float, one lane), see ShadeBatch
+        //Every lane evaluates the expressions of the scalar version in the same order, only Phong swaps std::powf for FastPow
+
+        template <typename FloatN>
+        ColorRGBN<FloatN> Lambert(FloatN kd, const ColorRGBN<FloatN>& cd)
+        {
+            return cd * kd / FloatN{PI};
+        }
+
+        template <typename FloatN>
+        ColorRGBN<FloatN> Lambert(const ColorRGBN<FloatN>& kd, const ColorRGBN<FloatN>& cd)
+        {
+            return kd * cd / FloatN{PI};
+        }
+
+        /**
+         * \return Phong Specular, the same in every colour channel
+         */
+        template <typename FloatN>
+        FloatN Phong(FloatN ks, FloatN exp, const Vector3N<FloatN>& l, const Vector3N<FloatN>& v, const Vector3N<FloatN>& n)
+        {
+            const Vector3N<FloatN> r{Vector3N<FloatN>::Reflect(l, n)};
+            const FloatN cosAlpha{Max(FloatN{0.0f}, Vector3N<FloatN>::Dot(r, -v))};
+            return ks * FastPow(cosAlpha, exp);
+        }
+
+        template <typename FloatN>
+        ColorRGBN<FloatN> FresnelFunction_Schlick(const Vector3N<FloatN>& h, const Vector3N<FloatN>& v, const ColorRGBN<FloatN>& f0)
+        {
+            const FloatN temp{FloatN{1.0f} - Vector3N<FloatN>::Dot(h, v)};
+            const FloatN tempQuintic{temp * temp * temp * temp * temp};
+            return {
+                f0.r + (FloatN{1.0f} - f0.r) * tempQuintic,
+                f0.g + (FloatN{1.0f} - f0.g) * tempQuintic,
+                f0.b + (FloatN{1.0f} - f0.b) * tempQuintic
+            };
+        }
+
+        template <typename FloatN>
+        FloatN NormalDistribution_GGX(const Vector3N<FloatN>& n, const Vector3N<FloatN>& h, FloatN roughness)
+        {
+            const FloatN alpha{roughness * roughness};
+            const FloatN alphaSq{alpha * alpha};
+            const FloatN nDotH{Vector3N<FloatN>::Dot(n, h)};
+            const FloatN nDotHSq{nDotH * nDotH};
+            const FloatN temp{nDotHSq * (alphaSq - FloatN{1.0f}) + FloatN{1.0f}};
+            const FloatN tempSq{temp * temp};
+            return alphaSq / (FloatN{PI} * tempSq);
+        }
+
+        template <typename FloatN>
+        FloatN GeometryFunction_SchlickGGX(const Vector3N<FloatN>& n, const Vector3N<FloatN>& v, FloatN roughness)
+        {
+            const FloatN viewAngle{Max(FloatN{0.0f}, Vector3N<FloatN>::Dot(n, v))};
+            return viewAngle / (viewAngle * (FloatN{1.0f} - roughness) + roughness);
+        }
+
+        template <typename FloatN>
+        FloatN GeometryFunction_Smith(const Vector3N<FloatN>& n, const Vector3N<FloatN>& v, const Vector3N<FloatN>& l, FloatN roughness)
+        {
+            const FloatN alpha{roughness * roughness};
+            const FloatN numerator{alpha + FloatN{1.0f}};
+            const FloatN numeratorSq{numerator * numerator};
+            const FloatN k{numeratorSq / FloatN{8.0f}};
+            return GeometryFunction_SchlickGGX(n, v, k) * GeometryFunction_SchlickGGX(n, l, k);
+        }
     }
 }
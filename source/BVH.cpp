@@ -0,0 +1,307 @@
+#include "BVH.h"
+
+#include "Macros.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <utility>
+
+namespace dae
+{
+    namespace
+    {
+        constexpr int BIN_COUNT{16};
+
+        //Below this amount of nodes a tree level is refit on the calling thread
+        constexpr uint32_t PARALLEL_REFIT_THRESHOLD{1024};
+
+        struct Bin
+        {
+            AABB     bounds    {};
+            uint32_t primCount {0};
+        };
+    }
+
+    void BVH::Build(const std::vector<AABB>& primBounds)
+    {
+        Clear();
+
+        const uint32_t primCount{static_cast<uint32_t>(primBounds.size())};
+        if (primCount == 0) return;
+
+        primIndices.resize(primCount);
+        std::iota(primIndices.begin(), primIndices.end(), 0);
+
+        //A binary tree with N leaves never has more than 2N - 1 nodes
+        nodes.reserve(primCount * 2 - 1);
+
+        BVHNode root{};
+        root.leftFirst = 0;
+        root.primCount = primCount;
+        nodes.push_back(root);
+
+        UpdateNodeBounds(0, primBounds);
+        Subdivide(0, primBounds);
+
+        CalculateRefitOrder();
+        m_BuildCost = CalculateSAHCost();
+    }
+
+    void BVH::Assign(const BVHNode* pNodes, size_t nodeCount, const uint32_t* pPrimIndices, size_t primCount)
+    {
+        Clear();
+        if (nodeCount == 0) return;
+
+        nodes.assign(pNodes, pNodes + nodeCount);
+        primIndices.assign(pPrimIndices, pPrimIndices + primCount);
+
+        CalculateRefitOrder();
+        m_BuildCost = CalculateSAHCost();
+    }
+
+    void BVH::Refit(const std::vector<AABB>& primBounds)
+    {
+        const auto refitNode = [this, &primBounds](uint32_t nodeIdx)
+        {
+            BVHNode& node{nodes[nodeIdx]};
+            if (node.IsLeaf())
+            {
+                UpdateNodeBounds(nodeIdx, primBounds);
+                return;
+            }
+
+            const BVHNode& leftChild{nodes[node.leftFirst]};
+            const BVHNode& rightChild{nodes[node.leftFirst + 1]};
+            node.minAABB = Vector3::Min(leftChild.minAABB, rightChild.minAABB);
+            node.maxAABB = Vector3::Max(leftChild.maxAABB, rightChild.maxAABB);
+        };
+
+        for (size_t level{0}; level + 1 < m_LevelOffsets.size(); ++level)
+        {
+            const auto first{m_RefitOrder.begin() + m_LevelOffsets[level]};
+            const auto last{m_RefitOrder.begin() + m_LevelOffsets[level + 1]};
+#if MULTITHREADING
+            if (m_LevelOffsets[level + 1] - m_LevelOffsets[level] >= PARALLEL_REFIT_THRESHOLD)
+            {
+                std::for_each(std::execution::par, first, last, refitNode);
+                continue;
+            }
+#endif
+            std::for_each(first, last, refitNode);
+        }
+    }
+
+    bool BVH::Update(const std::vector<AABB>& primBounds)
+    {
+        if (IsEmpty() or primIndices.size() != primBounds.size())
+        {
+            Build(primBounds);
+            return true;
+        }
+
+        Refit(primBounds);
+        if (CalculateSAHCost() > m_BuildCost * maxRefitCostRatio)
+        {
+            Build(primBounds);
+            return true;
+        }
+        return false;
+    }
+
+    void BVH::Clear()
+    {
+        nodes.clear();
+        primIndices.clear();
+        m_RefitOrder.clear();
+        m_LevelOffsets.clear();
+        m_BuildCost = 0.0f;
+    }
+
+    float BVH::CalculateSAHCost() const
+    {
+        if (IsEmpty()) return 0.0f;
+
+        float cost{0.0f};
+        for (const BVHNode& node : nodes)
+        {
+            const AABB bounds{node.minAABB, node.maxAABB};
+            cost += bounds.GetArea() * (node.IsLeaf() ? GetBatchCount(node.primCount) : 1.0f);
+        }
+
+        const AABB rootBounds{nodes[0].minAABB, nodes[0].maxAABB};
+        const float rootArea{rootBounds.GetArea()};
+        return rootArea > 0.0f ? cost / rootArea : cost;
+    }
+
+    void BVH::CalculateRefitOrder()
+    {
+        //Breadth-first walk, then reverse the levels so the deepest one is refit first
+        std::vector<std::vector<uint32_t>> levels{{0}};
+        while (true)
+        {
+            std::vector<uint32_t> nextLevel{};
+            for (const uint32_t nodeIdx : levels.back())
+            {
+                if (nodes[nodeIdx].IsLeaf()) continue;
+                nextLevel.push_back(nodes[nodeIdx].leftFirst);
+                nextLevel.push_back(nodes[nodeIdx].leftFirst + 1);
+            }
+            if (nextLevel.empty()) break;
+            levels.push_back(std::move(nextLevel));
+        }
+
+        m_RefitOrder.clear();
+        m_RefitOrder.reserve(nodes.size());
+        m_LevelOffsets.clear();
+        m_LevelOffsets.reserve(levels.size() + 1);
+        for (auto level{levels.rbegin()}; level != levels.rend(); ++level)
+        {
+            m_LevelOffsets.push_back(static_cast<uint32_t>(m_RefitOrder.size()));
+            m_RefitOrder.insert(m_RefitOrder.end(), level->begin(), level->end());
+        }
+        m_LevelOffsets.push_back(static_cast<uint32_t>(m_RefitOrder.size()));
+    }
+
+    void BVH::UpdateNodeBounds(uint32_t nodeIdx, const std::vector<AABB>& primBounds)
+    {
+        BVHNode& node{nodes[nodeIdx]};
+
+        AABB bounds{};
+        for (uint32_t idx{node.leftFirst}; idx < node.leftFirst + node.primCount; ++idx)
+        {
+            bounds.Grow(primBounds[primIndices[idx]]);
+        }
+
+        node.minAABB = bounds.min;
+        node.maxAABB = bounds.max;
+    }
+
+    float BVH::FindBestSplit(const BVHNode& node, const std::vector<AABB>& primBounds, int& axis, float& splitPos) const
+    {
+        //Bin the centroids instead of the bounds, a primitive always ends up on exactly one side
+        AABB centroidBounds{};
+        for (uint32_t idx{node.leftFirst}; idx < node.leftFirst + node.primCount; ++idx)
+        {
+            centroidBounds.Grow(primBounds[primIndices[idx]].GetCentroid());
+        }
+
+        float bestCost{FLT_MAX};
+        for (int a{0}; a < 3; ++a)
+        {
+            const float boundsMin{centroidBounds.min[a]};
+            const float boundsMax{centroidBounds.max[a]};
+            if (boundsMin == boundsMax) continue;
+
+            Bin bins[BIN_COUNT]{};
+            const float scale{static_cast<float>(BIN_COUNT) / (boundsMax - boundsMin)};
+            for (uint32_t idx{node.leftFirst}; idx < node.leftFirst + node.primCount; ++idx)
+            {
+                const AABB& bounds{primBounds[primIndices[idx]]};
+                const int binIdx{
+                    std::min(BIN_COUNT - 1, static_cast<int>((bounds.GetCentroid()[a] - boundsMin) * scale))
+                };
+                ++bins[binIdx].primCount;
+                bins[binIdx].bounds.Grow(bounds);
+            }
+
+            //Sweep from both sides to get the area and count left/right of every plane between two bins
+            float leftArea[BIN_COUNT - 1]{}, rightArea[BIN_COUNT - 1]{};
+            uint32_t leftCount[BIN_COUNT - 1]{}, rightCount[BIN_COUNT - 1]{};
+            AABB leftBounds{}, rightBounds{};
+            uint32_t leftSum{0}, rightSum{0};
+            for (int idx{0}; idx < BIN_COUNT - 1; ++idx)
+            {
+                leftSum += bins[idx].primCount;
+                leftCount[idx] = leftSum;
+                leftBounds.Grow(bins[idx].bounds);
+                leftArea[idx] = leftBounds.GetArea();
+
+                rightSum += bins[BIN_COUNT - 1 - idx].primCount;
+                rightCount[BIN_COUNT - 2 - idx] = rightSum;
+                rightBounds.Grow(bins[BIN_COUNT - 1 - idx].bounds);
+                rightArea[BIN_COUNT - 2 - idx] = rightBounds.GetArea();
+            }
+
+            for (int idx{0}; idx < BIN_COUNT - 1; ++idx)
+            {
+                if (leftCount[idx] == 0 or rightCount[idx] == 0) continue;
+
+                const float cost{
+                    GetBatchCount(leftCount[idx]) * leftArea[idx] +
+                    GetBatchCount(rightCount[idx]) * rightArea[idx]
+                };
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    axis = a;
+                    splitPos = boundsMin + static_cast<float>(idx + 1) / scale;
+                }
+            }
+        }
+        return bestCost;
+    }
+
+    void BVH::Subdivide(uint32_t rootIdx, const std::vector<AABB>& primBounds)
+    {
+        //Node index and its depth below the root
+        std::vector<std::pair<uint32_t, uint32_t>> stack{{rootIdx, 0}};
+        while (not stack.empty())
+        {
+            const auto [nodeIdx, depth]{stack.back()};
+            stack.pop_back();
+
+            const BVHNode node{nodes[nodeIdx]};
+            if (node.primCount <= leafBatchSize or depth >= maxDepth) continue;
+
+            int axis{0};
+            float splitPos{0.0f};
+            const float splitCost{FindBestSplit(node, primBounds, axis, splitPos)};
+
+            AABB nodeBounds{node.minAABB, node.maxAABB};
+            const float leafCost{GetBatchCount(node.primCount) * nodeBounds.GetArea()};
+            if (splitCost >= leafCost) continue;
+
+            //In-place partition of the primitive indices around the split plane
+            uint32_t i{node.leftFirst};
+            uint32_t j{node.leftFirst + node.primCount - 1};
+            while (i <= j)
+            {
+                if (primBounds[primIndices[i]].GetCentroid()[axis] < splitPos)
+                {
+                    ++i;
+                }
+                else
+                {
+                    std::swap(primIndices[i], primIndices[j]);
+                    if (j == 0) break;
+                    --j;
+                }
+            }
+
+            const uint32_t leftCount{i - node.leftFirst};
+            if (leftCount == 0 or leftCount == node.primCount) continue;
+
+            const uint32_t leftIdx{static_cast<uint32_t>(nodes.size())};
+
+            BVHNode leftChild{};
+            leftChild.leftFirst = node.leftFirst;
+            leftChild.primCount = leftCount;
+            nodes.push_back(leftChild);
+
+            BVHNode rightChild{};
+            rightChild.leftFirst = i;
+            rightChild.primCount = node.primCount - leftCount;
+            nodes.push_back(rightChild);
+
+            nodes[nodeIdx].leftFirst = leftIdx;
+            nodes[nodeIdx].primCount = 0;
+
+            UpdateNodeBounds(leftIdx, primBounds);
+            UpdateNodeBounds(leftIdx + 1, primBounds);
+
+            stack.push_back({leftIdx + 1, depth + 1});
+            stack.push_back({leftIdx, depth + 1});
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "Math.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+    struct AABB
+    {
+        Vector3 min {FLT_MAX, FLT_MAX, FLT_MAX};
+        Vector3 max {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+        void Grow(const Vector3& point)
+        {
+            min = Vector3::Min(min, point);
+            max = Vector3::Max(max, point);
+        }
+
+        void Grow(const AABB& other)
+        {
+            min = Vector3::Min(min, other.min);
+            max = Vector3::Max(max, other.max);
+        }
+
+        Vector3 GetCentroid() const
+        {
+            return (min + max) * 0.5f;
+        }
+
+        /**
+         * \brief Half of the surface area, the factor 2 cancels out in the SAH cost ratios
+         */
+        float GetArea() const
+        {
+            const Vector3 extent{max - min};
+            return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+        }
+
+        /**
+         * \brief Bounds of the 8 transformed corners, a conservative fit for rotated boxes
+         */
+        AABB Transformed(const Matrix& transform) const
+        {
+            AABB bounds{};
+            for (int corner{0}; corner < 8; ++corner)
+            {
+                const Vector3 point{
+                    corner & 1 ? max.x : min.x,
+                    corner & 2 ? max.y : min.y,
+                    corner & 4 ? max.z : min.z
+                };
+                bounds.Grow(transform.TransformPoint(point));
+            }
+            return bounds;
+        }
+    };
+
+    /**
+     * \brief 32 byte node, two of them fit in a cache line \n
+     * Inner node: leftFirst is the index of the left child, the right child is always stored right after it \n
+     * Leaf node: leftFirst is the first entry in primIndices, primCount is the number of primitives
+     */
+    struct BVHNode
+    {
+        Vector3  minAABB   {};
+        uint32_t leftFirst {0};
+        Vector3  maxAABB   {};
+        uint32_t primCount {0};
+
+        bool IsLeaf() const { return primCount > 0; }
+    };
+
+    /**
+     * \brief Bounding volume hierarchy built with the binned surface area heuristic \n
+     * Nodes are stored depth-first in a flat array, the root is always at index 0
+     */
+    class BVH final
+    {
+    public:
+        /**
+         * \brief Deepest level a leaf may end up on, the traversal stacks are sized after it \n
+         * A node on depth d never has more than d far children pending, so nodes on this depth are not split any further
+         */
+        static constexpr uint32_t maxDepth{64};
+
+        std::vector<BVHNode>  nodes       {};
+        std::vector<uint32_t> primIndices {};
+
+        /**
+         * \brief Refit is only trusted while the SAH cost stays below buildCost * maxRefitCostRatio
+         */
+        float maxRefitCostRatio {1.5f};
+
+        /**
+         * \brief Amount of primitives the leaf kernels test at once \n
+         * Nodes that fit in one batch are never split, and the SAH counts leaf cost in batches instead of primitives
+         */
+        uint32_t leafBatchSize {1};
+
+        void Build(const std::vector<AABB>& primBounds);
+
+        /**
+         * \brief Takes over a freshly built tree, e.g. one read back from a mesh cache, instead of building it again
+         */
+        void Assign(const BVHNode* pNodes, size_t nodeCount, const uint32_t* pPrimIndices, size_t primCount);
+
+        /**
+         * \brief Keeps the topology and recomputes the node bounds bottom-up, one tree level at a time
+         */
+        void Refit(const std::vector<AABB>& primBounds);
+
+        /**
+         * \brief Refits for moving primitives, falls back to a full build when the tree quality degraded too much
+         * \return true if the tree was rebuilt, so the topology and primIndices changed
+         */
+        bool Update(const std::vector<AABB>& primBounds);
+        void Clear();
+
+        /**
+         * \brief Expected cost of a ray that hits the root: sum of (area * cost) over all nodes, relative to the root area
+         */
+        float CalculateSAHCost() const;
+
+        bool IsEmpty() const { return nodes.empty(); }
+
+    private:
+        float m_BuildCost {0.0f};
+
+        //Node indices grouped per depth, deepest level first: every level only depends on the previous one
+        std::vector<uint32_t> m_RefitOrder   {};
+        std::vector<uint32_t> m_LevelOffsets {};
+
+        void UpdateNodeBounds(uint32_t nodeIdx, const std::vector<AABB>& primBounds);
+        float FindBestSplit(const BVHNode& node, const std::vector<AABB>& primBounds, int& axis, float& splitPos) const;
+        void Subdivide(uint32_t rootIdx, const std::vector<AABB>& primBounds);
+        void CalculateRefitOrder();
+
+        float GetBatchCount(uint32_t primCount) const
+        {
+            return static_cast<float>((primCount + leafBatchSize - 1) / leafBatchSize);
+        }
+    };
+}
@@ -0,0 +1,249 @@
+#include "Benchmark.h"
+
+#include "AllocationTracker.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "Timer.h"
+#include "Macros.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
+namespace dae
+{
+    namespace
+    {
+        //Nearest-rank percentile of an ascending list
+        float GetPercentile(const std::vector<float>& sortedValues, float percentile)
+        {
+            const size_t rank{static_cast<size_t>(std::ceil(percentile / 100.0f * static_cast<float>(sortedValues.size())))};
+            return sortedValues[std::clamp<size_t>(rank, 1, sortedValues.size()) - 1];
+        }
+    }
+
+    Benchmark::Benchmark(const BenchmarkSettings& settings) :
+        m_Settings(settings)
+    {
+        m_Settings.frames = std::max(1, m_Settings.frames);
+
+        //Week 4 is the reference scene of the window mode, the other weeks go through their own renderers
+        const auto dynamicRender = [](Renderer& renderer, Scene* pScene) { renderer.DyanmicRender(pScene); };
+        const auto render = [](Renderer& renderer, Scene* pScene) { renderer.Render(pScene); };
+
+        m_Scenes = {
+            {"W1", [] { return new Scene_W1(); }, dynamicRender},
+            {"W2", [] { return new Scene_W2(); }, dynamicRender},
+            {"W3", [] { return new Scene_W3(); }, dynamicRender},
+            {"W4", [] { return new Scene_W4(); }, render},
+            {"W5", [] { return new Scene_W5(); }, dynamicRender},
+            {"SphereGrid", [] { return new Scene_SphereGrid(); }, render},
+            {"InstanceGrid", [] { return new Scene_InstanceGrid(); }, render}
+        };
+    }
+
+    bool Benchmark::Run()
+    {
+        Renderer renderer{m_Settings.width, m_Settings.height};
+        renderer.SetThreadCount(m_Settings.threads);
+        renderer.SetTileSize(m_Settings.tileSize);
+
+        //Every frame has to be traced in full, accumulation would skip the work once a static view converged
+        renderer.SetAccumulation(false);
+        renderer.SetGBufferReuse(false);
+
+        //Report what actually ran: 0 threads means all of them, odd tile sizes get rounded up
+        m_Settings.threads = renderer.GetThreadCount();
+        m_Settings.tileSize = renderer.GetTileSize();
+
+        std::cout << "**BENCHMARK STARTED** " << m_Settings.width << 'x' << m_Settings.height << ", "
+            << m_Settings.frames << " frames (+" << m_Settings.warmupFrames << " warmup), "
+            << renderer.GetThreadCount() << " thread(s), " << renderer.GetTileSize() << 'x' << renderer.GetTileSize()
+            << " tiles\n";
+
+        m_Results.clear();
+        for (const BenchmarkScene& benchmarkScene : m_Scenes)
+        {
+            m_Results.push_back(RunScene(benchmarkScene, renderer));
+            PrintResult(m_Results.back());
+        }
+
+        const bool isWritten{WriteJSON()};
+        if (isWritten)
+            std::cout << "**BENCHMARK FINISHED** Report saved to " << m_Settings.jsonPath << std::endl;
+        else
+            std::cout << "**BENCHMARK FINISHED** Something went wrong. Report not saved to " << m_Settings.jsonPath << std::endl;
+
+        //Steady-state frames must not touch the heap, the warmup frames may still grow the buffers
+        bool isAllocationFree{true};
+        for (const BenchmarkResult& result : m_Results)
+        {
+            if (result.allocatingFrames == 0) continue;
+
+            std::cout << "Something went wrong. " << result.name << ": " << result.allocatingFrames << " of " << m_Settings.frames
+                << " measured frames allocated (" << result.allocations << " allocations, " << result.allocatedBytes << " bytes)" << std::endl;
+            isAllocationFree = false;
+        }
+        return isWritten and isAllocationFree;
+    }
+
+    BenchmarkResult Benchmark::RunScene(const BenchmarkScene& benchmarkScene, Renderer& renderer) const
+    {
+        Scene* pScene{benchmarkScene.createScene()};
+        pScene->Initialize();
+        pScene->GetCamera().SetInputEnabled(false);
+
+        Timer timer{};
+        timer.SetFixedTimeStep(m_Settings.timeStep);
+        timer.Start();
+
+        BenchmarkResult result{};
+        result.name = benchmarkScene.name;
+        result.frameTimesMs.reserve(m_Settings.frames);
+
+        for (int frame{0}; frame < m_Settings.warmupFrames + m_Settings.frames; ++frame)
+        {
+            if (frame == m_Settings.warmupFrames) pScene->ResetRayStats();
+
+            const uint64_t startAllocations{AllocationTracker::GetAllocationCount()};
+            const uint64_t startBytes{AllocationTracker::GetAllocatedBytes()};
+
+            const auto start{std::chrono::steady_clock::now()};
+            pScene->Update(&timer);
+            benchmarkScene.render(renderer, pScene);
+            const auto end{std::chrono::steady_clock::now()};
+
+            const uint64_t frameAllocations{AllocationTracker::GetAllocationCount() - startAllocations};
+            const uint64_t frameBytes{AllocationTracker::GetAllocatedBytes() - startBytes};
+
+            if (frame >= m_Settings.warmupFrames)
+            {
+                result.frameTimesMs.push_back(std::chrono::duration<float, std::milli>(end - start).count());
+
+                result.allocations += frameAllocations;
+                result.allocatedBytes += frameBytes;
+                result.maxFrameAllocations = std::max(result.maxFrameAllocations, frameAllocations);
+                if (frameAllocations != 0) ++result.allocatingFrames;
+            }
+            timer.Update();
+        }
+
+        result.primaryRays = pScene->GetRayStats().primaryRays.Get();
+        result.shadowRays = pScene->GetRayStats().shadowRays.Get();
+        result.occludedRays = pScene->GetRayStats().occludedRays.Get();
+        result.occluderCacheHits = pScene->GetRayStats().occluderCacheHits.Get();
+        delete pScene;
+
+        std::vector<float> sortedTimes{result.frameTimesMs};
+        std::sort(sortedTimes.begin(), sortedTimes.end());
+        const float totalMs{std::accumulate(sortedTimes.begin(), sortedTimes.end(), 0.0f)};
+
+        result.minMs = sortedTimes.front();
+        result.medianMs = GetPercentile(sortedTimes, 50.0f);
+        result.p95Ms = GetPercentile(sortedTimes, 95.0f);
+        result.p99Ms = GetPercentile(sortedTimes, 99.0f);
+        result.maxMs = sortedTimes.back();
+        result.avgMs = totalMs / static_cast<float>(sortedTimes.size());
+        if (totalMs > 0.0f)
+        {
+            result.raysPerSecond = static_cast<double>(result.primaryRays + result.shadowRays) / (totalMs / 1000.0);
+        }
+        return result;
+    }
+
+    void Benchmark::PrintResult(const BenchmarkResult& result) const
+    {
+        std::cout << std::left << std::setw(14) << result.name << std::right << std::fixed << std::setprecision(2)
+            << " min " << std::setw(8) << result.minMs
+            << " median " << std::setw(8) << result.medianMs
+            << " p95 " << std::setw(8) << result.p95Ms
+            << " p99 " << std::setw(8) << result.p99Ms << " ms"
+            << " | " << std::setprecision(2) << result.raysPerSecond / 1'000'000.0 << " Mrays/s"
+            << " (" << result.primaryRays << " primary, " << result.shadowRays << " shadow)";
+        if (OCCLUDER_CACHE and result.occludedRays > 0)
+        {
+            std::cout << " | " << std::setprecision(1)
+                << 100.0 * static_cast<double>(result.occluderCacheHits) / static_cast<double>(result.occludedRays) << "% occluder cache hits";
+        }
+        if (AllocationTracker::IsEnabled())
+        {
+            std::cout << " | " << static_cast<double>(result.allocations) / static_cast<double>(result.frameTimesMs.size())
+                << " allocs/frame (max " << result.maxFrameAllocations << ')';
+        }
+        std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+
+    bool Benchmark::WriteJSON() const
+    {
+        std::ofstream file{m_Settings.jsonPath};
+        if (not file) return false;
+
+        //Build switches that change the results, so two reports can only be compared when they match
+        const std::pair<const char*, int> features[]{
+            {"MULTITHREADING", MULTITHREADING},
+            {"BVH_MESH", BVH_MESH},
+            {"TRIANGLE_BLOCKS", TRIANGLE_BLOCKS},
+            {"BVH_SCENE", BVH_SCENE},
+            {"SOA_GEOMETRY", SOA_GEOMETRY},
+            {"PLANE_ROOM", PLANE_ROOM},
+            {"PACKET_TRACING", PACKET_TRACING},
+            {"OCCLUDER_CACHE", OCCLUDER_CACHE},
+            {"RAY_STATS", RAY_STATS},
+            {"ALLOCATION_TRACKING", ALLOCATION_TRACKING}
+        };
+
+        file << "{\n";
+        file << "  \"settings\": {\n";
+        file << "    \"width\": " << m_Settings.width << ",\n";
+        file << "    \"height\": " << m_Settings.height << ",\n";
+        file << "    \"frames\": " << m_Settings.frames << ",\n";
+        file << "    \"warmupFrames\": " << m_Settings.warmupFrames << ",\n";
+        file << "    \"threads\": " << m_Settings.threads << ",\n";
+        file << "    \"tileSize\": " << m_Settings.tileSize << ",\n";
+        file << "    \"timeStep\": " << m_Settings.timeStep << ",\n";
+        file << "    \"features\": {";
+        for (size_t idx{0}; idx < std::size(features); ++idx)
+        {
+            file << (idx == 0 ? "" : ", ") << '"' << features[idx].first << "\": " << features[idx].second;
+        }
+        file << "}\n";
+        file << "  },\n";
+
+        file << "  \"scenes\": [\n";
+        for (size_t idx{0}; idx < m_Results.size(); ++idx)
+        {
+            const BenchmarkResult& result{m_Results[idx]};
+            file << "    {\n";
+            file << "      \"name\": \"" << result.name << "\",\n";
+            file << "      \"frameTimeMs\": {\"min\": " << result.minMs << ", \"median\": " << result.medianMs
+                << ", \"p95\": " << result.p95Ms << ", \"p99\": " << result.p99Ms << ", \"max\": " << result.maxMs
+                << ", \"avg\": " << result.avgMs << "},\n";
+            file << "      \"primaryRays\": " << result.primaryRays << ",\n";
+            file << "      \"shadowRays\": " << result.shadowRays << ",\n";
+            file << "      \"occludedRays\": " << result.occludedRays << ",\n";
+            file << "      \"occluderCacheHits\": " << result.occluderCacheHits << ",\n";
+            file << "      \"raysPerSecond\": " << std::fixed << std::setprecision(0) << result.raysPerSecond
+                << std::defaultfloat << std::setprecision(6) << ",\n";
+            if (AllocationTracker::IsEnabled())
+            {
+                file << "      \"allocations\": {\"total\": " << result.allocations << ", \"bytes\": " << result.allocatedBytes
+                    << ", \"maxPerFrame\": " << result.maxFrameAllocations << ", \"allocatingFrames\": " << result.allocatingFrames << "},\n";
+            }
+            file << "      \"frames\": [";
+            for (size_t frame{0}; frame < result.frameTimesMs.size(); ++frame)
+            {
+                file << (frame == 0 ? "" : ", ") << result.frameTimesMs[frame];
+            }
+            file << "]\n";
+            file << "    }" << (idx + 1 < m_Results.size() ? "," : "") << '\n';
+        }
+        file << "  ]\n";
+        file << "}\n";
+
+        return static_cast<bool>(file);
+    }
+}
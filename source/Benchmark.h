@@ -0,0 +1,97 @@
+#pragma once
+
+#include "TileScheduler.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+    class Renderer;
+    class Scene;
+
+    struct BenchmarkSettings
+    {
+        int         width        {640};
+        int         height       {480};
+        int         frames       {60};
+        int         warmupFrames {5};
+        uint32_t    threads      {0};
+        int         tileSize     {TileScheduler::DEFAULT_TILE_SIZE};
+        float       timeStep     {1.0f / 60.0f};
+        std::string jsonPath     {"benchmark.json"};
+    };
+
+    /**
+     * \brief Frame time statistics of one scene, times in milliseconds, rays and allocations counted over the measured frames only
+     */
+    struct BenchmarkResult
+    {
+        std::string name {};
+
+        float minMs    {0.0f};
+        float medianMs {0.0f};
+        float p95Ms    {0.0f};
+        float p99Ms    {0.0f};
+        float maxMs    {0.0f};
+        float avgMs    {0.0f};
+
+        uint64_t primaryRays   {0};
+        uint64_t shadowRays    {0};
+        double   raysPerSecond {0.0};
+
+        //Shadow rays that got blocked, and those of them the cached occluder of their light blocked, see OCCLUDER_CACHE
+        uint64_t occludedRays      {0};
+        uint64_t occluderCacheHits {0};
+
+        //Heap allocations of the measured frames, only counted with ALLOCATION_TRACKING
+        uint64_t allocations         {0};
+        uint64_t allocatedBytes      {0};
+        uint64_t maxFrameAllocations {0};
+        int      allocatingFrames    {0};
+
+        std::vector<float> frameTimesMs {};
+    };
+
+    /**
+     * \brief Renders every week scene and the synthetic benchmark scenes headless, with a fixed camera and time step \n
+     * A frame is Scene::Update plus the render, the warmup frames are rendered but not measured
+     */
+    class Benchmark final
+    {
+    public:
+        explicit Benchmark(const BenchmarkSettings& settings);
+        ~Benchmark() = default;
+
+        Benchmark(const Benchmark&) = delete;
+        Benchmark(Benchmark&&) noexcept = delete;
+        Benchmark& operator=(const Benchmark&) = delete;
+        Benchmark& operator=(Benchmark&&) noexcept = delete;
+
+        /**
+         * \brief Runs all scenes, prints a summary and writes the JSON report
+         * \return true if the report was written and, with ALLOCATION_TRACKING, no measured frame allocated
+         */
+        bool Run();
+
+        const std::vector<BenchmarkResult>& GetResults() const { return m_Results; }
+
+    private:
+        struct BenchmarkScene
+        {
+            std::string                            name        {};
+            std::function<Scene*()>                createScene {};
+            std::function<void(Renderer&, Scene*)> render      {};
+        };
+
+        BenchmarkSettings            m_Settings {};
+        std::vector<BenchmarkScene>  m_Scenes   {};
+        std::vector<BenchmarkResult> m_Results  {};
+
+        BenchmarkResult RunScene(const BenchmarkScene& benchmarkScene, Renderer& renderer) const;
+        void PrintResult(const BenchmarkResult& result) const;
+        bool WriteJSON() const;
+    };
+}
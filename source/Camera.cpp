@@ -27,6 +27,8 @@ namespace dae
 
     void Camera::Update(Timer* pTimer)
     {
+        if (not m_InputEnabled) return;
+
         const float deltaTime = pTimer->GetElapsed();
 
         //Keyboard Input
@@ -72,6 +74,11 @@ namespace dae
         totalYaw = yaw;
     }
 
+    void Camera::SetInputEnabled(bool isEnabled)
+    {
+        m_InputEnabled = isEnabled;
+    }
+
     float Camera::CalculateFOV(float angle) const
     {
         const float halfAlpha{(angle * 0.5f) * TO_RADIANS};
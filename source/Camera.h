@@ -26,6 +26,11 @@ namespace dae
         void SetTotalPitch(float pitch);
         void SetTotalYaw(float yaw);
 
+        /**
+         * \brief Headless renders turn this off, Update then never touches the SDL keyboard and mouse state
+         */
+        void SetInputEnabled(bool isEnabled);
+
     private:
         float CalculateFOV(float angle) const;
         void MoveCamera(const uint8_t* pKeyboardState, float deltaTime);
@@ -45,5 +50,6 @@ namespace dae
         float  speed         {10.0f};
         float  rotationSpeed {100.0f};
         float  m_ScrollSpeed {0.5f};
+        bool   m_InputEnabled {true};
     };
 }
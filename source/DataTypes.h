@@ -1,7 +1,11 @@
 #pragma once
 
 #include "Math.h"
+#include "BVH.h"
+#include "Macros.h"
 
+#include <algorithm>
+#include <execution>
 #include <vector>
 
 namespace dae
@@ -23,6 +27,19 @@ namespace dae
         unsigned char materialIndex{0};
     };
 
+    /**
+     * \brief The planes of the scene as the walls of one axis-aligned box, see PLANE_ROOM \n
+     * The [axis][0] wall faces +axis, the [axis][1] wall faces -axis, sides without a plane stay open
+     */
+    struct Room
+    {
+        float bounds[3][2]{};
+        //Into the plane vector of the scene, -1 for an open side
+        int planeIndices[3][2]{{-1, -1}, {-1, -1}, {-1, -1}};
+
+        bool isValid{false};
+    };
+
     enum class TriangleCullMode
     {
         FrontFaceCulling,
@@ -57,6 +74,21 @@ namespace dae
         unsigned char materialIndex {0};
     };
 
+    /**
+     * \brief Up to 8 mesh triangles in SoA layout, ready for Moller-Trumbore: v0 and the edges e1 = v1 - v0, e2 = v2 - v0 \n
+     * Every array is one 32 byte AVX2 register, unused lanes have zero edges and never hit
+     */
+    struct alignas(32) TriangleBlock
+    {
+        static constexpr uint32_t size{8};
+
+        float v0x[size]; float v0y[size]; float v0z[size];
+        float e1x[size]; float e1y[size]; float e1z[size];
+        float e2x[size]; float e2y[size]; float e2z[size];
+
+        uint32_t triangleIndices[size];
+    };
+
     struct TriangleMesh
     {
         TriangleMesh() = default;
@@ -102,6 +134,13 @@ namespace dae
         Vector3 transformedMinAABB {};
         Vector3 transformedMaxAABB {};
 
+        BVH               bvh            {};
+        std::vector<AABB> triangleBounds {};
+
+        //Every BVH leaf owns the blocks [leafFirstBlock[nodeIdx], + ceil(primCount / 8)), see TRIANGLE_BLOCKS
+        std::vector<TriangleBlock> triangleBlocks {};
+        std::vector<uint32_t>      leafFirstBlock {};
+
         void Translate(const Vector3& translation)
         {
             translationTransform = Matrix::CreateTranslation(translation);
@@ -157,6 +196,18 @@ namespace dae
         void UpdateTransforms()
         {
             const auto finalTransform{scaleTransform * rotationTransform * translationTransform};
+#if MULTITHREADING
+            std::transform(std::execution::par, positions.begin(), positions.end(), transformedPositions.begin(),
+                           [&finalTransform](const Vector3& position)
+                           {
+                               return finalTransform.TransformPoint(position);
+                           });
+            std::transform(std::execution::par, normals.begin(), normals.end(), transformedNormals.begin(),
+                           [&finalTransform](const Vector3& normal)
+                           {
+                               return finalTransform.TransformVector(normal).Normalized();
+                           });
+#else
             for (size_t idx{0}; idx < positions.size(); ++idx)
             {
                 transformedPositions[idx] = finalTransform.TransformPoint(positions[idx]);
@@ -165,7 +216,113 @@ namespace dae
             {
                 transformedNormals[idx] = finalTransform.TransformVector(normals[idx]).Normalized();
             }
+#endif
             UpdateTransformedAABB(finalTransform);
+#if BVH_MESH
+            UpdateBVH(transformedPositions);
+#if TRIANGLE_BLOCKS
+            UpdateTriangleBlocks(transformedPositions);
+#endif
+#endif
+        }
+
+        /**
+         * \brief World space bounds of the transformed triangles
+         */
+        AABB GetTransformedBounds() const
+        {
+            if (not bvh.IsEmpty()) return {bvh.nodes[0].minAABB, bvh.nodes[0].maxAABB};
+
+            AABB bounds{};
+            for (const auto& position : transformedPositions)
+            {
+                bounds.Grow(position);
+            }
+            return bounds;
+        }
+
+        /**
+         * \brief Refits the BVH to the given vertices, the BVH itself decides when a full rebuild is needed \n
+         * World space meshes pass transformedPositions, meshes shared by instances pass the object space positions
+         */
+        void UpdateBVH(const std::vector<Vector3>& vertices)
+        {
+#if TRIANGLE_BLOCKS
+            bvh.leafBatchSize = TriangleBlock::size;
+#endif
+            triangleBounds.resize(indices.size() / 3);
+
+            const auto calculateBounds = [this, &vertices](uint32_t triangleIdx)
+            {
+                AABB bounds{};
+                bounds.Grow(vertices[indices[triangleIdx * 3]]);
+                bounds.Grow(vertices[indices[triangleIdx * 3 + 1]]);
+                bounds.Grow(vertices[indices[triangleIdx * 3 + 2]]);
+                triangleBounds[triangleIdx] = bounds;
+            };
+
+#if MULTITHREADING
+            //The BVH references every triangle exactly once, so its index list doubles as the iteration range
+            if (bvh.primIndices.size() == triangleBounds.size())
+            {
+                std::for_each(std::execution::par, bvh.primIndices.begin(), bvh.primIndices.end(), calculateBounds);
+            }
+            else
+#endif
+            {
+                for (uint32_t idx{0}; idx < triangleBounds.size(); ++idx)
+                {
+                    calculateBounds(idx);
+                }
+            }
+
+            bvh.Update(triangleBounds);
+        }
+
+        /**
+         * \brief Gathers the triangles of every BVH leaf into blocks, in the leaf order of the current tree
+         */
+        void UpdateTriangleBlocks(const std::vector<Vector3>& vertices)
+        {
+            uint32_t blockCount{0};
+            leafFirstBlock.resize(bvh.nodes.size());
+            for (uint32_t nodeIdx{0}; nodeIdx < bvh.nodes.size(); ++nodeIdx)
+            {
+                const BVHNode& node{bvh.nodes[nodeIdx]};
+                if (not node.IsLeaf()) continue;
+
+                leafFirstBlock[nodeIdx] = blockCount;
+                blockCount += (node.primCount + TriangleBlock::size - 1) / TriangleBlock::size;
+            }
+            triangleBlocks.assign(blockCount, TriangleBlock{});
+
+            const auto fillLeaf = [this, &vertices](const BVHNode& node)
+            {
+                if (not node.IsLeaf()) return;
+
+                const size_t nodeIdx{static_cast<size_t>(&node - bvh.nodes.data())};
+
+                for (uint32_t idx{0}; idx < node.primCount; ++idx)
+                {
+                    const uint32_t triangleIdx{bvh.primIndices[node.leftFirst + idx]};
+                    const Vector3& v0{vertices[indices[triangleIdx * 3]]};
+                    const Vector3 e1{vertices[indices[triangleIdx * 3 + 1]] - v0};
+                    const Vector3 e2{vertices[indices[triangleIdx * 3 + 2]] - v0};
+
+                    TriangleBlock& block{triangleBlocks[leafFirstBlock[nodeIdx] + idx / TriangleBlock::size]};
+                    const uint32_t lane{idx % TriangleBlock::size};
+                    block.v0x[lane] = v0.x; block.v0y[lane] = v0.y; block.v0z[lane] = v0.z;
+                    block.e1x[lane] = e1.x; block.e1y[lane] = e1.y; block.e1z[lane] = e1.z;
+                    block.e2x[lane] = e2.x; block.e2y[lane] = e2.y; block.e2z[lane] = e2.z;
+                    block.triangleIndices[lane] = triangleIdx;
+                }
+            };
+
+#if MULTITHREADING
+            std::for_each(std::execution::par, bvh.nodes.begin(), bvh.nodes.end(), fillLeaf);
+#else
+            std::for_each(bvh.nodes.begin(), bvh.nodes.end(), fillLeaf);
+#endif
         }
 
         void UpdateAABB()
@@ -218,6 +375,69 @@ namespace dae
             transformedMaxAABB = tMaxAABB;
         }
     };
+
+    /**
+     * \brief Placement of a shared TriangleMesh, the mesh itself stays in object space \n
+     * Rays are transformed into object space at hit-test time, so moving an instance never touches its vertices or BVH
+     */
+    struct MeshInstance
+    {
+        uint32_t meshIndex {0};
+
+        unsigned char materialIndex {0};
+
+        Matrix transform        {};
+        Matrix inverseTransform {};
+
+        AABB objectBounds {};
+        AABB bounds       {};
+
+        void SetTransform(const Matrix& _transform)
+        {
+            transform        = _transform;
+            inverseTransform = Matrix::Inverse(_transform);
+            bounds           = objectBounds.Transformed(transform);
+        }
+
+        /**
+         * \brief Normals transform with the inverse transpose, which keeps them perpendicular under non-uniform scale
+         */
+        Vector3 TransformNormal(const Vector3& normal) const
+        {
+            return Vector3{
+                Vector3::Dot(Vector3{inverseTransform[0]}, normal),
+                Vector3::Dot(Vector3{inverseTransform[1]}, normal),
+                Vector3::Dot(Vector3{inverseTransform[2]}, normal)
+            }.Normalized();
+        }
+    };
+#pragma endregion
+#pragma region MATERIAL
+    enum class MaterialType : uint8_t
+    {
+        SolidColor,
+        Lambert,
+        LambertPhong,
+        CookTorrence
+    };
+
+    /**
+     * \brief Plain copy of a material's parameters, tagged with its type, see Scene::GetMaterialTable \n
+     * The wavefront shading stage reads these instead of calling Shade, fields a type does not use stay at their defaults
+     */
+    struct MaterialData
+    {
+        MaterialType type                {MaterialType::SolidColor};
+        ColorRGB     color               {colors::White}; //SolidColor color, Lambert(Phong) diffuse color, CookTorrence albedo
+        float        diffuseReflectance  {1.0f};          //kd
+        float        specularReflectance {0.0f};          //ks
+        float        phongExponent       {1.0f};
+        float        metalness           {0.0f};
+        float        roughness           {1.0f};
+        ColorRGB     f0                  {};
+    };
+
+    constexpr int MATERIAL_TYPE_COUNT{static_cast<int>(MaterialType::CookTorrence) + 1};
 #pragma endregion
 #pragma region LIGHT
     enum class LightType
@@ -236,23 +456,68 @@ namespace dae
     };
 #pragma endregion
 #pragma region MISC
-    struct Ray
+    /**
+     * \brief Kind of primitive a hit belongs to, the top-level acceleration structure never holds planes
+     */
+    enum class PrimitiveType : uint8_t
+    {
+        Sphere,
+        TriangleMesh,
+        MeshInstance,
+        Plane
+    };
+
+    /**
+     * \brief Entry of the top-level acceleration structure, points into the geometry vector of its type
+     */
+    struct PrimitiveRef
+    {
+        PrimitiveType type  {};
+        uint32_t      index {0};
+    };
+
+    /**
+     * \brief Two 16 byte rows, origin + min and direction + max, so each row loads into one SSE register (see RayPacket)
+     */
+    struct alignas(16) Ray
     {
+        Ray() = default;
+
+        Ray(const Vector3& _origin, const Vector3& _direction, float _min = 0.0001f, float _max = FLT_MAX) :
+            origin{_origin}, min{_min}, direction{_direction}, max{_max}
+        {
+        }
+
         Vector3 origin    {};
+        float   min       {0.0001f};
         Vector3 direction {};
+        float   max       {FLT_MAX};
+    };
 
-        float min {0.0001f};
-        float max {FLT_MAX};
+    /**
+     * \brief What the traversal keeps of the closest hit so far: how far and which primitive \n
+     * Hit point, normal and material are only derived once, for the final winner, see Scene::ResolveHit
+     */
+    struct PrimitiveHit
+    {
+        float         t            {FLT_MAX};
+        uint32_t      primitiveIdx {0}; //Into the geometry vector of its type
+        uint32_t      triangleIdx  {0}; //Meshes and mesh instances only
+        PrimitiveType type         {};
+        bool          didHit       {false};
     };
 
-    struct HitRecord
+    /**
+     * \brief Two 16 byte rows like Ray: origin + t and normal + material
+     */
+    struct alignas(16) HitRecord
     {
         Vector3 origin {};
+        float   t      {FLT_MAX};
         Vector3 normal {};
-        float t {FLT_MAX};
 
-        bool didHit {false};
         unsigned char materialIndex {0};
+        bool          didHit        {false};
     };
 #pragma endregion
 }
@@ -0,0 +1,331 @@
+#pragma once
+
+#include "Math.h"
+#include "DataTypes.h"
+
+#include <bit>
+#include <immintrin.h>
+#include <vector>
+
+namespace dae
+{
+    /**
+     * \brief Amount of primitives tested by one AVX2 instruction
+     */
+    constexpr uint32_t SOA_WIDTH{8};
+
+#pragma region Storage
+    /**
+     * \brief Lane mask of the primitives in block that exist, the arrays are padded so a whole block can always be loaded
+     */
+    inline __m256 GetValidMaskSoA(uint32_t count, uint32_t block)
+    {
+        const __m256i remaining{_mm256_set1_epi32(static_cast<int>(count - block * SOA_WIDTH))};
+        return _mm256_castsi256_ps(_mm256_cmpgt_epi32(remaining, _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    }
+
+    /**
+     * \brief Spheres in structure-of-arrays layout, every component is contiguous so 8 spheres load with one instruction \n
+     * The slots can be in any order, e.g. grouped per TLAS leaf, sphereIndices maps them back to the sphere vector
+     */
+    struct SphereSoA
+    {
+        std::vector<float>         originX         {};
+        std::vector<float>         originY         {};
+        std::vector<float>         originZ         {};
+        std::vector<float>         radius          {};
+        std::vector<unsigned char> materialIndices {};
+        std::vector<uint32_t>      sphereIndices   {};
+
+        uint32_t count {0};
+
+        void Build(const std::vector<Sphere>& spheres)
+        {
+            std::vector<uint32_t> order(spheres.size());
+            for (uint32_t idx{0}; idx < order.size(); ++idx) order[idx] = idx;
+            Build(spheres, order);
+        }
+
+        /**
+         * \brief Slot i holds spheres[order[i]]
+         */
+        void Build(const std::vector<Sphere>& spheres, const std::vector<uint32_t>& order)
+        {
+            count = static_cast<uint32_t>(order.size());
+
+            //A range can start on any slot, so its last block may read up to SOA_WIDTH - 1 slots past the end
+            const size_t paddedCount{count + SOA_WIDTH - 1};
+            originX.assign(paddedCount, 0.0f);
+            originY.assign(paddedCount, 0.0f);
+            originZ.assign(paddedCount, 0.0f);
+            radius.assign(paddedCount, 0.0f);
+            materialIndices.assign(paddedCount, 0);
+            sphereIndices = order;
+
+            for (size_t slot{0}; slot < order.size(); ++slot)
+            {
+                const Sphere& sphere{spheres[order[slot]]};
+                originX[slot] = sphere.origin.x;
+                originY[slot] = sphere.origin.y;
+                originZ[slot] = sphere.origin.z;
+                radius[slot] = sphere.radius;
+                materialIndices[slot] = sphere.materialIndex;
+            }
+        }
+
+        Vector3 GetOrigin(uint32_t slot) const { return {originX[slot], originY[slot], originZ[slot]}; }
+    };
+
+    /**
+     * \brief Planes in structure-of-arrays layout, see SphereSoA
+     */
+    struct PlaneSoA
+    {
+        std::vector<float>         originX         {};
+        std::vector<float>         originY         {};
+        std::vector<float>         originZ         {};
+        std::vector<float>         normalX         {};
+        std::vector<float>         normalY         {};
+        std::vector<float>         normalZ         {};
+        std::vector<unsigned char> materialIndices {};
+
+        uint32_t count {0};
+
+        void Build(const std::vector<Plane>& planes)
+        {
+            count = static_cast<uint32_t>(planes.size());
+            const size_t paddedCount{(count + SOA_WIDTH - 1) / SOA_WIDTH * SOA_WIDTH};
+            originX.assign(paddedCount, 0.0f);
+            originY.assign(paddedCount, 0.0f);
+            originZ.assign(paddedCount, 0.0f);
+            normalX.assign(paddedCount, 0.0f);
+            normalY.assign(paddedCount, 0.0f);
+            normalZ.assign(paddedCount, 0.0f);
+            materialIndices.assign(paddedCount, 0);
+
+            for (size_t idx{0}; idx < planes.size(); ++idx)
+            {
+                originX[idx] = planes[idx].origin.x;
+                originY[idx] = planes[idx].origin.y;
+                originZ[idx] = planes[idx].origin.z;
+                normalX[idx] = planes[idx].normal.x;
+                normalY[idx] = planes[idx].normal.y;
+                normalZ[idx] = planes[idx].normal.z;
+                materialIndices[idx] = planes[idx].materialIndex;
+            }
+        }
+
+        uint32_t GetBlockCount() const { return static_cast<uint32_t>(originX.size() / SOA_WIDTH); }
+        Vector3 GetNormal(uint32_t idx) const { return {normalX[idx], normalY[idx], normalZ[idx]}; }
+    };
+#pragma endregion
+
+    namespace GeometryUtils
+    {
+#pragma region SoA HitTests
+        /**
+         * \brief Reduces the per-lane closest hits of a SoA kernel to the single closest one
+         * \return Index of the closest primitive
+         */
+        inline uint32_t GetClosestLaneSoA(__m256 closestT, __m256i closestIdx, float& t)
+        {
+            __m256 minT{_mm256_min_ps(closestT, _mm256_permute_ps(closestT, _MM_SHUFFLE(2, 3, 0, 1)))};
+            minT = _mm256_min_ps(minT, _mm256_permute_ps(minT, _MM_SHUFFLE(1, 0, 3, 2)));
+            minT = _mm256_min_ps(minT, _mm256_permute2f128_ps(minT, minT, 0x01));
+
+            const int lane{std::countr_zero(static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(closestT, minT, _CMP_EQ_OQ))))};
+
+            alignas(32) int indices[SOA_WIDTH];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(indices), closestIdx);
+            t = _mm256_cvtss_f32(minT);
+            return static_cast<uint32_t>(indices[lane]);
+        }
+
+        /**
+         * \brief Any-hit early out of a SoA kernel: the first lane of the block that hits
+         */
+        inline uint32_t GetFirstLaneSoA(__m256 mask, __m256 blockT, uint32_t offset, float& t)
+        {
+            const int lane{std::countr_zero(static_cast<unsigned>(_mm256_movemask_ps(mask)))};
+
+            alignas(32) float ts[SOA_WIDTH];
+            _mm256_store_ps(ts, blockT);
+            t = ts[lane];
+            return offset + static_cast<uint32_t>(lane);
+        }
+
+        /**
+         * \brief Analytic sphere test (see HitTest_Sphere) against the slots [first, first + count), 8 per iteration
+         * \return the closest sphere in t and slot, map it with sphereIndices, the hit attributes are left to the caller
+         * \param anyHit Stop at the first sphere that hits (shadow rays), t and slot are then that sphere's
+         */
+        inline bool HitTest_SphereSoA(const SphereSoA& spheres, uint32_t first, uint32_t count, const Ray& ray, float& t,
+            uint32_t& slot, bool anyHit = false)
+        {
+            const __m256 rayOriginX{_mm256_set1_ps(ray.origin.x)};
+            const __m256 rayOriginY{_mm256_set1_ps(ray.origin.y)};
+            const __m256 rayOriginZ{_mm256_set1_ps(ray.origin.z)};
+            const __m256 rayDirectionX{_mm256_set1_ps(ray.direction.x)};
+            const __m256 rayDirectionY{_mm256_set1_ps(ray.direction.y)};
+            const __m256 rayDirectionZ{_mm256_set1_ps(ray.direction.z)};
+            const __m256 rayMin{_mm256_set1_ps(ray.min)};
+            const __m256 rayMax{_mm256_set1_ps(ray.max)};
+            const __m256 zero{_mm256_setzero_ps()};
+
+            __m256 closestT{_mm256_set1_ps(FLT_MAX)};
+            __m256i closestIdx{_mm256_setzero_si256()};
+            __m256i laneIdx{_mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(first)))};
+            bool didHit{false};
+
+            for (uint32_t block{0}; block * SOA_WIDTH < count; ++block)
+            {
+                const uint32_t offset{first + block * SOA_WIDTH};
+                const __m256 Lx{_mm256_sub_ps(rayOriginX, _mm256_loadu_ps(&spheres.originX[offset]))};
+                const __m256 Ly{_mm256_sub_ps(rayOriginY, _mm256_loadu_ps(&spheres.originY[offset]))};
+                const __m256 Lz{_mm256_sub_ps(rayOriginZ, _mm256_loadu_ps(&spheres.originZ[offset]))};
+                const __m256 radius{_mm256_loadu_ps(&spheres.radius[offset])};
+
+                const __m256 B{
+                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rayDirectionX, Lx), _mm256_mul_ps(rayDirectionY, Ly)),
+                                  _mm256_mul_ps(rayDirectionZ, Lz))
+                };
+                const __m256 LL{
+                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Lx, Lx), _mm256_mul_ps(Ly, Ly)), _mm256_mul_ps(Lz, Lz))
+                };
+                const __m256 C{_mm256_sub_ps(LL, _mm256_mul_ps(radius, radius))};
+                const __m256 discriminant{_mm256_sub_ps(_mm256_mul_ps(B, B), C)};
+
+                __m256 mask{GetValidMaskSoA(count, block)};
+                mask = _mm256_andnot_ps(_mm256_and_ps(_mm256_cmp_ps(C, zero, _CMP_GT_OQ), _mm256_cmp_ps(B, zero, _CMP_GT_OQ)), mask);
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(discriminant, zero, _CMP_GE_OQ));
+
+                const __m256 t0{_mm256_sub_ps(_mm256_sub_ps(zero, B), _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero)))};
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(t0, rayMin, _CMP_GE_OQ));
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(t0, rayMax, _CMP_LE_OQ));
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(t0, closestT, _CMP_LT_OQ));
+
+                if (_mm256_movemask_ps(mask) != 0)
+                {
+                    didHit = true;
+                    if (anyHit)
+                    {
+                        slot = GetFirstLaneSoA(mask, t0, offset, t);
+                        return true;
+                    }
+
+                    closestT = _mm256_blendv_ps(closestT, t0, mask);
+                    closestIdx = _mm256_castps_si256(
+                        _mm256_blendv_ps(_mm256_castsi256_ps(closestIdx), _mm256_castsi256_ps(laneIdx), mask));
+                }
+                laneIdx = _mm256_add_epi32(laneIdx, _mm256_set1_epi32(static_cast<int>(SOA_WIDTH)));
+            }
+            if (not didHit) return false;
+
+            slot = GetClosestLaneSoA(closestT, closestIdx, t);
+            return true;
+        }
+
+        /**
+         * \brief HitTest_SphereSoA over all slots
+         * \return the closest sphere in t and idx, idx is already an index into the sphere vector
+         */
+        inline bool HitTest_SphereSoA(const SphereSoA& spheres, const Ray& ray, float& t, uint32_t& idx, bool anyHit = false)
+        {
+            uint32_t slot;
+            if (not HitTest_SphereSoA(spheres, 0, spheres.count, ray, t, slot, anyHit)) return false;
+
+            idx = spheres.sphereIndices[slot];
+            return true;
+        }
+
+        inline bool HitTest_SphereSoA(const SphereSoA& spheres, const Ray& ray)
+        {
+            float t;
+            uint32_t idx;
+            return HitTest_SphereSoA(spheres, ray, t, idx, true);
+        }
+
+        /**
+         * \brief Plane test (see HitTest_Plane) against 8 planes per iteration
+         * \return the closest plane in t and idx, the hit attributes are left to the caller
+         * \param anyHit Stop at the first plane that hits (shadow rays), t and idx are then that plane's
+         */
+        inline bool HitTest_PlaneSoA(const PlaneSoA& planes, const Ray& ray, float& t, uint32_t& idx, bool anyHit = false)
+        {
+            const __m256 rayOriginX{_mm256_set1_ps(ray.origin.x)};
+            const __m256 rayOriginY{_mm256_set1_ps(ray.origin.y)};
+            const __m256 rayOriginZ{_mm256_set1_ps(ray.origin.z)};
+            const __m256 rayDirectionX{_mm256_set1_ps(ray.direction.x)};
+            const __m256 rayDirectionY{_mm256_set1_ps(ray.direction.y)};
+            const __m256 rayDirectionZ{_mm256_set1_ps(ray.direction.z)};
+            const __m256 rayMin{_mm256_set1_ps(ray.min)};
+            const __m256 rayMax{_mm256_set1_ps(ray.max)};
+            const __m256 zero{_mm256_setzero_ps()};
+
+            __m256 closestT{_mm256_set1_ps(FLT_MAX)};
+            __m256i closestIdx{_mm256_setzero_si256()};
+            __m256i laneIdx{_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)};
+            bool didHit{false};
+
+            for (uint32_t block{0}; block < planes.GetBlockCount(); ++block)
+            {
+                const uint32_t offset{block * SOA_WIDTH};
+                const __m256 normalX{_mm256_loadu_ps(&planes.normalX[offset])};
+                const __m256 normalY{_mm256_loadu_ps(&planes.normalY[offset])};
+                const __m256 normalZ{_mm256_loadu_ps(&planes.normalZ[offset])};
+
+                const __m256 denom{
+                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normalX, rayDirectionX), _mm256_mul_ps(normalY, rayDirectionY)),
+                                  _mm256_mul_ps(normalZ, rayDirectionZ))
+                };
+
+                __m256 mask{_mm256_and_ps(GetValidMaskSoA(planes.count, block), _mm256_cmp_ps(denom, zero, _CMP_LT_OQ))};
+                if (_mm256_movemask_ps(mask) == 0)
+                {
+                    laneIdx = _mm256_add_epi32(laneIdx, _mm256_set1_epi32(static_cast<int>(SOA_WIDTH)));
+                    continue;
+                }
+
+                const __m256 Lx{_mm256_sub_ps(_mm256_loadu_ps(&planes.originX[offset]), rayOriginX)};
+                const __m256 Ly{_mm256_sub_ps(_mm256_loadu_ps(&planes.originY[offset]), rayOriginY)};
+                const __m256 Lz{_mm256_sub_ps(_mm256_loadu_ps(&planes.originZ[offset]), rayOriginZ)};
+                const __m256 t0{
+                    _mm256_div_ps(
+                        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Lx, normalX), _mm256_mul_ps(Ly, normalY)),
+                                      _mm256_mul_ps(Lz, normalZ)),
+                        denom)
+                };
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(t0, rayMin, _CMP_GE_OQ));
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(t0, rayMax, _CMP_LE_OQ));
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(t0, closestT, _CMP_LT_OQ));
+
+                if (_mm256_movemask_ps(mask) != 0)
+                {
+                    didHit = true;
+                    if (anyHit)
+                    {
+                        idx = GetFirstLaneSoA(mask, t0, offset, t);
+                        return true;
+                    }
+
+                    closestT = _mm256_blendv_ps(closestT, t0, mask);
+                    closestIdx = _mm256_castps_si256(
+                        _mm256_blendv_ps(_mm256_castsi256_ps(closestIdx), _mm256_castsi256_ps(laneIdx), mask));
+                }
+                laneIdx = _mm256_add_epi32(laneIdx, _mm256_set1_epi32(static_cast<int>(SOA_WIDTH)));
+            }
+            if (not didHit) return false;
+
+            idx = GetClosestLaneSoA(closestT, closestIdx, t);
+            return true;
+        }
+
+        inline bool HitTest_PlaneSoA(const PlaneSoA& planes, const Ray& ray)
+        {
+            float t;
+            uint32_t idx;
+            return HitTest_PlaneSoA(planes, ray, t, idx, true);
+        }
+#pragma endregion
+    }
+}
@@ -0,0 +1,478 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace dae
+{
+    namespace
+    {
+#pragma region Deflate
+        /**
+         * \brief Packs bits LSB first, the order deflate reads them in
+         */
+        class BitWriter final
+        {
+        public:
+            explicit BitWriter(std::vector<uint8_t>& bytes) : m_Bytes(bytes) { }
+
+            void Write(uint32_t bits, int count)
+            {
+                m_BitBuffer |= static_cast<uint64_t>(bits) << m_BitCount;
+                m_BitCount += count;
+                while (m_BitCount >= 8)
+                {
+                    m_Bytes.push_back(static_cast<uint8_t>(m_BitBuffer));
+                    m_BitBuffer >>= 8;
+                    m_BitCount -= 8;
+                }
+            }
+
+            //Huffman codes are the exception, they are stored MSB first
+            void WriteCode(uint32_t code, int length)
+            {
+                uint32_t reversed{0};
+                for (int bit{0}; bit < length; ++bit)
+                {
+                    reversed = reversed << 1 | (code >> bit & 1);
+                }
+                Write(reversed, length);
+            }
+
+            void Flush()
+            {
+                if (m_BitCount > 0) m_Bytes.push_back(static_cast<uint8_t>(m_BitBuffer));
+                m_BitBuffer = 0;
+                m_BitCount = 0;
+            }
+
+        private:
+            std::vector<uint8_t>& m_Bytes;
+            uint64_t              m_BitBuffer {0};
+            int                   m_BitCount  {0};
+        };
+
+        constexpr int MIN_MATCH_LENGTH{3};
+        constexpr int MAX_MATCH_LENGTH{258};
+        constexpr int WINDOW_SIZE{32768};
+        constexpr int HASH_BITS{15};
+
+        constexpr std::array<int, 29> LENGTH_BASES{
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+        };
+        constexpr std::array<int, 29> LENGTH_EXTRA_BITS{
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+        };
+        constexpr std::array<int, 30> DISTANCE_BASES{
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+            6145, 8193, 12289, 16385, 24577
+        };
+        constexpr std::array<int, 30> DISTANCE_EXTRA_BITS{
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+        };
+
+        //Fixed Huffman code of a literal/length symbol (RFC 1951, 3.2.6)
+        void WriteLiteralLengthSymbol(BitWriter& writer, int symbol)
+        {
+            if (symbol < 144) writer.WriteCode(0x30 + symbol, 8);
+            else if (symbol < 256) writer.WriteCode(0x190 + symbol - 144, 9);
+            else if (symbol < 280) writer.WriteCode(symbol - 256, 7);
+            else writer.WriteCode(0xc0 + symbol - 280, 8);
+        }
+
+        //Index of the last base that is not larger than value
+        template <size_t size>
+        int FindBase(const std::array<int, size>& bases, int value)
+        {
+            return static_cast<int>(std::upper_bound(bases.begin(), bases.end(), value) - bases.begin()) - 1;
+        }
+
+        void WriteMatch(BitWriter& writer, int length, int distance)
+        {
+            const int lengthIdx{FindBase(LENGTH_BASES, length)};
+            WriteLiteralLengthSymbol(writer, 257 + lengthIdx);
+            writer.Write(length - LENGTH_BASES[lengthIdx], LENGTH_EXTRA_BITS[lengthIdx]);
+
+            const int distanceIdx{FindBase(DISTANCE_BASES, distance)};
+            writer.WriteCode(distanceIdx, 5);
+            writer.Write(distance - DISTANCE_BASES[distanceIdx], DISTANCE_EXTRA_BITS[distanceIdx]);
+        }
+
+        uint32_t GetHash(const uint8_t* pBytes)
+        {
+            const uint32_t value{static_cast<uint32_t>(pBytes[0]) | pBytes[1] << 8 | pBytes[2] << 16};
+            return (value * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        /**
+         * \brief zlib stream of one fixed-Huffman deflate block, matches come from a single-entry hash table \n
+         * Rendered frames are mostly smooth, after PNG filtering that is long runs the greedy matcher catches
+         */
+        std::vector<uint8_t> Compress(const std::vector<uint8_t>& data)
+        {
+            std::vector<uint8_t> bytes{0x78, 0x01};
+            BitWriter writer{bytes};
+            writer.Write(1, 1); //Final block
+            writer.Write(1, 2); //Fixed Huffman codes
+
+            const int size{static_cast<int>(data.size())};
+            std::vector<int> lastPositions(size_t{1} << HASH_BITS, -WINDOW_SIZE - 1);
+            int position{0};
+            while (position < size)
+            {
+                int matchLength{0};
+                int matchDistance{0};
+                if (position + MIN_MATCH_LENGTH <= size)
+                {
+                    const uint32_t hash{GetHash(&data[position])};
+                    const int candidate{lastPositions[hash]};
+                    lastPositions[hash] = position;
+
+                    if (position - candidate <= WINDOW_SIZE)
+                    {
+                        const int maxLength{std::min(MAX_MATCH_LENGTH, size - position)};
+                        while (matchLength < maxLength and data[candidate + matchLength] == data[position + matchLength])
+                        {
+                            ++matchLength;
+                        }
+                        matchDistance = position - candidate;
+                    }
+                }
+
+                if (matchLength >= MIN_MATCH_LENGTH)
+                {
+                    WriteMatch(writer, matchLength, matchDistance);
+                    for (int skipped{1}; skipped < matchLength and position + skipped + MIN_MATCH_LENGTH <= size; ++skipped)
+                    {
+                        lastPositions[GetHash(&data[position + skipped])] = position + skipped;
+                    }
+                    position += matchLength;
+                }
+                else
+                {
+                    WriteLiteralLengthSymbol(writer, data[position]);
+                    ++position;
+                }
+            }
+            WriteLiteralLengthSymbol(writer, 256); //End of block
+            writer.Flush();
+
+            uint32_t adlerA{1}, adlerB{0};
+            for (const uint8_t byte : data)
+            {
+                adlerA = (adlerA + byte) % 65521;
+                adlerB = (adlerB + adlerA) % 65521;
+            }
+            const uint32_t adler{adlerB << 16 | adlerA};
+            bytes.insert(bytes.end(), {
+                static_cast<uint8_t>(adler >> 24), static_cast<uint8_t>(adler >> 16),
+                static_cast<uint8_t>(adler >> 8), static_cast<uint8_t>(adler)
+            });
+            return bytes;
+        }
+#pragma endregion
+
+#pragma region PNG
+        uint32_t GetCRC(const uint8_t* pBytes, size_t size, uint32_t crc = 0)
+        {
+            static const std::array<uint32_t, 256> table{[]
+            {
+                std::array<uint32_t, 256> values{};
+                for (uint32_t idx{0}; idx < 256; ++idx)
+                {
+                    uint32_t value{idx};
+                    for (int bit{0}; bit < 8; ++bit)
+                    {
+                        value = value & 1 ? 0xedb88320u ^ value >> 1 : value >> 1;
+                    }
+                    values[idx] = value;
+                }
+                return values;
+            }()};
+
+            crc = ~crc;
+            for (size_t idx{0}; idx < size; ++idx)
+            {
+                crc = table[(crc ^ pBytes[idx]) & 0xff] ^ crc >> 8;
+            }
+            return ~crc;
+        }
+
+        void WriteBigEndian(std::ostream& file, uint32_t value)
+        {
+            const char bytes[4]{
+                static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+                static_cast<char>(value >> 8), static_cast<char>(value)
+            };
+            file.write(bytes, 4);
+        }
+
+        void WriteChunk(std::ostream& file, const char (&type)[5], const std::vector<uint8_t>& data)
+        {
+            WriteBigEndian(file, static_cast<uint32_t>(data.size()));
+            file.write(type, 4);
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+            const uint32_t crc{GetCRC(reinterpret_cast<const uint8_t*>(type), 4)};
+            WriteBigEndian(file, GetCRC(data.data(), data.size(), crc));
+        }
+
+        uint8_t GetPaethPredictor(int left, int up, int upLeft)
+        {
+            const int estimate{left + up - upLeft};
+            const int distanceLeft{std::abs(estimate - left)};
+            const int distanceUp{std::abs(estimate - up)};
+            const int distanceUpLeft{std::abs(estimate - upLeft)};
+            if (distanceLeft <= distanceUp and distanceLeft <= distanceUpLeft) return static_cast<uint8_t>(left);
+            if (distanceUp <= distanceUpLeft) return static_cast<uint8_t>(up);
+            return static_cast<uint8_t>(upLeft);
+        }
+
+        /**
+         * \brief Filters every row with the PNG filter whose output has the smallest sum of absolute values
+         */
+        std::vector<uint8_t> FilterRows(const std::vector<uint8_t>& rgb, int width, int height)
+        {
+            constexpr int bytesPerPixel{3};
+            const size_t rowSize{static_cast<size_t>(width) * bytesPerPixel};
+            const std::vector<uint8_t> zeroRow(rowSize, 0);
+
+            std::vector<uint8_t> filtered{};
+            filtered.reserve((rowSize + 1) * height);
+
+            std::array<std::vector<uint8_t>, 5> candidates{};
+            for (std::vector<uint8_t>& candidate : candidates)
+            {
+                candidate.resize(rowSize);
+            }
+
+            for (int y{0}; y < height; ++y)
+            {
+                const uint8_t* pRow{&rgb[y * rowSize]};
+                const uint8_t* pUpRow{y > 0 ? &rgb[(y - 1) * rowSize] : zeroRow.data()};
+
+                for (size_t idx{0}; idx < rowSize; ++idx)
+                {
+                    const int left{idx >= bytesPerPixel ? pRow[idx - bytesPerPixel] : 0};
+                    const int up{pUpRow[idx]};
+                    const int upLeft{idx >= bytesPerPixel ? pUpRow[idx - bytesPerPixel] : 0};
+
+                    candidates[0][idx] = pRow[idx];
+                    candidates[1][idx] = static_cast<uint8_t>(pRow[idx] - left);
+                    candidates[2][idx] = static_cast<uint8_t>(pRow[idx] - up);
+                    candidates[3][idx] = static_cast<uint8_t>(pRow[idx] - (left + up) / 2);
+                    candidates[4][idx] = static_cast<uint8_t>(pRow[idx] - GetPaethPredictor(left, up, upLeft));
+                }
+
+                int bestFilter{0};
+                uint64_t bestCost{UINT64_MAX};
+                for (int filter{0}; filter < static_cast<int>(candidates.size()); ++filter)
+                {
+                    uint64_t cost{0};
+                    for (const uint8_t value : candidates[filter])
+                    {
+                        cost += std::abs(static_cast<int8_t>(value));
+                    }
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestFilter = filter;
+                    }
+                }
+
+                filtered.push_back(static_cast<uint8_t>(bestFilter));
+                filtered.insert(filtered.end(), candidates[bestFilter].begin(), candidates[bestFilter].end());
+            }
+            return filtered;
+        }
+#pragma endregion
+
+        std::vector<uint8_t> ToRGB(const std::vector<uint32_t>& pixels)
+        {
+            std::vector<uint8_t> rgb(pixels.size() * 3);
+            for (size_t idx{0}; idx < pixels.size(); ++idx)
+            {
+                rgb[idx * 3] = static_cast<uint8_t>(pixels[idx] >> 16);
+                rgb[idx * 3 + 1] = static_cast<uint8_t>(pixels[idx] >> 8);
+                rgb[idx * 3 + 2] = static_cast<uint8_t>(pixels[idx]);
+            }
+            return rgb;
+        }
+    }
+
+    ImageWriter::ImageWriter()
+    {
+        for (int idx{0}; idx < SNAPSHOT_COUNT; ++idx)
+        {
+            m_FreeSnapshots.push_back(idx);
+        }
+        m_Thread = std::thread{&ImageWriter::WorkerLoop, this};
+    }
+
+    ImageWriter::~ImageWriter()
+    {
+        //Everything that was queued still gets written
+        {
+            std::lock_guard lock{m_Mutex};
+            m_IsStopping = true;
+        }
+        m_QueuedCondition.notify_one();
+        m_Thread.join();
+    }
+
+    bool ImageWriter::GetFormat(const std::string& filePath, ImageFormat& format)
+    {
+        const size_t dotIdx{filePath.find_last_of('.')};
+        if (dotIdx == std::string::npos) return false;
+
+        std::string extension{filePath.substr(dotIdx + 1)};
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char character) { return static_cast<char>(std::tolower(character)); });
+
+        if (extension == "png") format = ImageFormat::PNG;
+        else if (extension == "pfm") format = ImageFormat::PFM;
+        else if (extension == "ppm") format = ImageFormat::PPM;
+        else return false;
+        return true;
+    }
+
+    bool ImageWriter::Write(const std::string& filePath, int width, int height, const uint32_t* pPixels,
+                            const ColorRGB* pHDRPixels, float hdrScale)
+    {
+        ImageFormat format;
+        if (not GetFormat(filePath, format)) return false;
+
+        int snapshotIdx;
+        {
+            std::unique_lock lock{m_Mutex};
+            m_FreedCondition.wait(lock, [this] { return not m_FreeSnapshots.empty(); });
+            snapshotIdx = m_FreeSnapshots.back();
+            m_FreeSnapshots.pop_back();
+        }
+
+        //The slot is ours until it is queued, the copy runs without the lock
+        Snapshot& snapshot{m_Snapshots[snapshotIdx]};
+        const size_t pixelCount{static_cast<size_t>(width) * height};
+        snapshot.filePath = filePath;
+        snapshot.format = format;
+        snapshot.width = width;
+        snapshot.height = height;
+        snapshot.hdrScale = hdrScale;
+        snapshot.pixels.assign(pPixels, pPixels + pixelCount);
+        if (format == ImageFormat::PFM and pHDRPixels) snapshot.hdrPixels.assign(pHDRPixels, pHDRPixels + pixelCount);
+        else snapshot.hdrPixels.clear();
+
+        {
+            std::lock_guard lock{m_Mutex};
+            m_QueuedSnapshots.push_back(snapshotIdx);
+        }
+        m_QueuedCondition.notify_one();
+        return true;
+    }
+
+    bool ImageWriter::Flush()
+    {
+        std::unique_lock lock{m_Mutex};
+        m_FreedCondition.wait(lock, [this] { return m_FreeSnapshots.size() == SNAPSHOT_COUNT; });
+
+        const bool hasSucceeded{not m_HasFailed};
+        m_HasFailed = false;
+        return hasSucceeded;
+    }
+
+    void ImageWriter::WorkerLoop()
+    {
+        std::unique_lock lock{m_Mutex};
+        while (true)
+        {
+            m_QueuedCondition.wait(lock, [this] { return m_IsStopping or not m_QueuedSnapshots.empty(); });
+            if (m_QueuedSnapshots.empty()) return;
+
+            const int snapshotIdx{m_QueuedSnapshots.front()};
+            m_QueuedSnapshots.pop_front();
+
+            lock.unlock();
+            const bool isWritten{WriteSnapshot(m_Snapshots[snapshotIdx])};
+            if (not isWritten)
+                std::cout << "Something went wrong. Image not saved to " << m_Snapshots[snapshotIdx].filePath << std::endl;
+            lock.lock();
+
+            m_HasFailed = m_HasFailed or not isWritten;
+            m_FreeSnapshots.push_back(snapshotIdx);
+            m_FreedCondition.notify_all();
+        }
+    }
+
+    bool ImageWriter::WriteSnapshot(const Snapshot& snapshot)
+    {
+        std::ofstream file{snapshot.filePath, std::ios::binary};
+        if (not file) return false;
+
+        switch (snapshot.format)
+        {
+        case ImageFormat::PNG:
+            {
+                static constexpr uint8_t signature[8]{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+                file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+                std::vector<uint8_t> header(13, 0);
+                for (int byte{0}; byte < 4; ++byte)
+                {
+                    header[byte] = static_cast<uint8_t>(snapshot.width >> (24 - byte * 8));
+                    header[4 + byte] = static_cast<uint8_t>(snapshot.height >> (24 - byte * 8));
+                }
+                header[8] = 8; //Bits per channel
+                header[9] = 2; //RGB
+                WriteChunk(file, "IHDR", header);
+                WriteChunk(file, "IDAT", Compress(FilterRows(ToRGB(snapshot.pixels), snapshot.width, snapshot.height)));
+                WriteChunk(file, "IEND", {});
+                break;
+            }
+        case ImageFormat::PFM:
+            {
+                //Negative scale means little endian, rows are stored bottom to top
+                file << "PF\n" << snapshot.width << ' ' << snapshot.height << "\n-1.0\n";
+
+                std::vector<float> row(static_cast<size_t>(snapshot.width) * 3);
+                for (int py{snapshot.height - 1}; py >= 0; --py)
+                {
+                    for (int px{0}; px < snapshot.width; ++px)
+                    {
+                        const size_t pixelIdx{static_cast<size_t>(py) * snapshot.width + px};
+                        ColorRGB color;
+                        if (snapshot.hdrPixels.empty())
+                        {
+                            const uint32_t pixel{snapshot.pixels[pixelIdx]};
+                            color = ColorRGB{
+                                static_cast<float>(pixel >> 16 & 0xff),
+                                static_cast<float>(pixel >> 8 & 0xff),
+                                static_cast<float>(pixel & 0xff)
+                            } * (1.0f / 255.0f);
+                        }
+                        else
+                        {
+                            color = snapshot.hdrPixels[pixelIdx] * snapshot.hdrScale;
+                        }
+                        row[px * 3] = color.r;
+                        row[px * 3 + 1] = color.g;
+                        row[px * 3 + 2] = color.b;
+                    }
+                    file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+                }
+                break;
+            }
+        case ImageFormat::PPM:
+            {
+                file << "P6\n" << snapshot.width << ' ' << snapshot.height << "\n255\n";
+                const std::vector<uint8_t> rgb{ToRGB(snapshot.pixels)};
+                file.write(reinterpret_cast<const char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
+                break;
+            }
+        }
+        return static_cast<bool>(file);
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ColorRGB.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+    enum class ImageFormat
+    {
+        PNG, // 8-bit RGB
+        PFM, // 32-bit float RGB, keeps the HDR colours
+        PPM  // 8-bit binary RGB (P6)
+    };
+
+    /**
+     * \brief Encodes and writes images on its own thread \n
+     * A save only copies the frame into one of two snapshot slots, so rendering continues while the previous frame is encoded \n
+     * It only waits when both slots are still being written, an image sequence is never dropped
+     */
+    class ImageWriter final
+    {
+    public:
+        ImageWriter();
+        ~ImageWriter();
+
+        ImageWriter(const ImageWriter&) = delete;
+        ImageWriter(ImageWriter&&) noexcept = delete;
+        ImageWriter& operator=(const ImageWriter&) = delete;
+        ImageWriter& operator=(ImageWriter&&) noexcept = delete;
+
+        /**
+         * \brief Format from the file extension (.png, .pfm or .ppm, any case)
+         * \return false for any other extension
+         */
+        static bool GetFormat(const std::string& filePath, ImageFormat& format);
+
+        /**
+         * \brief Queues a copy of the frame \n
+         * pixels are row-major 0x00RRGGBB, hdrPixels (may be null) are multiplied by hdrScale and only used for PFM
+         * \return false if the extension is not supported, nothing is queued then
+         */
+        bool Write(const std::string& filePath, int width, int height, const uint32_t* pPixels,
+                   const ColorRGB* pHDRPixels = nullptr, float hdrScale = 1.0f);
+
+        /**
+         * \brief Waits until every queued image is on disk
+         * \return true if all images queued since the last Flush were written
+         */
+        bool Flush();
+
+    private:
+        struct Snapshot
+        {
+            std::string           filePath  {};
+            ImageFormat           format    {ImageFormat::PNG};
+            int                   width     {0};
+            int                   height    {0};
+            float                 hdrScale  {1.0f};
+            std::vector<uint32_t> pixels    {};
+            std::vector<ColorRGB> hdrPixels {};
+        };
+
+        static constexpr int SNAPSHOT_COUNT{2};
+
+        //The vectors of a slot keep their capacity, saving an image sequence stops allocating after the first two frames
+        Snapshot         m_Snapshots[SNAPSHOT_COUNT] {};
+        std::vector<int> m_FreeSnapshots             {};
+        std::deque<int>  m_QueuedSnapshots           {};
+
+        std::mutex              m_Mutex           {};
+        std::condition_variable m_QueuedCondition {};
+        std::condition_variable m_FreedCondition  {};
+        bool                    m_IsStopping      {false};
+        bool                    m_HasFailed       {false};
+
+        std::thread m_Thread {};
+
+        void WorkerLoop();
+        static bool WriteSnapshot(const Snapshot& snapshot);
+    };
+}
@@ -6,11 +6,111 @@
  */
 #define QRSQRT 0
 
+/**
+ * \brief Matrix transforms, products and transposes run on SSE registers, one Vector4 row per register \n
+ * Same evaluation order as the scalar code, so images do not change. Vector3 stays scalar
+ */
+#define SIMD_MATH 1
+
 #define MULTITHREADING 1
 #define MOLLER_TRUMBORE 1
 #define SPHERE_INTERSECTION_ANALYTIC 1
 #define TRIANGLE_MESH_WITH_FUNCTION_CALL 0
 
+/**
+ * \brief Per-mesh SAH bounding volume hierarchy, refit when the mesh transforms are updated \n
+ * Rebuilt only once the refit SAH cost passes BVH::maxRefitCostRatio, instanced meshes keep their tree as built \n
+ * If 0, every triangle of the mesh is tested against every ray
+ */
+#define BVH_MESH 1
+
+/**
+ * \brief Mesh BVH leaves hold up to 8 triangles, stored as precomputed v0/e1/e2 blocks and tested with one AVX2 kernel \n
+ * The blocks are rebuilt in UpdateTransforms, traversal never goes through the index buffer. Needs BVH_MESH
+ */
+#define TRIANGLE_BLOCKS 1
+
+/**
+ * \brief Shared meshes are read back from a binary cache next to the OBJ while the OBJ content is unchanged, see MeshCache \n
+ * Every launch after the first skips parsing and building the normals, AABB, BVH and triangle blocks
+ */
+#define MESH_CACHE 1
+
+/**
+ * \brief Top-level BVH over the spheres and triangle meshes of the scene, planes are kept in a separate list \n
+ * If 0, every object of the scene is tested against every ray
+ */
+#define BVH_SCENE 1
+
+/**
+ * \brief Spheres and planes are stored as structure-of-arrays and tested 8 at a time with AVX2 \n
+ * The spheres stay in the top-level BVH, whose leaves then hold up to 8 primitives and test their spheres in one SoA call \n
+ * If 0, spheres and planes are tested one by one from their Sphere/Plane vectors
+ */
+#define SOA_GEOMETRY 1
+
+/**
+ * \brief Axis-aligned planes facing inwards, at most one per side of every axis, are merged into one Room primitive by BuildTLAS \n
+ * A ray can only reach the wall ahead of it on each axis, so the closest wall is one slab exit test instead of a test per plane \n
+ * Shadow rays ending inside the room (point lights in the room) skip the walls, the room is convex
+ */
+#define PLANE_ROOM 1
+
+/**
+ * \brief Trace primary and shadow rays in 2x2 pixel packets with SSE, one ray per lane \n
+ * Can be toggled at runtime (F4) to compare against the single-ray path, needs BVH_MESH and BVH_SCENE to pay off
+ */
+#define PACKET_TRACING 1
+
+/**
+ * \brief Shadow queries first test the primitive that blocked the previous shadow ray towards the same light \n
+ * Neighbouring pixels are mostly shadowed by the same object, so most blocked rays stop after that single test \n
+ * One cache per render thread and light, the hit rate is reported by the benchmark with RAY_STATS
+ */
+#define OCCLUDER_CACHE 1
+
+/**
+ * \brief Render, RenderScene_W5 and the packets shade a whole tile at a time: every pixel's hit is written to a buffer first, \n
+ * then per light the lit samples are sorted by material type and shaded by one SoA loop per type (ShadeBatch) instead of a Shade call each \n
+ * If 0, every pixel is traced and shaded on its own. The adaptive AA refinement always shades per sample
+ */
+#define WAVEFRONT_SHADING 1
+
+/**
+ * \brief Render, RenderScene_W5 and the packets add one jittered sample per frame to a float HDR buffer \n
+ * and show the running average, so a still camera over a still scene converges to an anti-aliased image \n
+ * Restarts when the camera, the scene geometry or a render setting changes, can be toggled at runtime (F5)
+ */
+#define PROGRESSIVE_ACCUMULATION 1
+
+/**
+ * \brief The wavefront kernels keep the pixel-centre primary hit and view direction of every pixel (G-buffer) \n
+ * A frame through the pixel centres with the same camera, scene and geometry is only shaded from it, not traced, \n
+ * so toggling shadows (F2) or the lighting mode (F3) skips every primary ray. Needs WAVEFRONT_SHADING \n
+ * Depth, normal and material index can be saved as images (G key, --aov)
+ */
+#define GBUFFER_CACHING 1
+
+/**
+ * \brief Adaptive anti-aliasing for frames that restart the accumulation (a moving camera or an animated scene) \n
+ * Pixels whose on-screen luminance differs from a neighbour get a grid of extra samples, the rest keeps its single ray \n
+ * Off by default, toggled at runtime (F7), tuned with Renderer::SetAASubdivisions and SetAAContrastThreshold
+ */
+#define ADAPTIVE_AA 1
+
+/**
+ * \brief Count the primary and shadow rays the scene traces, reported by the benchmark (--benchmark) \n
+ * One relaxed atomic add per ray or packet, on a cache line owned by the calling thread
+ */
+#define RAY_STATS 1
+
+/**
+ * \brief Replace the global operator new to count every heap allocation, per thread, see AllocationTracker \n
+ * The benchmark then reports the allocations per frame and fails if a measured frame allocates at all \n
+ * Off by default, it costs two relaxed atomic adds per allocation
+ */
+#define ALLOCATION_TRACKING 0
+
 /**
  * \brief For testing purposes: switch between weeks - can be slower because of dynamic cast \n\n
  * If 0, then REFERENCE scene is applied with 6 spheres and 3 triangles (Week 4)
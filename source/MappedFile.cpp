@@ -0,0 +1,103 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    bool MappedFile::Open(const std::string& filePath)
+    {
+        Close();
+
+#ifdef _WIN32
+        const HANDLE fileHandle{
+            CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr)
+        };
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+        m_FileHandle = fileHandle;
+
+        LARGE_INTEGER fileSize{};
+        if (not GetFileSizeEx(fileHandle, &fileSize))
+        {
+            Close();
+            return false;
+        }
+        m_Size = static_cast<size_t>(fileSize.QuadPart);
+        //A mapping of zero bytes is an error, an empty file simply has no data
+        if (m_Size == 0) return true;
+
+        m_MappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_MappingHandle == nullptr)
+        {
+            Close();
+            return false;
+        }
+
+        m_pData = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (m_pData == nullptr)
+        {
+            Close();
+            return false;
+        }
+#else
+        const int fileDescriptor{open(filePath.c_str(), O_RDONLY)};
+        if (fileDescriptor < 0) return false;
+
+        struct stat fileStatus{};
+        if (fstat(fileDescriptor, &fileStatus) != 0)
+        {
+            close(fileDescriptor);
+            return false;
+        }
+        m_Size = static_cast<size_t>(fileStatus.st_size);
+        if (m_Size == 0)
+        {
+            close(fileDescriptor);
+            return true;
+        }
+
+        //The mapping keeps its own reference to the file, the descriptor is not needed anymore
+        void* pData{mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0)};
+        close(fileDescriptor);
+        if (pData == MAP_FAILED)
+        {
+            m_Size = 0;
+            return false;
+        }
+        madvise(pData, m_Size, MADV_SEQUENTIAL);
+        m_pData = static_cast<const char*>(pData);
+#endif
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+#ifdef _WIN32
+        if (m_pData != nullptr) UnmapViewOfFile(m_pData);
+        if (m_MappingHandle != nullptr) CloseHandle(m_MappingHandle);
+        if (m_FileHandle != nullptr) CloseHandle(m_FileHandle);
+        m_MappingHandle = nullptr;
+        m_FileHandle = nullptr;
+#else
+        if (m_pData != nullptr) munmap(const_cast<char*>(m_pData), m_Size);
+#endif
+
+        m_pData = nullptr;
+        m_Size = 0;
+    }
+}
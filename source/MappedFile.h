@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace dae
+{
+    /**
+     * \brief Read-only memory mapping of a whole file \n
+     * The operating system pages the file in on demand, nothing is copied into a buffer of our own
+     */
+    class MappedFile final
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) noexcept = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+        /**
+         * \brief Maps the file, a previously opened file is closed first \n
+         * An empty file opens fine, GetData is null then
+         * \return false if the file can not be opened or mapped
+         */
+        bool Open(const std::string& filePath);
+        void Close();
+
+        const char* GetData() const { return m_pData; }
+        size_t GetSize() const { return m_Size; }
+
+    private:
+        const char* m_pData {nullptr};
+        size_t      m_Size  {0};
+
+#ifdef _WIN32
+        void* m_FileHandle    {nullptr};
+        void* m_MappingHandle {nullptr};
+#endif
+    };
+}
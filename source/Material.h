@@ -10,7 +10,10 @@ namespace dae
     class Material
     {
     public:
-        Material() = default;
+        explicit Material(MaterialType type) : m_Type{type}
+        {
+        }
+
         virtual ~Material() = default;
 
         Material(const Material&) = delete;
@@ -26,6 +29,19 @@ namespace dae
          * \return color
          */
         virtual ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) = 0;
+
+        /**
+         * \brief Parameters of the material as a tagged POD, shaded by ShadeBatch with the same math as Shade
+         */
+        virtual MaterialData GetData() const = 0;
+
+        /**
+         * \brief Concrete class of the material, lets MaterialSet call its Shade without going through the vtable
+         */
+        MaterialType GetType() const { return m_Type; }
+
+    private:
+        const MaterialType m_Type;
     };
 #pragma endregion
 
@@ -35,7 +51,9 @@ namespace dae
     class Material_SolidColor final : public Material
     {
     public:
-        Material_SolidColor(const ColorRGB& color): m_Color(color)
+        static constexpr MaterialType type{MaterialType::SolidColor};
+
+        Material_SolidColor(const ColorRGB& color): Material(type), m_Color(color)
         {
         }
 
@@ -44,6 +62,14 @@ namespace dae
             return m_Color;
         }
 
+        MaterialData GetData() const override
+        {
+            MaterialData data{};
+            data.type = type;
+            data.color = m_Color;
+            return data;
+        }
+
     private:
         ColorRGB m_Color{colors::White};
     };
@@ -55,8 +81,10 @@ namespace dae
     class Material_Lambert final : public Material
     {
     public:
+        static constexpr MaterialType type{MaterialType::Lambert};
+
         Material_Lambert(const ColorRGB& diffuseColor, float diffuseReflectance) :
-            m_DiffuseColor(diffuseColor), m_DiffuseReflectance(diffuseReflectance)
+            Material(type), m_DiffuseColor(diffuseColor), m_DiffuseReflectance(diffuseReflectance)
         {
         }
 
@@ -65,6 +93,15 @@ namespace dae
             return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
         }
 
+        MaterialData GetData() const override
+        {
+            MaterialData data{};
+            data.type = type;
+            data.color = m_DiffuseColor;
+            data.diffuseReflectance = m_DiffuseReflectance;
+            return data;
+        }
+
     private:
         ColorRGB m_DiffuseColor       {colors::White};
         float    m_DiffuseReflectance {1.f}; //kd
@@ -77,8 +114,10 @@ namespace dae
     class Material_LambertPhong final : public Material
     {
     public:
+        static constexpr MaterialType type{MaterialType::LambertPhong};
+
         Material_LambertPhong(const ColorRGB& diffuseColor, float kd, float ks, float phongExponent):
-            m_DiffuseColor(diffuseColor), m_DiffuseReflectance(kd), m_SpecularReflectance(ks),
+            Material(type), m_DiffuseColor(diffuseColor), m_DiffuseReflectance(kd), m_SpecularReflectance(ks),
             m_PhongExponent(phongExponent)
         {
         }
@@ -89,6 +128,17 @@ namespace dae
                 + BRDF::Phong(m_SpecularReflectance, m_PhongExponent, l, v, hitRecord.normal);
         }
 
+        MaterialData GetData() const override
+        {
+            MaterialData data{};
+            data.type = type;
+            data.color = m_DiffuseColor;
+            data.diffuseReflectance = m_DiffuseReflectance;
+            data.specularReflectance = m_SpecularReflectance;
+            data.phongExponent = m_PhongExponent;
+            return data;
+        }
+
     private:
         ColorRGB m_DiffuseColor        {colors::White};
         float    m_DiffuseReflectance  {0.5f}; //kd
@@ -102,8 +152,11 @@ namespace dae
     class Material_CookTorrence final : public Material
     {
     public:
+        static constexpr MaterialType type{MaterialType::CookTorrence};
+
         Material_CookTorrence(const ColorRGB& albedo, float metalness, float roughness)
-            : m_Metalness{metalness}
+            : Material{type}
+              , m_Metalness{metalness}
               , m_Roughness{roughness}
               , m_Albedo{albedo}
               , m_F0{m_Metalness == 0.0f ? colors::Dielectric : m_Albedo}
@@ -129,6 +182,17 @@ namespace dae
             return diffuse + specular;
         }
 
+        MaterialData GetData() const override
+        {
+            MaterialData data{};
+            data.type = type;
+            data.color = m_Albedo;
+            data.metalness = m_Metalness;
+            data.roughness = m_Roughness;
+            data.f0 = m_F0;
+            return data;
+        }
+
     private:
         float    m_Metalness {1.0f};
         float    m_Roughness {0.1f}; // [1.0 > 0.0] >> [ROUGH > SMOOTH]
@@ -136,4 +200,34 @@ namespace dae
         ColorRGB m_F0        {};
     };
 #pragma endregion
+
+#pragma region Material SET
+    /**
+     * \brief Compile-time list of the materials a render kernel shades directly \n
+     * Shade compares the type tag and calls the final class' Shade by name, so it inlines into the kernel \n
+     * Materials outside the set still work, they fall back to the virtual call
+     */
+    template <typename... Materials>
+    struct MaterialSet
+    {
+        static ColorRGB Shade(Material* pMaterial, const HitRecord& hitRecord, const Vector3& l, const Vector3& v)
+        {
+            return ShadeAs<Materials...>(pMaterial, hitRecord, l, v);
+        }
+
+    private:
+        template <typename First, typename... Rest>
+        static ColorRGB ShadeAs(Material* pMaterial, const HitRecord& hitRecord, const Vector3& l, const Vector3& v)
+        {
+            if (pMaterial->GetType() == First::type)
+                return static_cast<First*>(pMaterial)->First::Shade(hitRecord, l, v);
+
+            if constexpr (sizeof...(Rest) > 0) return ShadeAs<Rest...>(pMaterial, hitRecord, l, v);
+            else return pMaterial->Shade(hitRecord, l, v);
+        }
+    };
+
+    //Most used first, the tags are compared in this order
+    using AllMaterials = MaterialSet<Material_CookTorrence, Material_LambertPhong, Material_Lambert, Material_SolidColor>;
+#pragma endregion
 }
@@ -2,52 +2,324 @@
 
 #include "Vector3.h"
 #include "Vector4.h"
+#include "Macros.h"
+
+#include <cassert>
+#include <cmath>
 
 namespace dae
 {
+    /**
+     * \brief Header-only, the four rows are aligned Vector4s so every row is one SSE register (see SIMD_MATH) \n
+     * The SSE paths keep the evaluation order of the scalar ones, both give bit-identical results
+     */
     struct Matrix
     {
-        Matrix() = default;
-        Matrix(
+        constexpr Matrix() = default;
+        constexpr Matrix(
             const Vector3& xAxis,
             const Vector3& yAxis,
             const Vector3& zAxis,
-            const Vector3& t);
+            const Vector3& t) :
+            Matrix({xAxis, 0}, {yAxis, 0}, {zAxis, 0}, {t, 1})
+        {
+        }
 
-        Matrix(
+        constexpr Matrix(
             const Vector4& xAxis,
             const Vector4& yAxis,
             const Vector4& zAxis,
-            const Vector4& t);
-
-        Matrix(const Matrix& m);
-
-        Vector3 TransformVector(const Vector3& v) const;
-        Vector3 TransformVector(float x, float y, float z) const;
-        Vector3 TransformPoint(const Vector3& p) const;
-        Vector3 TransformPoint(float x, float y, float z) const;
-        const Matrix& Transpose();
-
-        Vector3 GetAxisX() const;
-        Vector3 GetAxisY() const;
-        Vector3 GetAxisZ() const;
-        Vector3 GetTranslation() const;
-
-        static Matrix CreateTranslation(float x, float y, float z);
-        static Matrix CreateTranslation(const Vector3& t);
-        static Matrix CreateRotationX(float pitch);
-        static Matrix CreateRotationY(float yaw);
-        static Matrix CreateRotationZ(float roll);
-        static Matrix CreateRotation(float pitch, float yaw, float roll);
-        static Matrix CreateRotation(const Vector3& r);
-        static Matrix CreateScale(float sx, float sy, float sz);
-        static Matrix CreateScale(const Vector3& s);
-        static Matrix Transpose(const Matrix& m);
-
-        Vector4& operator[](int index);
-        Vector4 operator[](int index) const;
-        Matrix operator*(const Matrix& m) const;
-        const Matrix& operator*=(const Matrix& m);
+            const Vector4& t)
+        {
+            data[0] = xAxis;
+            data[1] = yAxis;
+            data[2] = zAxis;
+            data[3] = t;
+        }
+
+        constexpr Matrix(const Matrix& m) = default;
+        constexpr Matrix& operator=(const Matrix& m) = default;
+
+        Vector3 TransformVector(const Vector3& v) const
+        {
+            return TransformVector(v.x, v.y, v.z);
+        }
+
+        Vector3 TransformVector(float x, float y, float z) const
+        {
+#if SIMD_MATH
+            __m128 result{_mm_mul_ps(data[0].Load(), _mm_set1_ps(x))};
+            result = _mm_add_ps(result, _mm_mul_ps(data[1].Load(), _mm_set1_ps(y)));
+            result = _mm_add_ps(result, _mm_mul_ps(data[2].Load(), _mm_set1_ps(z)));
+            return ToVector3(result);
+#else
+            return Vector3{
+                data[0].x * x + data[1].x * y + data[2].x * z,
+                data[0].y * x + data[1].y * y + data[2].y * z,
+                data[0].z * x + data[1].z * y + data[2].z * z
+            };
+#endif
+        }
+
+        Vector3 TransformPoint(const Vector3& p) const
+        {
+            return TransformPoint(p.x, p.y, p.z);
+        }
+
+        Vector3 TransformPoint(float x, float y, float z) const
+        {
+#if SIMD_MATH
+            __m128 result{_mm_mul_ps(data[0].Load(), _mm_set1_ps(x))};
+            result = _mm_add_ps(result, _mm_mul_ps(data[1].Load(), _mm_set1_ps(y)));
+            result = _mm_add_ps(result, _mm_mul_ps(data[2].Load(), _mm_set1_ps(z)));
+            result = _mm_add_ps(result, data[3].Load());
+            return ToVector3(result);
+#else
+            return Vector3{
+                data[0].x * x + data[1].x * y + data[2].x * z + data[3].x,
+                data[0].y * x + data[1].y * y + data[2].y * z + data[3].y,
+                data[0].z * x + data[1].z * y + data[2].z * z + data[3].z,
+            };
+#endif
+        }
+
+        const Matrix& Transpose()
+        {
+#if SIMD_MATH
+            __m128 row0{data[0].Load()};
+            __m128 row1{data[1].Load()};
+            __m128 row2{data[2].Load()};
+            __m128 row3{data[3].Load()};
+            _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+            data[0].Store(row0);
+            data[1].Store(row1);
+            data[2].Store(row2);
+            data[3].Store(row3);
+#else
+            Matrix result{};
+            for (int r{0}; r < 4; ++r)
+            {
+                for (int c{0}; c < 4; ++c)
+                {
+                    result[r][c] = data[c][r];
+                }
+            }
+
+            data[0] = result[0];
+            data[1] = result[1];
+            data[2] = result[2];
+            data[3] = result[3];
+#endif
+
+            return *this;
+        }
+
+        const Matrix& Inverse()
+        {
+            //Cofactor expansion with 2x2 sub-determinants of the upper and lower two rows
+            const Matrix m{*this};
+
+            const float s0{m[0][0] * m[1][1] - m[1][0] * m[0][1]};
+            const float s1{m[0][0] * m[1][2] - m[1][0] * m[0][2]};
+            const float s2{m[0][0] * m[1][3] - m[1][0] * m[0][3]};
+            const float s3{m[0][1] * m[1][2] - m[1][1] * m[0][2]};
+            const float s4{m[0][1] * m[1][3] - m[1][1] * m[0][3]};
+            const float s5{m[0][2] * m[1][3] - m[1][2] * m[0][3]};
+
+            const float c5{m[2][2] * m[3][3] - m[3][2] * m[2][3]};
+            const float c4{m[2][1] * m[3][3] - m[3][1] * m[2][3]};
+            const float c3{m[2][1] * m[3][2] - m[3][1] * m[2][2]};
+            const float c2{m[2][0] * m[3][3] - m[3][0] * m[2][3]};
+            const float c1{m[2][0] * m[3][2] - m[3][0] * m[2][2]};
+            const float c0{m[2][0] * m[3][1] - m[3][0] * m[2][1]};
+
+            const float det{s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0};
+            assert(det != 0.0f && "Matrix is not invertible");
+            const float invDet{1.0f / det};
+
+            data[0] = {
+                (m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * invDet,
+                (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * invDet,
+                (m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * invDet,
+                (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * invDet
+            };
+            data[1] = {
+                (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * invDet,
+                (m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * invDet,
+                (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * invDet,
+                (m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * invDet
+            };
+            data[2] = {
+                (m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * invDet,
+                (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * invDet,
+                (m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * invDet,
+                (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * invDet
+            };
+            data[3] = {
+                (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * invDet,
+                (m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * invDet,
+                (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * invDet,
+                (m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * invDet
+            };
+
+            return *this;
+        }
+
+        constexpr Vector3 GetAxisX() const
+        {
+            return data[0];
+        }
+
+        constexpr Vector3 GetAxisY() const
+        {
+            return data[1];
+        }
+
+        constexpr Vector3 GetAxisZ() const
+        {
+            return data[2];
+        }
+
+        constexpr Vector3 GetTranslation() const
+        {
+            return data[3];
+        }
+
+        static constexpr Matrix CreateTranslation(float x, float y, float z)
+        {
+            Matrix out{};
+            out[3] = {x, y, z, 1.0f};
+            return out;
+        }
+
+        static constexpr Matrix CreateTranslation(const Vector3& t)
+        {
+            return {Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, t};
+        }
+
+        static Matrix CreateRotationX(float pitch)
+        {
+            Matrix out{};
+            out[0] = {1.0f, 0.0f, 0.0f, 0.0f};
+            out[1] = {0.0f, cosf(pitch), sinf(pitch), 0.0f};
+            out[2] = {0.0f, -sinf(pitch), cosf(pitch), 0.0f};
+            out[3] = {0.0f, 0.0f, 0.0f, 1.0f};
+            return out;
+        }
+
+        static Matrix CreateRotationY(float yaw)
+        {
+            Matrix out{};
+            out[0] = {cosf(yaw), 0.0f, -sinf(yaw), 0.0f};
+            out[1] = {0.0f, 1.0f, 0.0f, 0.0f};
+            out[2] = {sinf(yaw), 0.0f, cosf(yaw), 0.0f};
+            out[3] = {0.0f, 0.0f, 0.0f, 1.0f};
+            return out;
+        }
+
+        static Matrix CreateRotationZ(float roll)
+        {
+            Matrix out{};
+            out[0] = {cosf(roll), sinf(roll), 0.0f, 0.0f};
+            out[1] = {-sinf(roll), cosf(roll), 0.0f, 0.0f};
+            out[2] = {0.0f, 0.0f, 1.0f, 0.0f};
+            out[3] = {0.0f, 0.0f, 0.0f, 1.0f};
+            return out;
+        }
+
+        static Matrix CreateRotation(float pitch, float yaw, float roll)
+        {
+            return CreateRotation({pitch, yaw, roll});
+        }
+
+        static Matrix CreateRotation(const Vector3& r)
+        {
+            return CreateRotationX(r.x) * CreateRotationY(r.y) * CreateRotationZ(r.z);
+        }
+
+        static constexpr Matrix CreateScale(float sx, float sy, float sz)
+        {
+            Matrix out{};
+            out[0] = {sx, 0.0f, 0.0f, 0.0f};
+            out[1] = {0.0f, sy, 0.0f, 0.0f};
+            out[2] = {0.0f, 0.0f, sz, 0.0f};
+            out[3] = {0.0f, 0.0f, 0.0f, 1.0f};
+            return out;
+        }
+
+        static constexpr Matrix CreateScale(const Vector3& s)
+        {
+            return CreateScale(s.x, s.y, s.z);
+        }
+
+        static Matrix Transpose(const Matrix& m)
+        {
+            Matrix out{m};
+            out.Transpose();
+
+            return out;
+        }
+
+        static Matrix Inverse(const Matrix& m)
+        {
+            Matrix out{m};
+            out.Inverse();
+
+            return out;
+        }
+
+#pragma region Operator Overloads
+        constexpr Vector4& operator[](int index)
+        {
+            assert(index <= 3 && index >= 0);
+            return data[index];
+        }
+
+        constexpr Vector4 operator[](int index) const
+        {
+            assert(index <= 3 && index >= 0);
+            return data[index];
+        }
+
+        Matrix operator*(const Matrix& m) const
+        {
+            Matrix result{*this};
+            result *= m;
+            return result;
+        }
+
+        const Matrix& operator*=(const Matrix& m)
+        {
+#if SIMD_MATH
+            //Every result row is a combination of the rows of m, weighted by the elements of our row
+            const __m128 mRow0{m.data[0].Load()};
+            const __m128 mRow1{m.data[1].Load()};
+            const __m128 mRow2{m.data[2].Load()};
+            const __m128 mRow3{m.data[3].Load()};
+            for (Vector4& row : data)
+            {
+                __m128 result{_mm_mul_ps(_mm_set1_ps(row.x), mRow0)};
+                result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(row.y), mRow1));
+                result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(row.z), mRow2));
+                result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(row.w), mRow3));
+                row.Store(result);
+            }
+#else
+            Matrix copy{*this};
+            Matrix m_transposed = Transpose(m);
+
+            for (int r{0}; r < 4; ++r)
+            {
+                for (int c{0}; c < 4; ++c)
+                {
+                    data[r][c] = Vector4::Dot(copy[r], m_transposed[c]);
+                }
+            }
+#endif
+
+            return *this;
+        }
+#pragma endregion
 
     private:
         //Row-Major Matrix
@@ -63,7 +335,21 @@ namespace dae
         // v1x v1y v1z v1w
         // v2x v2y v2z v2w
         // v3x v3y v3z v3w
+
+#if SIMD_MATH
+        static Vector3 ToVector3(__m128 v)
+        {
+            alignas(16) float values[4];
+            _mm_store_ps(values, v);
+            return {values[0], values[1], values[2]};
+        }
+#endif
+
     public:
-        friend std::ostream& operator<<(std::ostream& os, const Matrix& m);
+        friend std::ostream& operator<<(std::ostream& os, const Matrix& m)
+        {
+            os << '[' << m[0] << ",\n " << m[1] << ",\n " << m[2] << ",\n " << m[3] << ']';
+            return os;
+        }
     };
 }
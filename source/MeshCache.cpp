@@ -0,0 +1,339 @@
+#include "MeshCache.h"
+#include "DataTypes.h"
+#include "MappedFile.h"
+#include "Macros.h"
+
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace dae
+{
+    namespace
+    {
+        constexpr char     MAGIC[8]          {'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0'};
+        constexpr uint32_t VERSION           {1};
+        constexpr uint64_t SECTION_ALIGNMENT {64};
+
+        constexpr uint32_t FLAG_BVH             {1 << 0};
+        constexpr uint32_t FLAG_TRIANGLE_BLOCKS {1 << 1};
+
+#if TRIANGLE_BLOCKS
+        constexpr uint32_t LEAF_BATCH_SIZE{TriangleBlock::size};
+#else
+        constexpr uint32_t LEAF_BATCH_SIZE{1};
+#endif
+
+        enum Section : uint32_t
+        {
+            Positions,
+            Normals,
+            Indices,
+            BVHNodes,
+            BVHPrimIndices,
+            TriangleBlocks,
+            LeafFirstBlocks,
+            SectionCount
+        };
+
+        /**
+         * \brief Byte range of one array, offset is a multiple of SECTION_ALIGNMENT
+         */
+        struct SectionRange
+        {
+            uint64_t offset {0};
+            uint64_t size   {0};
+        };
+
+        /**
+         * \brief The node and block sizes guard against a cache written by a build with a different layout
+         */
+        struct Header
+        {
+            char         magic[8]               {};
+            uint32_t     version                {0};
+            uint32_t     flags                  {0};
+            uint64_t     contentHash            {0};
+            uint64_t     contentSize            {0};
+            uint32_t     nodeSize               {0};
+            uint32_t     blockSize              {0};
+            uint32_t     leafBatchSize          {0};
+            uint32_t     padding                {0};
+            Vector3      minAABB                {};
+            Vector3      maxAABB                {};
+            SectionRange sections[SectionCount] {};
+        };
+
+        /**
+         * \brief 64-bit FNV-1a over 8 byte words, rotated after every word so the high bits feed back into the low ones
+         */
+        uint64_t HashContent(const char* pData, size_t size)
+        {
+            constexpr uint64_t FNV_OFFSET_BASIS{0xcbf29ce484222325ull};
+            constexpr uint64_t FNV_PRIME{0x100000001b3ull};
+
+            uint64_t hash{FNV_OFFSET_BASIS ^ size};
+            size_t idx{0};
+            for (; idx + sizeof(uint64_t) <= size; idx += sizeof(uint64_t))
+            {
+                uint64_t word;
+                std::memcpy(&word, pData + idx, sizeof(uint64_t));
+                hash = std::rotl((hash ^ word) * FNV_PRIME, 31);
+            }
+            if (idx < size)
+            {
+                uint64_t word{0};
+                std::memcpy(&word, pData + idx, size - idx);
+                hash = std::rotl((hash ^ word) * FNV_PRIME, 31);
+            }
+
+            //Final avalanche of MurmurHash3
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdull;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ull;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        uint64_t AlignUp(uint64_t offset)
+        {
+            return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+        }
+
+        /**
+         * \brief Points pData at the array of the section inside the mapped file
+         * \return false if the section is misaligned, out of bounds or not a whole number of elements
+         */
+        template <typename T>
+        bool GetSection(const MappedFile& file, const Header& header, Section section, const T*& pData, size_t& count)
+        {
+            const SectionRange& range{header.sections[section]};
+            if (range.offset % SECTION_ALIGNMENT != 0 or range.size % sizeof(T) != 0) return false;
+            if (range.offset > file.GetSize() or range.size > file.GetSize() - range.offset) return false;
+
+            pData = reinterpret_cast<const T*>(file.GetData() + range.offset);
+            count = static_cast<size_t>(range.size / sizeof(T));
+            return true;
+        }
+
+        /**
+         * \brief One pass over the nodes, a corrupt tree must not send the traversal out of bounds \n
+         * Children are always stored after their parent, which also rules out cycles and lets the depth be tracked on the way
+         */
+        bool IsValidBVH(const BVHNode* pNodes, size_t nodeCount, const uint32_t* pPrimIndices, size_t primIndexCount,
+            size_t triangleCount)
+        {
+            if (nodeCount == 0) return triangleCount == 0;
+            for (size_t idx{0}; idx < primIndexCount; ++idx)
+            {
+                if (pPrimIndices[idx] >= triangleCount) return false;
+            }
+
+            std::vector<uint32_t> depths(nodeCount, 0);
+            for (size_t nodeIdx{0}; nodeIdx < nodeCount; ++nodeIdx)
+            {
+                const BVHNode& node{pNodes[nodeIdx]};
+                if (node.IsLeaf())
+                {
+                    if (static_cast<uint64_t>(node.leftFirst) + node.primCount > primIndexCount) return false;
+                    continue;
+                }
+
+                if (node.leftFirst <= nodeIdx or static_cast<uint64_t>(node.leftFirst) + 1 >= nodeCount) return false;
+                if (depths[nodeIdx] >= BVH::maxDepth) return false;
+                for (uint32_t childIdx{node.leftFirst}; childIdx <= node.leftFirst + 1; ++childIdx)
+                {
+                    if (depths[childIdx] < depths[nodeIdx] + 1) depths[childIdx] = depths[nodeIdx] + 1;
+                }
+            }
+            return true;
+        }
+
+#if TRIANGLE_BLOCKS
+        /**
+         * \brief Every leaf has to own a whole range of blocks, see TriangleMesh::leafFirstBlock \n
+         * Each lane of those blocks has to name an existing triangle, and the padding lanes after the last one must never hit
+         */
+        bool IsValidTriangleBlocks(const BVHNode* pNodes, size_t nodeCount, const uint32_t* pLeafFirstBlocks,
+                                   const TriangleBlock* pBlocks, size_t blockCount, size_t triangleCount)
+        {
+            for (size_t nodeIdx{0}; nodeIdx < nodeCount; ++nodeIdx)
+            {
+                const BVHNode& node{pNodes[nodeIdx]};
+                if (not node.IsLeaf()) continue;
+
+                const uint64_t leafBlockCount{(static_cast<uint64_t>(node.primCount) + TriangleBlock::size - 1) / TriangleBlock::size};
+                if (pLeafFirstBlocks[nodeIdx] + leafBlockCount > blockCount) return false;
+
+                for (uint32_t idx{0}; idx < leafBlockCount * TriangleBlock::size; ++idx)
+                {
+                    const TriangleBlock& block{pBlocks[pLeafFirstBlocks[nodeIdx] + idx / TriangleBlock::size]};
+                    const uint32_t lane{idx % TriangleBlock::size};
+                    if (block.triangleIndices[lane] >= triangleCount) return false;
+
+                    const bool isPadding{idx >= node.primCount};
+                    if (isPadding and (block.e1x[lane] != 0.0f or block.e1y[lane] != 0.0f or block.e1z[lane] != 0.0f or
+                                       block.e2x[lane] != 0.0f or block.e2y[lane] != 0.0f or block.e2z[lane] != 0.0f))
+                        return false;
+                }
+            }
+            return true;
+        }
+#endif
+
+        template <typename T>
+        void WriteSection(std::ofstream& file, const SectionRange& range, const std::vector<T>& data)
+        {
+            static constexpr char padding[SECTION_ALIGNMENT]{};
+            const uint64_t position{static_cast<uint64_t>(file.tellp())};
+            file.write(padding, static_cast<std::streamsize>(range.offset - position));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(range.size));
+        }
+    }
+
+    MeshCache::MeshCache(const std::string& objFilePath)
+        : m_CachePath{objFilePath + ".meshcache"}
+    {
+        MappedFile file{};
+        if (not file.Open(objFilePath)) return;
+
+        m_ContentHash = HashContent(file.GetData(), file.GetSize());
+        m_ContentSize = file.GetSize();
+        m_IsHashed = true;
+    }
+
+    bool MeshCache::Load(TriangleMesh& mesh) const
+    {
+        if (not m_IsHashed) return false;
+
+        MappedFile file{};
+        if (not file.Open(m_CachePath) or file.GetSize() < sizeof(Header)) return false;
+
+        Header header{};
+        std::memcpy(&header, file.GetData(), sizeof(Header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 or header.version != VERSION or
+            header.contentHash != m_ContentHash or header.contentSize != m_ContentSize or
+            header.nodeSize != sizeof(BVHNode) or header.blockSize != sizeof(TriangleBlock))
+            return false;
+
+        const Vector3* pPositions;
+        const Vector3* pNormals;
+        const int* pIndices;
+        size_t positionCount, normalCount, indexCount;
+        if (not GetSection(file, header, Positions, pPositions, positionCount) or
+            not GetSection(file, header, Normals, pNormals, normalCount) or
+            not GetSection(file, header, Indices, pIndices, indexCount))
+            return false;
+        if (indexCount % 3 != 0 or normalCount != indexCount / 3) return false;
+        for (size_t idx{0}; idx < indexCount; ++idx)
+        {
+            if (pIndices[idx] < 0 or static_cast<size_t>(pIndices[idx]) >= positionCount) return false;
+        }
+
+        //A tree built for another leaf size (TRIANGLE_BLOCKS changed) or one that fails validation is rebuilt instead
+        const BVHNode* pNodes{nullptr};
+        const uint32_t* pPrimIndices{nullptr};
+        size_t nodeCount{0}, primIndexCount{0};
+        const bool hasBVH{
+            (header.flags & FLAG_BVH) != 0 and header.leafBatchSize == LEAF_BATCH_SIZE and
+            GetSection(file, header, BVHNodes, pNodes, nodeCount) and
+            GetSection(file, header, BVHPrimIndices, pPrimIndices, primIndexCount) and
+            primIndexCount == indexCount / 3 and
+            IsValidBVH(pNodes, nodeCount, pPrimIndices, primIndexCount, indexCount / 3)
+        };
+
+        mesh.positions.assign(pPositions, pPositions + positionCount);
+        mesh.normals.assign(pNormals, pNormals + normalCount);
+        mesh.indices.assign(pIndices, pIndices + indexCount);
+        mesh.minAABB = header.minAABB;
+        mesh.maxAABB = header.maxAABB;
+
+        if (hasBVH)
+        {
+            mesh.bvh.leafBatchSize = LEAF_BATCH_SIZE;
+            mesh.bvh.Assign(pNodes, nodeCount, pPrimIndices, primIndexCount);
+        }
+        else mesh.UpdateBVH(mesh.positions);
+
+#if TRIANGLE_BLOCKS
+        const TriangleBlock* pBlocks{nullptr};
+        const uint32_t* pLeafFirstBlocks{nullptr};
+        size_t blockCount{0}, leafCount{0};
+        if (hasBVH and (header.flags & FLAG_TRIANGLE_BLOCKS) != 0 and
+            GetSection(file, header, TriangleBlocks, pBlocks, blockCount) and
+            GetSection(file, header, LeafFirstBlocks, pLeafFirstBlocks, leafCount) and leafCount == nodeCount and
+            IsValidTriangleBlocks(pNodes, nodeCount, pLeafFirstBlocks, pBlocks, blockCount, indexCount / 3))
+        {
+            mesh.triangleBlocks.assign(pBlocks, pBlocks + blockCount);
+            mesh.leafFirstBlock.assign(pLeafFirstBlocks, pLeafFirstBlocks + leafCount);
+        }
+        else mesh.UpdateTriangleBlocks(mesh.positions);
+#endif
+
+        return true;
+    }
+
+    bool MeshCache::Save(const TriangleMesh& mesh) const
+    {
+        if (not m_IsHashed) return false;
+
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.contentHash = m_ContentHash;
+        header.contentSize = m_ContentSize;
+        header.nodeSize = sizeof(BVHNode);
+        header.blockSize = sizeof(TriangleBlock);
+        header.leafBatchSize = mesh.bvh.leafBatchSize;
+        header.minAABB = mesh.minAABB;
+        header.maxAABB = mesh.maxAABB;
+        if (not mesh.bvh.IsEmpty()) header.flags |= FLAG_BVH;
+        if (not mesh.triangleBlocks.empty()) header.flags |= FLAG_TRIANGLE_BLOCKS;
+
+        const uint64_t sectionSizes[SectionCount]
+        {
+            mesh.positions.size() * sizeof(Vector3),
+            mesh.normals.size() * sizeof(Vector3),
+            mesh.indices.size() * sizeof(int),
+            mesh.bvh.nodes.size() * sizeof(BVHNode),
+            mesh.bvh.primIndices.size() * sizeof(uint32_t),
+            mesh.triangleBlocks.size() * sizeof(TriangleBlock),
+            mesh.leafFirstBlock.size() * sizeof(uint32_t)
+        };
+        uint64_t offset{AlignUp(sizeof(Header))};
+        for (uint32_t section{0}; section < SectionCount; ++section)
+        {
+            header.sections[section] = {offset, sectionSizes[section]};
+            offset = AlignUp(offset + sectionSizes[section]);
+        }
+
+        const std::string tempPath{m_CachePath + ".tmp"};
+        bool isWritten{false};
+        {
+            std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+            if (not file) return false;
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            WriteSection(file, header.sections[Positions], mesh.positions);
+            WriteSection(file, header.sections[Normals], mesh.normals);
+            WriteSection(file, header.sections[Indices], mesh.indices);
+            WriteSection(file, header.sections[BVHNodes], mesh.bvh.nodes);
+            WriteSection(file, header.sections[BVHPrimIndices], mesh.bvh.primIndices);
+            WriteSection(file, header.sections[TriangleBlocks], mesh.triangleBlocks);
+            WriteSection(file, header.sections[LeafFirstBlocks], mesh.leafFirstBlock);
+            file.close();
+            isWritten = not file.fail();
+        }
+
+        std::error_code error{};
+        if (isWritten) std::filesystem::rename(tempPath, m_CachePath, error);
+        if (not isWritten or error)
+        {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+    struct TriangleMesh;
+
+    /**
+     * \brief Binary copy of a parsed OBJ mesh next to the OBJ itself (lowpoly_bunny.obj.meshcache), see MESH_CACHE \n
+     * A header followed by 64 byte aligned position, normal, index, BVH and triangle block arrays, in the in-memory layout \n
+     * The cache is only used while the content hash of the OBJ and the layout of the arrays still match, otherwise it is rebuilt
+     */
+    class MeshCache final
+    {
+    public:
+        /**
+         * \brief Hashes the content of the OBJ file, a missing file makes Load and Save fail
+         */
+        explicit MeshCache(const std::string& objFilePath);
+        ~MeshCache() = default;
+
+        MeshCache(const MeshCache&) = delete;
+        MeshCache(MeshCache&&) noexcept = delete;
+        MeshCache& operator=(const MeshCache&) = delete;
+        MeshCache& operator=(MeshCache&&) noexcept = delete;
+
+        /**
+         * \brief Maps the cache file and fills the object space data of the mesh: positions, normals, indices, AABB, BVH and triangle blocks \n
+         * A cache without BVH or triangle blocks is completed by building them
+         * \return false if there is no valid cache for the current OBJ content, the mesh is untouched then
+         */
+        bool Load(TriangleMesh& mesh) const;
+
+        /**
+         * \brief Writes the object space data of the mesh, through a temporary file so a crash never leaves a half-written cache
+         */
+        bool Save(const TriangleMesh& mesh) const;
+
+        const std::string& GetCachePath() const { return m_CachePath; }
+
+    private:
+        std::string m_CachePath   {};
+        uint64_t    m_ContentHash {0};
+        uint64_t    m_ContentSize {0};
+        bool        m_IsHashed    {false};
+    };
+}
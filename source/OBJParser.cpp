@@ -0,0 +1,350 @@
+#include "OBJParser.h"
+#include "MappedFile.h"
+#include "Macros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <execution>
+
+namespace dae
+{
+    namespace OBJParser
+    {
+        namespace
+        {
+            //Large enough that a chunk costs next to nothing to set up, small enough to give every core work on big meshes
+            constexpr size_t CHUNK_SIZE{1 << 20};
+
+            constexpr double POWERS_OF_TEN[]
+            {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+            constexpr int MAX_EXACT_POWER{22};
+            constexpr int MAX_MANTISSA_DIGITS{19};
+
+            /**
+             * \brief Lines [pBegin, pEnd) of the file, parsed on their own \n
+             * A negative face index refers to the vertices before it, which may be in an earlier chunk: it is stored
+             * relative to the first vertex of this chunk and fixed once the chunk offsets are known
+             */
+            struct Chunk
+            {
+                const char*          pBegin          {nullptr};
+                const char*          pEnd            {nullptr};
+                std::vector<Vector3> positions       {};
+                std::vector<int>     indices         {};
+                std::vector<size_t>  relativeIndices {};
+                size_t               positionOffset  {0};
+                size_t               indexOffset     {0};
+                bool                 isValid         {true};
+            };
+
+            /**
+             * \brief Index of one face corner, see Chunk
+             */
+            struct Corner
+            {
+                int  index      {0};
+                bool isRelative {false};
+            };
+
+            bool IsBlank(char c)
+            {
+                return c == ' ' or c == '\t';
+            }
+
+            const char* SkipBlanks(const char* pText, const char* pEnd)
+            {
+                while (pText < pEnd and IsBlank(*pText)) ++pText;
+                return pText;
+            }
+
+            /**
+             * \return the first character of the next line
+             */
+            const char* SkipLine(const char* pText, const char* pEnd)
+            {
+                const void* pNewLine{std::memchr(pText, '\n', static_cast<size_t>(pEnd - pText))};
+                return pNewLine == nullptr ? pEnd : static_cast<const char*>(pNewLine) + 1;
+            }
+
+            bool IsCommand(const char* pText, const char* pEnd, char command)
+            {
+                return pText + 1 < pEnd and pText[0] == command and IsBlank(pText[1]);
+            }
+
+            /**
+             * \brief [sign] digits [. digits] [e [sign] digits], the same decimal notation std::strtof reads \n
+             * Up to 19 significant digits and an exponent within 10^±22 are converted with a single exact operation
+             */
+            bool ParseFloat(const char*& pText, const char* pEnd, float& value)
+            {
+                const char* p{pText};
+                const bool isNegative{p < pEnd and *p == '-'};
+                if (p < pEnd and (*p == '-' or *p == '+')) ++p;
+
+                uint64_t mantissa{0};
+                int digitCount{0};
+                int exponent{0};
+                bool hasDigits{false};
+                for (; p < pEnd and *p >= '0' and *p <= '9'; ++p)
+                {
+                    hasDigits = true;
+                    if (digitCount < MAX_MANTISSA_DIGITS)
+                    {
+                        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                        if (mantissa != 0) ++digitCount;
+                    }
+                    else ++exponent;
+                }
+                if (p < pEnd and *p == '.')
+                {
+                    for (++p; p < pEnd and *p >= '0' and *p <= '9'; ++p)
+                    {
+                        hasDigits = true;
+                        if (digitCount < MAX_MANTISSA_DIGITS)
+                        {
+                            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                            if (mantissa != 0) ++digitCount;
+                            --exponent;
+                        }
+                    }
+                }
+                if (not hasDigits) return false;
+
+                if (p < pEnd and (*p == 'e' or *p == 'E'))
+                {
+                    const char* pExponent{p + 1};
+                    const bool isExponentNegative{pExponent < pEnd and *pExponent == '-'};
+                    if (pExponent < pEnd and (*pExponent == '-' or *pExponent == '+')) ++pExponent;
+                    if (pExponent < pEnd and *pExponent >= '0' and *pExponent <= '9')
+                    {
+                        int exponentValue{0};
+                        for (; pExponent < pEnd and *pExponent >= '0' and *pExponent <= '9'; ++pExponent)
+                        {
+                            if (exponentValue < 10000) exponentValue = exponentValue * 10 + (*pExponent - '0');
+                        }
+                        exponent += isExponentNegative ? -exponentValue : exponentValue;
+                        p = pExponent;
+                    }
+                }
+
+                double result{static_cast<double>(mantissa)};
+                if (exponent < 0 and exponent >= -MAX_EXACT_POWER) result /= POWERS_OF_TEN[-exponent];
+                else if (exponent > 0 and exponent <= MAX_EXACT_POWER) result *= POWERS_OF_TEN[exponent];
+                else if (exponent != 0) result *= std::pow(10.0, exponent);
+
+                value = static_cast<float>(isNegative ? -result : result);
+                pText = p;
+                return true;
+            }
+
+            bool ParseInt(const char*& pText, const char* pEnd, int& value)
+            {
+                const char* p{pText};
+                const bool isNegative{p < pEnd and *p == '-'};
+                if (p < pEnd and (*p == '-' or *p == '+')) ++p;
+
+                int64_t result{0};
+                const char* pDigits{p};
+                for (; p < pEnd and *p >= '0' and *p <= '9'; ++p)
+                {
+                    result = result * 10 + (*p - '0');
+                    if (result > INT32_MAX) return false;
+                }
+                if (p == pDigits) return false;
+
+                value = static_cast<int>(isNegative ? -result : result);
+                pText = p;
+                return true;
+            }
+
+            /**
+             * \brief Reserves the exact vertex count and the triangle count of a triangulated mesh
+             */
+            void ReserveChunk(Chunk& chunk)
+            {
+                size_t vertexCount{0};
+                size_t faceCount{0};
+                for (const char* pLine{chunk.pBegin}; pLine < chunk.pEnd; pLine = SkipLine(pLine, chunk.pEnd))
+                {
+                    const char* pText{SkipBlanks(pLine, chunk.pEnd)};
+                    if (IsCommand(pText, chunk.pEnd, 'v')) ++vertexCount;
+                    else if (IsCommand(pText, chunk.pEnd, 'f')) ++faceCount;
+                }
+                chunk.positions.reserve(vertexCount);
+                chunk.indices.reserve(faceCount * 3);
+            }
+
+            bool ParseVertex(Chunk& chunk, const char* pText)
+            {
+                Vector3 position{};
+                for (int axis{0}; axis < 3; ++axis)
+                {
+                    pText = SkipBlanks(pText, chunk.pEnd);
+                    if (not ParseFloat(pText, chunk.pEnd, position[axis])) return false;
+                }
+                chunk.positions.push_back(position);
+                return true;
+            }
+
+            void AddCorner(Chunk& chunk, const Corner& corner)
+            {
+                if (corner.isRelative) chunk.relativeIndices.push_back(chunk.indices.size());
+                chunk.indices.push_back(corner.index);
+            }
+
+            /**
+             * \brief v, v/vt, v//vn or v/vt/vn corners, a polygon becomes the fan (0, n - 1, n)
+             */
+            bool ParseFace(Chunk& chunk, const char* pText)
+            {
+                Corner first{};
+                Corner previous{};
+                int cornerCount{0};
+                while (true)
+                {
+                    pText = SkipBlanks(pText, chunk.pEnd);
+                    if (pText == chunk.pEnd or *pText == '\r' or *pText == '\n' or *pText == '#') break;
+
+                    int objIndex{0};
+                    if (not ParseInt(pText, chunk.pEnd, objIndex) or objIndex == 0) return false;
+                    //Texture and normal indices are not used
+                    while (pText < chunk.pEnd and not IsBlank(*pText) and *pText != '\r' and *pText != '\n') ++pText;
+
+                    Corner corner{};
+                    if (objIndex > 0) corner.index = objIndex - 1;
+                    else
+                    {
+                        corner.index = static_cast<int>(chunk.positions.size()) + objIndex;
+                        corner.isRelative = true;
+                    }
+
+                    if (cornerCount == 0) first = corner;
+                    else if (cornerCount >= 2)
+                    {
+                        AddCorner(chunk, first);
+                        AddCorner(chunk, previous);
+                        AddCorner(chunk, corner);
+                    }
+                    previous = corner;
+                    ++cornerCount;
+                }
+                return cornerCount >= 3;
+            }
+
+            void ParseChunk(Chunk& chunk)
+            {
+                ReserveChunk(chunk);
+                for (const char* pLine{chunk.pBegin}; pLine < chunk.pEnd; pLine = SkipLine(pLine, chunk.pEnd))
+                {
+                    const char* pText{SkipBlanks(pLine, chunk.pEnd)};
+                    if (IsCommand(pText, chunk.pEnd, 'v')) chunk.isValid = ParseVertex(chunk, pText + 2);
+                    else if (IsCommand(pText, chunk.pEnd, 'f')) chunk.isValid = ParseFace(chunk, pText + 2);
+                    //Comments, vt, vn, groups, objects and materials are skipped
+
+                    if (not chunk.isValid) return;
+                }
+            }
+
+            template <typename Function>
+            void ForEachChunk(std::vector<Chunk>& chunks, Function function)
+            {
+#if MULTITHREADING
+                std::for_each(std::execution::par, chunks.begin(), chunks.end(), function);
+#else
+                std::for_each(chunks.begin(), chunks.end(), function);
+#endif
+            }
+        }
+
+        bool Parse(const std::string& filename, std::vector<Vector3>& positions,
+                   std::vector<Vector3>& normals, std::vector<int>& indices)
+        {
+            MappedFile file{};
+            if (not file.Open(filename))
+                return false;
+
+            const char* pBegin{file.GetData()};
+            const char* pEnd{pBegin + file.GetSize()};
+
+            //Every chunk starts at the beginning of a line, the split point is moved to the next line break
+            const size_t chunkCount{std::max<size_t>(1, file.GetSize() / CHUNK_SIZE)};
+            std::vector<Chunk> chunks(chunkCount);
+            const char* pChunkBegin{pBegin};
+            for (size_t chunkIdx{0}; chunkIdx < chunkCount; ++chunkIdx)
+            {
+                const char* pChunkEnd{pEnd};
+                if (chunkIdx + 1 < chunkCount)
+                    pChunkEnd = SkipLine(std::max(pChunkBegin, pBegin + file.GetSize() * (chunkIdx + 1) / chunkCount), pEnd);
+
+                chunks[chunkIdx].pBegin = pChunkBegin;
+                chunks[chunkIdx].pEnd = pChunkEnd;
+                pChunkBegin = pChunkEnd;
+            }
+
+            ForEachChunk(chunks, ParseChunk);
+
+            size_t positionCount{0};
+            size_t indexCount{0};
+            for (Chunk& chunk : chunks)
+            {
+                if (not chunk.isValid) return false;
+
+                chunk.positionOffset = positionCount;
+                chunk.indexOffset = indexCount;
+                positionCount += chunk.positions.size();
+                indexCount += chunk.indices.size();
+            }
+            if (positionCount > static_cast<size_t>(INT32_MAX)) return false;
+
+            positions.resize(positionCount);
+            indices.resize(indexCount);
+            normals.resize(indexCount / 3);
+
+            ForEachChunk(chunks, [&positions, &indices](Chunk& chunk)
+            {
+                for (const size_t relativeIdx : chunk.relativeIndices)
+                {
+                    chunk.indices[relativeIdx] += static_cast<int>(chunk.positionOffset);
+                }
+                std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionOffset);
+                std::copy(chunk.indices.begin(), chunk.indices.end(), indices.begin() + chunk.indexOffset);
+            });
+
+            //Precompute normals, every chunk fills in the normals of its own triangles
+            const int vertexCount{static_cast<int>(positionCount)};
+            ForEachChunk(chunks, [&positions, &normals, &indices, vertexCount](Chunk& chunk)
+            {
+                for (size_t index{chunk.indexOffset}; index < chunk.indexOffset + chunk.indices.size(); index += 3)
+                {
+                    const int i0{indices[index]};
+                    const int i1{indices[index + 1]};
+                    const int i2{indices[index + 2]};
+                    if (std::min({i0, i1, i2}) < 0 or std::max({i0, i1, i2}) >= vertexCount)
+                    {
+                        chunk.isValid = false;
+                        return;
+                    }
+
+                    const Vector3 edgeV0V1{positions[i1] - positions[i0]};
+                    const Vector3 edgeV0V2{positions[i2] - positions[i0]};
+                    Vector3 normal{Vector3::Cross(edgeV0V1, edgeV0V2)};
+                    normal.Normalize();
+                    normals[index / 3] = normal;
+                }
+            });
+
+            if (std::all_of(chunks.begin(), chunks.end(), [](const Chunk& chunk) { return chunk.isValid; }))
+                return true;
+
+            positions.clear();
+            normals.clear();
+            indices.clear();
+            return false;
+        }
+    }
+}
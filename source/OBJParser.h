@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Vector3.h"
+
+#include <string>
+#include <vector>
+
+namespace dae
+{
+    namespace OBJParser
+    {
+        /**
+         * \brief Memory-maps the file and parses it in parallel chunks of lines \n
+         * Faces may use the v, v/vt, v//vn and v/vt/vn forms, negative (relative) indices and any number of corners, polygons become triangle fans \n
+         * Only positions are kept: normals get one flat normal per triangle, texture coordinates and vn are skipped
+         * \return false if the file can not be opened or a face uses a vertex that does not exist, the arrays are left empty then
+         */
+        bool Parse(const std::string& filename, std::vector<Vector3>& positions,
+                   std::vector<Vector3>& normals, std::vector<int>& indices);
+    }
+}
@@ -0,0 +1,542 @@
+#pragma once
+
+#include "Math.h"
+#include "DataTypes.h"
+
+#include <cstdint>
+#include <immintrin.h>
+
+namespace dae
+{
+    /**
+     * \brief Amount of rays traced together, one SSE lane per ray (2x2 pixels)
+     */
+    constexpr int PACKET_WIDTH{4};
+    constexpr int PACKET_FULL_MASK{(1 << PACKET_WIDTH) - 1};
+
+#pragma region Packet Math
+    namespace PacketMath
+    {
+        inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+        {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+
+        /**
+         * \brief Expands a movemask style bit mask (bit i = lane i) into an all-ones/all-zeros lane mask
+         */
+        inline __m128 LaneMask(int mask)
+        {
+            const __m128i bits{_mm_and_si128(_mm_set1_epi32(mask), _mm_setr_epi32(1, 2, 4, 8))};
+            return _mm_castsi128_ps(_mm_cmpgt_epi32(bits, _mm_setzero_si128()));
+        }
+
+        inline __m128 Abs(__m128 v)
+        {
+            return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+        }
+
+        /**
+         * \brief Smallest value of the lanes in mask, FLT_MAX if mask is empty
+         */
+        inline float HorizontalMin(__m128 v, __m128 mask)
+        {
+            v = Select(mask, v, _mm_set1_ps(FLT_MAX));
+            v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+            v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+            return _mm_cvtss_f32(v);
+        }
+    }
+
+    /**
+     * \brief Four Vector3s in SoA layout, the operations mirror Vector3 so packet and scalar results match
+     */
+    struct PacketVector3
+    {
+        __m128 x;
+        __m128 y;
+        __m128 z;
+
+        PacketVector3() = default;
+
+        PacketVector3(__m128 _x, __m128 _y, __m128 _z) :
+            x{_x}, y{_y}, z{_z}
+        {
+        }
+
+        explicit PacketVector3(const Vector3& v) :
+            x{_mm_set1_ps(v.x)}, y{_mm_set1_ps(v.y)}, z{_mm_set1_ps(v.z)}
+        {
+        }
+
+        PacketVector3 operator+(const PacketVector3& v) const
+        {
+            return {_mm_add_ps(x, v.x), _mm_add_ps(y, v.y), _mm_add_ps(z, v.z)};
+        }
+
+        PacketVector3 operator-(const PacketVector3& v) const
+        {
+            return {_mm_sub_ps(x, v.x), _mm_sub_ps(y, v.y), _mm_sub_ps(z, v.z)};
+        }
+
+        PacketVector3 operator*(__m128 scale) const
+        {
+            return {_mm_mul_ps(x, scale), _mm_mul_ps(y, scale), _mm_mul_ps(z, scale)};
+        }
+
+        static __m128 Dot(const PacketVector3& v1, const PacketVector3& v2)
+        {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(v1.x, v2.x), _mm_mul_ps(v1.y, v2.y)), _mm_mul_ps(v1.z, v2.z));
+        }
+
+        static PacketVector3 Cross(const PacketVector3& v1, const PacketVector3& v2)
+        {
+            return {
+                _mm_sub_ps(_mm_mul_ps(v1.y, v2.z), _mm_mul_ps(v1.z, v2.y)),
+                _mm_sub_ps(_mm_mul_ps(v1.z, v2.x), _mm_mul_ps(v1.x, v2.z)),
+                _mm_sub_ps(_mm_mul_ps(v1.x, v2.y), _mm_mul_ps(v1.y, v2.x))
+            };
+        }
+
+        /**
+         * \brief Row-vector transform, same operation order as Matrix::TransformPoint/TransformVector
+         */
+        static PacketVector3 Transform(const Matrix& m, const PacketVector3& v, bool isPoint)
+        {
+            const auto transformAxis = [&v, &m, isPoint](int axis)
+            {
+                __m128 result{
+                    _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0][axis]), v.x), _mm_mul_ps(_mm_set1_ps(m[1][axis]), v.y)),
+                        _mm_mul_ps(_mm_set1_ps(m[2][axis]), v.z))
+                };
+                if (isPoint) result = _mm_add_ps(result, _mm_set1_ps(m[3][axis]));
+                return result;
+            };
+            return {transformAxis(0), transformAxis(1), transformAxis(2)};
+        }
+
+        Vector3 GetLane(int lane) const
+        {
+            alignas(16) float xs[PACKET_WIDTH], ys[PACKET_WIDTH], zs[PACKET_WIDTH];
+            _mm_store_ps(xs, x);
+            _mm_store_ps(ys, y);
+            _mm_store_ps(zs, z);
+            return {xs[lane], ys[lane], zs[lane]};
+        }
+    };
+#pragma endregion
+
+#pragma region Ray Packet
+    /**
+     * \brief PACKET_WIDTH rays in SoA layout, traced together through the BVHs \n
+     * Lanes outside of active are finished (or were never valid) and are ignored by every hit test
+     */
+    struct RayPacket
+    {
+        RayPacket() = default;
+
+        /**
+         * \param rays One ray per lane
+         * \param activeMask Bit i set if rays[i] has to be traced
+         */
+        RayPacket(const Ray (&rays)[PACKET_WIDTH], int activeMask)
+        {
+            static_assert(sizeof(Ray) == 8 * sizeof(float), "A Ray is two rows of 4 floats");
+
+            //Row 0 of every ray is origin + min, row 1 direction + max, one transpose turns them into the SoA lanes
+            __m128 originRows[PACKET_WIDTH], directionRows[PACKET_WIDTH];
+            for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+            {
+                const float* pRay{reinterpret_cast<const float*>(&rays[lane])};
+                originRows[lane] = _mm_load_ps(pRay);
+                directionRows[lane] = _mm_load_ps(pRay + 4);
+            }
+            _MM_TRANSPOSE4_PS(originRows[0], originRows[1], originRows[2], originRows[3]);
+            _MM_TRANSPOSE4_PS(directionRows[0], directionRows[1], directionRows[2], directionRows[3]);
+
+            origin = {originRows[0], originRows[1], originRows[2]};
+            direction = {directionRows[0], directionRows[1], directionRows[2]};
+            min = originRows[3];
+            max = directionRows[3];
+            active = PacketMath::LaneMask(activeMask);
+            UpdateInvDirection();
+        }
+
+        PacketVector3 origin       {};
+        PacketVector3 direction    {};
+        PacketVector3 invDirection {};
+
+        __m128 min    {};
+        __m128 max    {};
+        __m128 active {};
+
+        void UpdateInvDirection()
+        {
+            const __m128 one{_mm_set1_ps(1.0f)};
+            invDirection = {_mm_div_ps(one, direction.x), _mm_div_ps(one, direction.y), _mm_div_ps(one, direction.z)};
+        }
+
+        int GetActiveMask() const { return _mm_movemask_ps(active); }
+
+        Ray GetRay(int lane) const
+        {
+            alignas(16) float mins[PACKET_WIDTH], maxs[PACKET_WIDTH];
+            _mm_store_ps(mins, min);
+            _mm_store_ps(maxs, max);
+            return {origin.GetLane(lane), direction.GetLane(lane), mins[lane], maxs[lane]};
+        }
+    };
+#pragma endregion
+
+    namespace GeometryUtils
+    {
+#pragma region Packet HitTests
+        //PACKET HIT-TESTS
+        //Every test returns a bit mask of the lanes that hit between min and max, t receives the distances
+
+        inline int HitTest_SpherePacket(const Sphere& sphere, const RayPacket& packet, __m128& t)
+        {
+            const PacketVector3 L{packet.origin - PacketVector3{sphere.origin}};
+
+            const __m128 B{PacketVector3::Dot(packet.direction, L)};
+            const __m128 C{_mm_sub_ps(PacketVector3::Dot(L, L), _mm_set1_ps(sphere.radius * sphere.radius))};
+            const __m128 zero{_mm_setzero_ps()};
+
+            const __m128 discriminant{_mm_sub_ps(_mm_mul_ps(B, B), C)};
+            __m128 mask{_mm_andnot_ps(_mm_and_ps(_mm_cmpgt_ps(C, zero), _mm_cmpgt_ps(B, zero)), packet.active)};
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(discriminant, zero));
+            if (_mm_movemask_ps(mask) == 0) return 0;
+
+            t = _mm_sub_ps(_mm_sub_ps(zero, B), _mm_sqrt_ps(_mm_max_ps(discriminant, zero)));
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(t, packet.min), _mm_cmple_ps(t, packet.max)));
+            return _mm_movemask_ps(mask);
+        }
+
+        inline int HitTest_PlanePacket(const Plane& plane, const RayPacket& packet, __m128& t)
+        {
+            const PacketVector3 normal{plane.normal};
+            const __m128 denom{PacketVector3::Dot(normal, packet.direction)};
+
+            __m128 mask{_mm_and_ps(packet.active, _mm_cmplt_ps(denom, _mm_setzero_ps()))};
+            if (_mm_movemask_ps(mask) == 0) return 0;
+
+            t = _mm_div_ps(PacketVector3::Dot(PacketVector3{plane.origin} - packet.origin, normal), denom);
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(t, packet.min), _mm_cmple_ps(t, packet.max)));
+            return _mm_movemask_ps(mask);
+        }
+
+        /**
+         * \brief Closest wall of the room per lane, see HitTest_Room
+         * \param planeIdx receives the plane index of the hit wall per lane
+         */
+        inline int HitTest_RoomPacket(const Room& room, const RayPacket& packet, __m128& t, __m128i& planeIdx)
+        {
+            const __m128 origins[3]{packet.origin.x, packet.origin.y, packet.origin.z};
+            const __m128 directions[3]{packet.direction.x, packet.direction.y, packet.direction.z};
+            const __m128 zero{_mm_setzero_ps()};
+
+            __m128 hitMask{zero};
+            t = _mm_set1_ps(FLT_MAX);
+            planeIdx = _mm_set1_epi32(INT32_MAX);
+            for (int axis{0}; axis < 3; ++axis)
+            {
+                const int minWallIdx{room.planeIndices[axis][0]};
+                const int maxWallIdx{room.planeIndices[axis][1]};
+                const __m128 towardsMax{_mm_cmpgt_ps(directions[axis], zero)};
+
+                __m128 mask{zero};
+                if (maxWallIdx >= 0) mask = towardsMax;
+                if (minWallIdx >= 0) mask = _mm_or_ps(mask, _mm_cmplt_ps(directions[axis], zero));
+                mask = _mm_and_ps(mask, packet.active);
+                if (_mm_movemask_ps(mask) == 0) continue;
+
+                const __m128 bound{PacketMath::Select(towardsMax, _mm_set1_ps(room.bounds[axis][1]), _mm_set1_ps(room.bounds[axis][0]))};
+                const __m128i wallIdx{
+                    _mm_castps_si128(PacketMath::Select(towardsMax, _mm_castsi128_ps(_mm_set1_epi32(maxWallIdx)), _mm_castsi128_ps(_mm_set1_epi32(minWallIdx))))
+                };
+                const __m128 wallT{_mm_div_ps(_mm_sub_ps(bound, origins[axis]), directions[axis])};
+                mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(wallT, packet.min), _mm_cmple_ps(wallT, packet.max)));
+
+                const __m128 isLowerIdx{_mm_castsi128_ps(_mm_cmplt_epi32(wallIdx, planeIdx))};
+                mask = _mm_and_ps(mask, _mm_or_ps(_mm_cmplt_ps(wallT, t), _mm_and_ps(_mm_cmpeq_ps(wallT, t), isLowerIdx)));
+
+                t = PacketMath::Select(mask, wallT, t);
+                planeIdx = _mm_castps_si128(PacketMath::Select(mask, _mm_castsi128_ps(wallIdx), _mm_castsi128_ps(planeIdx)));
+                hitMask = _mm_or_ps(hitMask, mask);
+            }
+            return _mm_movemask_ps(hitMask);
+        }
+
+        /**
+         * \brief Any-hit test of the room for shadow rays, lanes ending inside the room are never blocked, see HitTest_Room
+         */
+        inline int HitTest_RoomPacket(const Room& room, const RayPacket& packet, __m128i& planeIdx)
+        {
+            const PacketVector3 end{packet.origin + packet.direction * packet.max};
+            const __m128 ends[3]{end.x, end.y, end.z};
+            const __m128 margin{_mm_set1_ps(0.001f)};
+
+            __m128 isInside{_mm_castsi128_ps(_mm_set1_epi32(-1))};
+            for (int axis{0}; axis < 3; ++axis)
+            {
+                if (room.planeIndices[axis][0] >= 0)
+                {
+                    isInside = _mm_and_ps(isInside, _mm_cmpgt_ps(_mm_sub_ps(ends[axis], _mm_set1_ps(room.bounds[axis][0])), margin));
+                }
+                if (room.planeIndices[axis][1] >= 0)
+                {
+                    isInside = _mm_and_ps(isInside, _mm_cmpgt_ps(_mm_sub_ps(_mm_set1_ps(room.bounds[axis][1]), ends[axis]), margin));
+                }
+            }
+
+            RayPacket outsideRays{packet};
+            outsideRays.active = _mm_andnot_ps(isInside, packet.active);
+            if (outsideRays.GetActiveMask() == 0) return 0;
+
+            __m128 t;
+            return HitTest_RoomPacket(room, outsideRays, t, planeIdx);
+        }
+
+        /**
+         * \brief Moller-Trumbore of one triangle against all lanes, see HitTest_MeshTriangle
+         * \param edge1 v1 - v0
+         * \param edge2 v2 - v0
+         */
+        inline int HitTest_TrianglePacket(const Vector3& v0, const Vector3& edge1, const Vector3& edge2,
+                                          TriangleCullMode cullMode, const RayPacket& packet, __m128& t)
+        {
+            const PacketVector3 e1{edge1};
+            const PacketVector3 e2{edge2};
+            const __m128 zero{_mm_setzero_ps()};
+
+            const PacketVector3 P{PacketVector3::Cross(packet.direction, e2)};
+            const __m128 det{PacketVector3::Dot(e1, P)};
+
+            __m128 mask{_mm_and_ps(packet.active, _mm_cmpge_ps(PacketMath::Abs(det), _mm_set1_ps(FLT_EPSILON)))};
+            if (cullMode == TriangleCullMode::BackFaceCulling)
+            {
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(det, zero));
+            }
+            else if (cullMode == TriangleCullMode::FrontFaceCulling)
+            {
+                mask = _mm_and_ps(mask, _mm_cmple_ps(det, zero));
+            }
+            if (_mm_movemask_ps(mask) == 0) return 0;
+
+            const __m128 invDet{_mm_div_ps(_mm_set1_ps(1.0f), det)};
+            const PacketVector3 T{packet.origin - PacketVector3{v0}};
+            const __m128 u{_mm_mul_ps(PacketVector3::Dot(T, P), invDet)};
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, _mm_set1_ps(1.0f))));
+            if (_mm_movemask_ps(mask) == 0) return 0;
+
+            const PacketVector3 Q{PacketVector3::Cross(T, e1)};
+            const __m128 v{_mm_mul_ps(invDet, PacketVector3::Dot(packet.direction, Q))};
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f))));
+            if (_mm_movemask_ps(mask) == 0) return 0;
+
+            t = _mm_mul_ps(PacketVector3::Dot(e2, Q), invDet);
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(t, packet.min), _mm_cmple_ps(t, packet.max)));
+            return _mm_movemask_ps(mask);
+        }
+
+        /**
+         * \brief Gathers the triangle through the index buffer, see HitTest_TrianglePacket
+         */
+        inline int HitTest_MeshTrianglePacket(const TriangleMesh& mesh, const std::vector<Vector3>& vertices,
+                                              uint32_t triangleIdx, const RayPacket& packet, __m128& t)
+        {
+            const size_t idx{triangleIdx * 3ull};
+            const Vector3& v0{vertices[mesh.indices[idx]]};
+            return HitTest_TrianglePacket(v0, vertices[mesh.indices[idx + 1]] - v0, vertices[mesh.indices[idx + 2]] - v0,
+                                          mesh.cullMode, packet, t);
+        }
+
+        /**
+         * \brief Slab test of all active lanes against one box
+         * \param entry Smallest entry distance of the lanes that hit, used to order the children
+         * \return Bit mask of the lanes that hit the box within [min, max]
+         */
+        inline int SlabTest_AABBPacket(const Vector3& minAABB, const Vector3& maxAABB, const RayPacket& packet, float& entry)
+        {
+            const __m128 tx1{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(minAABB.x), packet.origin.x), packet.invDirection.x)};
+            const __m128 tx2{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxAABB.x), packet.origin.x), packet.invDirection.x)};
+            __m128 tmin{_mm_min_ps(tx1, tx2)};
+            __m128 tmax{_mm_max_ps(tx1, tx2)};
+
+            const __m128 ty1{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(minAABB.y), packet.origin.y), packet.invDirection.y)};
+            const __m128 ty2{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxAABB.y), packet.origin.y), packet.invDirection.y)};
+            tmin = _mm_max_ps(tmin, _mm_min_ps(ty1, ty2));
+            tmax = _mm_min_ps(tmax, _mm_max_ps(ty1, ty2));
+
+            const __m128 tz1{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(minAABB.z), packet.origin.z), packet.invDirection.z)};
+            const __m128 tz2{_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(maxAABB.z), packet.origin.z), packet.invDirection.z)};
+            tmin = _mm_max_ps(tmin, _mm_min_ps(tz1, tz2));
+            tmax = _mm_min_ps(tmax, _mm_max_ps(tz1, tz2));
+
+            __m128 mask{_mm_and_ps(packet.active, _mm_cmpge_ps(tmax, tmin))};
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpgt_ps(tmax, packet.min), _mm_cmplt_ps(tmin, packet.max)));
+
+            entry = PacketMath::HorizontalMin(tmin, mask);
+            return _mm_movemask_ps(mask);
+        }
+
+        /**
+         * \brief Packet version of IntersectBVHLeaves: a node is visited as soon as one active lane hits it
+         * \param intersectLeaf int(uint32_t nodeIdx, RayPacket& packet), returns the lanes that hit and shrinks their max
+         * \param anyHit Lanes retire at their first hit (shadow rays), traversal stops once no lane is left
+         * \return Bit mask of the lanes that hit anything
+         */
+        template <typename IntersectLeaf>
+        int IntersectBVHPacketLeaves(const BVH& bvh, RayPacket& packet, IntersectLeaf&& intersectLeaf, bool anyHit)
+        {
+            if (bvh.IsEmpty()) return 0;
+
+            float entry;
+            const BVHNode* pNode{&bvh.nodes[0]};
+            if (SlabTest_AABBPacket(pNode->minAABB, pNode->maxAABB, packet, entry) == 0) return 0;
+
+            const BVHNode* stack[BVH::maxDepth];
+            int stackPtr{0};
+
+            int hitMask{0};
+            while (true)
+            {
+                if (pNode->IsLeaf())
+                {
+                    const int mask{intersectLeaf(static_cast<uint32_t>(pNode - bvh.nodes.data()), packet)};
+                    hitMask |= mask;
+                    if (anyHit and mask != 0)
+                    {
+                        packet.active = _mm_andnot_ps(PacketMath::LaneMask(mask), packet.active);
+                        if (packet.GetActiveMask() == 0) return hitMask;
+                    }
+                    if (stackPtr == 0) break;
+                    pNode = stack[--stackPtr];
+                    continue;
+                }
+
+                const BVHNode* pChild1{&bvh.nodes[pNode->leftFirst]};
+                const BVHNode* pChild2{&bvh.nodes[pNode->leftFirst + 1]};
+                float dist1, dist2;
+                if (SlabTest_AABBPacket(pChild1->minAABB, pChild1->maxAABB, packet, dist1) == 0) dist1 = FLT_MAX;
+                if (SlabTest_AABBPacket(pChild2->minAABB, pChild2->maxAABB, packet, dist2) == 0) dist2 = FLT_MAX;
+                if (dist1 > dist2)
+                {
+                    std::swap(dist1, dist2);
+                    std::swap(pChild1, pChild2);
+                }
+
+                if (dist1 == FLT_MAX)
+                {
+                    if (stackPtr == 0) break;
+                    pNode = stack[--stackPtr];
+                }
+                else
+                {
+                    pNode = pChild1;
+                    if (dist2 != FLT_MAX) stack[stackPtr++] = pChild2;
+                }
+            }
+            return hitMask;
+        }
+
+        /**
+         * \brief IntersectBVHPacketLeaves with one callback per primitive
+         * \param intersectPrimitive int(uint32_t primIdx, RayPacket& packet), returns the lanes that hit and shrinks their max
+         */
+        template <typename IntersectPrimitive>
+        int IntersectBVHPacket(const BVH& bvh, RayPacket& packet, IntersectPrimitive&& intersectPrimitive, bool anyHit)
+        {
+            return IntersectBVHPacketLeaves(bvh, packet, [&bvh, &intersectPrimitive, anyHit](uint32_t nodeIdx, RayPacket& p)
+            {
+                const BVHNode& leaf{bvh.nodes[nodeIdx]};
+
+                int hitMask{0};
+                for (uint32_t idx{leaf.leftFirst}; idx < leaf.leftFirst + leaf.primCount; ++idx)
+                {
+                    const int mask{intersectPrimitive(bvh.primIndices[idx], p)};
+                    if (mask == 0) continue;
+
+                    hitMask |= mask;
+                    if (anyHit)
+                    {
+                        p.active = _mm_andnot_ps(PacketMath::LaneMask(mask), p.active);
+                        if (p.GetActiveMask() == 0) break;
+                    }
+                }
+                return hitMask;
+            }, anyHit);
+        }
+
+        /**
+         * \brief Closest triangle per lane through the mesh BVH, closestTriangleIdx is only written for lanes that hit
+         * \param vertices transformedPositions for world space meshes, positions for instanced meshes \n
+         * With TRIANGLE_BLOCKS the precomputed blocks are read instead, they were built from the same vertices
+         */
+        inline int HitTest_TriangleMeshPacket(const TriangleMesh& mesh, [[maybe_unused]] const std::vector<Vector3>& vertices,
+                                              RayPacket& packet, uint32_t (&closestTriangleIdx)[PACKET_WIDTH],
+                                              bool anyHit = false)
+        {
+            const auto acceptHits = [&closestTriangleIdx](int mask, __m128 t, uint32_t triangleIdx, RayPacket& p)
+            {
+                p.max = PacketMath::Select(PacketMath::LaneMask(mask), t, p.max);
+                for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+                {
+                    if (mask & (1 << lane)) closestTriangleIdx[lane] = triangleIdx;
+                }
+            };
+
+#if TRIANGLE_BLOCKS
+            return IntersectBVHPacketLeaves(mesh.bvh, packet, [&mesh, &acceptHits](uint32_t nodeIdx, RayPacket& p)
+            {
+                const uint32_t primCount{mesh.bvh.nodes[nodeIdx].primCount};
+                const TriangleBlock* pBlock{&mesh.triangleBlocks[mesh.leafFirstBlock[nodeIdx]]};
+
+                int hitMask{0};
+                for (uint32_t idx{0}; idx < primCount; ++idx)
+                {
+                    if (idx > 0 and idx % TriangleBlock::size == 0) ++pBlock;
+
+                    const uint32_t lane{idx % TriangleBlock::size};
+                    const Vector3 v0{pBlock->v0x[lane], pBlock->v0y[lane], pBlock->v0z[lane]};
+                    const Vector3 e1{pBlock->e1x[lane], pBlock->e1y[lane], pBlock->e1z[lane]};
+                    const Vector3 e2{pBlock->e2x[lane], pBlock->e2y[lane], pBlock->e2z[lane]};
+
+                    __m128 t;
+                    const int mask{HitTest_TrianglePacket(v0, e1, e2, mesh.cullMode, p, t)};
+                    if (mask == 0) continue;
+
+                    acceptHits(mask, t, pBlock->triangleIndices[lane], p);
+                    hitMask |= mask;
+                }
+                return hitMask;
+            }, anyHit);
+#else
+            return IntersectBVHPacket(mesh.bvh, packet,
+                                      [&mesh, &vertices, &acceptHits](uint32_t triangleIdx, RayPacket& p)
+                                      {
+                                          __m128 t;
+                                          const int mask{HitTest_MeshTrianglePacket(mesh, vertices, triangleIdx, p, t)};
+                                          if (mask == 0) return 0;
+
+                                          acceptHits(mask, t, triangleIdx, p);
+                                          return mask;
+                                      }, anyHit);
+#endif
+        }
+
+        /**
+         * \brief Moves the whole packet into the object space of the instance, t stays the world space distance
+         */
+        inline RayPacket TransformPacket(const MeshInstance& instance, const RayPacket& packet)
+        {
+            RayPacket objectPacket{packet};
+            objectPacket.origin = PacketVector3::Transform(instance.inverseTransform, packet.origin, true);
+            objectPacket.direction = PacketVector3::Transform(instance.inverseTransform, packet.direction, false);
+            objectPacket.UpdateInvDirection();
+            return objectPacket;
+        }
+#pragma endregion
+    }
+}
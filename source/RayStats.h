@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace dae
+{
+    /**
+     * \brief Counter that every render thread bumps concurrently \n
+     * Each thread adds to its own cache line so the counting never serializes the threads, Get sums all lines
+     */
+    class RayCounter final
+    {
+    public:
+        void Add(uint64_t count)
+        {
+            m_Shards[GetShardIdx()].count.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        uint64_t Get() const
+        {
+            uint64_t total{0};
+            for (const Shard& shard : m_Shards)
+            {
+                total += shard.count.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        void Reset()
+        {
+            for (Shard& shard : m_Shards)
+            {
+                shard.count.store(0, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        static constexpr uint32_t SHARD_COUNT{64};
+
+        struct alignas(64) Shard
+        {
+            std::atomic<uint64_t> count {0};
+        };
+
+        Shard m_Shards[SHARD_COUNT] {};
+
+        static uint32_t GetShardIdx()
+        {
+            static std::atomic<uint32_t> nextIdx{0};
+            thread_local const uint32_t shardIdx{nextIdx.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT};
+            return shardIdx;
+        }
+    };
+
+    /**
+     * \brief Rays traced through the scene since the last Reset, see RAY_STATS \n
+     * Primary rays are the closest-hit queries, shadow rays the any-hit queries \n
+     * occludedRays are the shadow rays that something blocked, occluderCacheHits the ones of them the cached occluder of their light blocked, see OCCLUDER_CACHE
+     */
+    struct RayStats
+    {
+        RayCounter primaryRays       {};
+        RayCounter shadowRays        {};
+        RayCounter occludedRays      {};
+        RayCounter occluderCacheHits {};
+
+        void Reset()
+        {
+            primaryRays.Reset();
+            shadowRays.Reset();
+            occludedRays.Reset();
+            occluderCacheHits.Reset();
+        }
+    };
+}
@@ -10,178 +10,234 @@
 #include "Scene.h"
 #include "Utils.h"
 #include "Macros.h"
+#include "TileScheduler.h"
+#include "ImageWriter.h"
+#include "ShadingBatch.h"
 
+#include <algorithm>
+#include <cmath>
 #include <execution>
 #include <numeric>
 
 namespace dae
 {
+    namespace
+    {
+        //Radical inverse of index in the given base, a low-discrepancy sequence in [0, 1)
+        float GetHalton(uint32_t index, uint32_t base)
+        {
+            float result{0.0f};
+            float fraction{1.0f};
+            while (index > 0)
+            {
+                fraction /= static_cast<float>(base);
+                result += fraction * static_cast<float>(index % base);
+                index /= base;
+            }
+            return result;
+        }
+
+        //Luminance of the colour as it ends up on screen
+        float GetDisplayLuminance(ColorRGB color)
+        {
+            color.MaxToOne();
+            return 0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b;
+        }
+
+        bool IsSameMatrix(const Matrix& lhs, const Matrix& rhs)
+        {
+            for (int row{0}; row < 4; ++row)
+            {
+                if (lhs[row].x != rhs[row].x or lhs[row].y != rhs[row].y or lhs[row].z != rhs[row].z or lhs[row].w != rhs[row].w) return false;
+            }
+            return true;
+        }
+
+        //RayTracing_AOV.png + depth: RayTracing_AOV_depth.png
+        std::string GetAOVFilePath(const std::string& filePath, const std::string& aovName)
+        {
+            const size_t dotIdx{filePath.find_last_of('.')};
+            if (dotIdx == std::string::npos) return filePath + '_' + aovName;
+            return filePath.substr(0, dotIdx) + '_' + aovName + filePath.substr(dotIdx);
+        }
+
+        //Fixed, well spread colour per material index
+        uint32_t GetIndexColor(unsigned char index)
+        {
+            const uint32_t hash{(static_cast<uint32_t>(index) + 1) * 0x9E3779B1u};
+            return (hash >> 8) & 0x00FFFFFF;
+        }
+    }
+
+
+    /**
+     * \brief Occluder caches of one worker, lights past size share entries, which only lowers the hit rate \n
+     * Whole cache lines so the workers never write to each other's lines
+     */
+    struct alignas(64) Renderer::ShadowCache
+    {
+        static constexpr uint32_t size{8};
+
+        PrimitiveHit occluders[size] {};
+
+        PrimitiveHit& Get(uint32_t lightIdx) { return occluders[lightIdx % size]; }
+    };
+
+    /**
+     * \brief Scratch memory of RenderWavefrontTileKernel, one per worker with one entry per pixel of the tile \n
+     * Only grows, ReserveWorkerBuffers sizes it for the largest tile up front so the wavefront stages never allocate during a frame
+     */
+    struct Renderer::WavefrontBuffers
+    {
+        std::vector<HitRecord> hits           {};
+        std::vector<Vector3>   viewDirections {};
+        std::vector<int>       pixelXs        {}; //-1 for packet lanes outside the frame
+        std::vector<int>       pixelYs        {};
+        std::vector<ColorRGB>  colors         {};
+
+        //Per light
+        std::vector<Vector3>  dirsToLight   {};
+        std::vector<float>    observedAreas {};
+        std::vector<uint32_t> samples       {}; //Entries the light reaches
+        std::vector<uint32_t> sortedSamples {}; //Entry of every sample in the batch, sorted by material type
+        ShadingBatch          batch         {};
+
+        void Reserve(uint32_t entryCount)
+        {
+            if (hits.size() >= entryCount) return;
+
+            hits.resize(entryCount);
+            viewDirections.resize(entryCount);
+            pixelXs.resize(entryCount);
+            pixelYs.resize(entryCount);
+            colors.resize(entryCount);
+            dirsToLight.resize(entryCount);
+            observedAreas.resize(entryCount);
+            samples.resize(entryCount);
+            sortedSamples.resize(entryCount);
+            batch.Resize(entryCount);
+        }
+    };
+
+    /**
+     * \brief Primary hit and view direction of every pixel, traced through the pixel centres, see GBUFFER_CACHING \n
+     * Only valid for the camera, scene, geometry and trace path it was traced with
+     */
+    struct Renderer::GBuffer
+    {
+        //What the frame being rendered does with the G-buffer, set by BeginGBuffer
+        enum class FrameUsage
+        {
+            Unused,
+            Write,
+            Read
+        };
+
+        std::vector<HitRecord> hits           {};
+        std::vector<Vector3>   viewDirections {};
+
+        Matrix       cameraToWorld   {};
+        float        FOV             {0.0f};
+        const Scene* pScene          {nullptr};
+        uint64_t     geometryVersion {0};
+        bool         isPacketTraced  {false};
+        bool         isValid         {false};
+
+        FrameUsage frameUsage {FrameUsage::Unused};
+    };
+
     Renderer::Renderer(SDL_Window* pWindow) :
-        m_pWindow(pWindow),
-        m_pBuffer(SDL_GetWindowSurface(pWindow))
+        m_pWindow(pWindow)
     {
         //Initialize
         SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
-        m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
-        
+        Initialize();
+
+        //Only wraps m_Pixels, Present blits it into the window surface in whatever format the window uses
+        m_pBuffer = SDL_CreateRGBSurfaceWithFormatFrom(m_pBufferPixels, m_Width, m_Height, 32,
+                                                       m_Width * static_cast<int>(sizeof(uint32_t)),
+                                                       SDL_PIXELFORMAT_RGB888);
+    }
+
+    Renderer::Renderer(int width, int height) :
+        m_Width(width),
+        m_Height(height)
+    {
+        Initialize();
+    }
+
+    Renderer::~Renderer()
+    {
+        if (m_pBuffer) SDL_FreeSurface(m_pBuffer);
+    }
+
+    void Renderer::Initialize()
+    {
+        m_Pixels.assign(static_cast<size_t>(m_Width) * m_Height, 0);
+        m_pBufferPixels = m_Pixels.data();
+
         m_HorizontalIter.resize(m_Width);
         m_VerticalIter.resize(m_Height);
         
-        const uint32_t amountOfPixels{static_cast<uint32_t>(m_Width * m_Height)};
-        m_PixelIndices.resize(amountOfPixels);
-        
         std::iota(m_HorizontalIter.begin(), m_HorizontalIter.end(), 0);
         std::iota(m_VerticalIter.begin(), m_VerticalIter.end(), 0);
-        std::iota(m_PixelIndices.begin(), m_PixelIndices.end(), 0);
-    }
 
-    void Renderer::Render(Scene* pScene) const
-    {
-        Camera& camera = pScene->GetCamera();
-        const Matrix cameraToWorld{camera.CalculateCameraToWorld()};
-        const float FOV{camera.GetFOV()};
-        const auto& lights = pScene->GetLights();
-        const auto& materials = pScene->GetMaterials();
-        const float aspectRatio{static_cast<float>(m_Width) / static_cast<float>(m_Height)};
-        
-#if MULTITHREADING
-        std::for_each(std::execution::par, m_VerticalIter.begin(), m_VerticalIter.end(),
-                      [this, FOV, camera, cameraToWorld, pScene, lights, materials, aspectRatio](int py)
-                      // [&](int py)
-                      {
-                          Vector3 rayDirection;
-                          for (int px{}; px < m_Width; ++px)
-                          {
-                              const float rx{(static_cast<float>(px) + 0.5f) / static_cast<float>(m_Width) * 2.0f - 1.0f};
-                              const float ry{1.0f - (static_cast<float>(py) + 0.5f) / static_cast<float>(m_Height) * 2.0f};
-                              
-                              rayDirection.x = rx * aspectRatio * FOV;
-                              rayDirection.y = ry * FOV;
-                              rayDirection.z = 1.0f;
-                              rayDirection = cameraToWorld.TransformVector(rayDirection);
-                              rayDirection.Normalize();
+        m_PacketCountX = (m_Width + 1) / 2;
 
-                              Ray viewRay{camera.origin, rayDirection};
+        m_AccumulationBuffer.assign(static_cast<size_t>(m_Width) * m_Height, ColorRGB{});
+        m_EdgeMask.assign(static_cast<size_t>(m_Width) * m_Height, 0);
+        m_IsAccumulationDirty = true;
 
-                              HitRecord closestHit{};
-                              pScene->GetClosestHit(viewRay, closestHit);
+        m_pGBuffer = std::make_unique<GBuffer>();
+#if GBUFFER_CACHING and WAVEFRONT_SHADING
+        m_pGBuffer->hits.resize(static_cast<size_t>(m_Width) * m_Height);
+        m_pGBuffer->viewDirections.resize(static_cast<size_t>(m_Width) * m_Height);
+#endif
 
-                              ColorRGB finalColor{};
-                              if (closestHit.didHit)
-                              {
-                                  for (const auto& light : lights)
-                                  {
-                                      const Vector3 dirToLight{LightUtils::GetDirectionToLight(light, closestHit.origin)};
-                                      const float lightDistance{dirToLight.Magnitude()};
-                                      const Vector3 dirToLightNormalized{dirToLight / lightDistance};
-                                      
-                                      Ray shadowRay{closestHit.origin + closestHit.normal * 0.001f, dirToLightNormalized, 0.0001f, lightDistance};
-                                      
-                                      const float observedArea{Vector3::Dot(dirToLightNormalized, closestHit.normal)};
-                                      
-                                      switch (m_CurrentLightingMode)
-                                      {
-                                      case LightingMode::ObservedArea:
-                                          if (observedArea < 0) continue;
-                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
-                                          finalColor += observedArea;
-                                          break;
-                                      case LightingMode::Radiance:
-                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
-                                          finalColor += LightUtils::GetRadiance(light, closestHit.origin);
-                                          break;
-                                      case LightingMode::BRDF:
-                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
-                                          finalColor += materials[closestHit.materialIndex]->Shade(closestHit, dirToLightNormalized, -viewRay.direction);
-                                          break;
-                                      case LightingMode::Combined:
-                                          if (observedArea < 0) continue;
-                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
-                                          finalColor +=
-                                              LightUtils::GetRadiance(light, closestHit.origin)
-                                              *
-                                              materials[closestHit.materialIndex]->Shade(closestHit, dirToLightNormalized, -viewRay.direction)
-                                              *
-                                              observedArea;
-                                          break;
-                                      }
-                                  }
-                              }
-                              UpdateColor(finalColor, px, py);
-                          }
-                      });
+#if MULTITHREADING
+        m_pScheduler = std::make_unique<TileScheduler>();
 #else
-        Vector3 rayDirection;
-        for (int px{}; px < m_Width; ++px)
-        {
-            for (int py{}; py < m_Height; ++py)
-            {
-                const float rx{(static_cast<float>(px) + 0.5f) / static_cast<float>(m_Width) * 2.0f - 1.0f};
-                const float ry{1.0f - (static_cast<float>(py) + 0.5f) / static_cast<float>(m_Height) * 2.0f};
-                
-                rayDirection.x = rx * aspectRatio * FOV;
-                rayDirection.y = ry * FOV;
-                rayDirection.z = 1.0f;
-                rayDirection = cameraToWorld.TransformVector(rayDirection);
-                rayDirection.Normalize();
-
-                Ray viewRay{camera.origin, rayDirection};
+        m_pScheduler = std::make_unique<TileScheduler>(1);
+#endif
+        m_pImageWriter = std::make_unique<ImageWriter>();
 
-                HitRecord closestHit{};
-                pScene->GetClosestHit(viewRay, closestHit);
+        ReserveWorkerBuffers();
+        SelectShadingKernels();
+    }
 
-                ColorRGB finalColor{};
-                if (closestHit.didHit)
-                {
-                    for (const auto& light : lights)
-                    {
-                        const Vector3 dirToLight{LightUtils::GetDirectionToLight(light, closestHit.origin)};
-                        const float lightDistance{dirToLight.Magnitude()};
-                        const Vector3 dirToLightNormalized{dirToLight / lightDistance};
-                        
-                        Ray shadowRay{closestHit.origin + closestHit.normal * 0.001f, dirToLightNormalized, 0.0001f, lightDistance};
-                        
-                        const float observedArea{Vector3::Dot(dirToLightNormalized, closestHit.normal)};
-                        
-                        switch (m_CurrentLightingMode)
-                        {
-                        case LightingMode::ObservedArea:
-                            if (observedArea < 0) continue;
-                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
-                            finalColor += observedArea;
-                            break;
-                        case LightingMode::Radiance:
-                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
-                            finalColor += LightUtils::GetRadiance(light, closestHit.origin);
-                            break;
-                        case LightingMode::BRDF:
-                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
-                            finalColor += materials[closestHit.materialIndex]->Shade(closestHit, dirToLightNormalized, -viewRay.direction);
-                            break;
-                        case LightingMode::Combined:
-                            if (observedArea < 0) continue;
-                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
-                            finalColor +=
-                                LightUtils::GetRadiance(light, closestHit.origin)
-                                *
-                                materials[closestHit.materialIndex]->Shade(closestHit, dirToLightNormalized, -viewRay.direction)
-                                *
-                                observedArea;
-                            break;
-                        }
-                    }
-                }
-                UpdateColor(finalColor, px, py);
-            }
+    void Renderer::Render(Scene* pScene) const
+    {
+#if PACKET_TRACING
+        if (m_PacketTracingEnabled)
+        {
+            RenderPackets(pScene);
+            return;
+        }
+#endif
+        const RenderContext context{MakeRenderContext(pScene)};
+        if (not BeginAccumulation(context))
+        {
+            Present();
+            return;
         }
+
+        m_pScheduler->Run(m_Width, m_Height, [this, &context](const Tile& tile, uint32_t workerIdx)
+        {
+            (this->*m_ShadingKernels.pRenderTile)(context, tile, workerIdx);
+        });
+#if ADAPTIVE_AA
+        if (m_AdaptiveAAEnabled and m_SampleIndex == 0) RefineEdges(context);
 #endif
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::DyanmicRender(Scene* pScene) const
     {
+        //Only Render, RenderScene_W5 and the packets keep the HDR colours, they set it again
+        m_IsFrameHDR = false;
+
         if (dynamic_cast<Scene_W1*>(pScene))
         {
             RenderScene_W1(pScene);
@@ -208,20 +264,84 @@ namespace dae
         }
     }
 
-    bool Renderer::SaveBufferToImage() const
+    bool Renderer::SaveBufferToImage(const std::string& filePath) const
+    {
+        return m_pImageWriter->Write(filePath, m_Width, m_Height, m_Pixels.data(),
+                                     m_IsFrameHDR ? m_AccumulationBuffer.data() : nullptr, m_SampleWeight);
+    }
+
+    bool Renderer::SaveAOVsToImages(const std::string& filePath) const
+    {
+        //The week exercises never write the G-buffer, it would show an older frame
+        ImageFormat format;
+        const GBuffer& gBuffer{*m_pGBuffer};
+        if (not m_IsFrameHDR or not gBuffer.isValid or not ImageWriter::GetFormat(filePath, format)) return false;
+
+        float maxDepth{0.0f};
+        for (const HitRecord& hit : gBuffer.hits)
+        {
+            if (hit.didHit) maxDepth = std::max(maxDepth, hit.t);
+        }
+
+        const size_t pixelCount{gBuffer.hits.size()};
+        std::vector<uint32_t> depthPixels(pixelCount, 0), normalPixels(pixelCount, 0), materialPixels(pixelCount, 0);
+        std::vector<ColorRGB> depths(pixelCount), normals(pixelCount), materials(pixelCount);
+        const auto toPixel{[](ColorRGB color)
+        {
+            color.MaxToOne();
+            return static_cast<uint32_t>(static_cast<uint8_t>(color.r * 255)) << 16 |
+                static_cast<uint32_t>(static_cast<uint8_t>(color.g * 255)) << 8 |
+                static_cast<uint32_t>(static_cast<uint8_t>(color.b * 255));
+        }};
+        for (size_t pixelIdx{0}; pixelIdx < pixelCount; ++pixelIdx)
+        {
+            const HitRecord& hit{gBuffer.hits[pixelIdx]};
+            if (not hit.didHit) continue;
+
+            //PFM keeps the raw distance, normal and index, the 8-bit images show near as bright and normals mapped to 0-1
+            depths[pixelIdx] = {hit.t, hit.t, hit.t};
+            normals[pixelIdx] = {hit.normal.x, hit.normal.y, hit.normal.z};
+            const float materialIndex{static_cast<float>(hit.materialIndex)};
+            materials[pixelIdx] = {materialIndex, materialIndex, materialIndex};
+
+            const float nearness{1.0f - hit.t / maxDepth};
+            depthPixels[pixelIdx] = toPixel({nearness, nearness, nearness});
+            normalPixels[pixelIdx] = toPixel({hit.normal.x * 0.5f + 0.5f, hit.normal.y * 0.5f + 0.5f, hit.normal.z * 0.5f + 0.5f});
+            materialPixels[pixelIdx] = GetIndexColor(hit.materialIndex);
+        }
+
+        const bool isDepthQueued{m_pImageWriter->Write(GetAOVFilePath(filePath, "depth"), m_Width, m_Height, depthPixels.data(), depths.data())};
+        const bool isNormalQueued{m_pImageWriter->Write(GetAOVFilePath(filePath, "normal"), m_Width, m_Height, normalPixels.data(), normals.data())};
+        const bool isMaterialQueued{m_pImageWriter->Write(GetAOVFilePath(filePath, "material"), m_Width, m_Height, materialPixels.data(), materials.data())};
+        return isDepthQueued and isNormalQueued and isMaterialQueued;
+    }
+
+    bool Renderer::WaitForSavedImages() const
+    {
+        return m_pImageWriter->Flush();
+    }
+
+    void Renderer::Present() const
     {
-        return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+        if (not m_pWindow) return;
+
+        SDL_BlitSurface(m_pBuffer, nullptr, SDL_GetWindowSurface(m_pWindow), nullptr);
+        SDL_UpdateWindowSurface(m_pWindow);
     }
 
     void Renderer::ToggleShadow()
     {
         m_ShadowsEnabled = not m_ShadowsEnabled;
+        m_IsAccumulationDirty = true;
+        SelectShadingKernels();
     }
 
     void Renderer::SwitchLightingMode()
     {
         m_CurrentLightingMode = static_cast<LightingMode>((static_cast<int>(m_CurrentLightingMode) + 1) % (static_cast<
             int>(LightingMode::Combined) + 1));
+        m_IsAccumulationDirty = true;
+        SelectShadingKernels();
         std::cout << "LIGHTING MODE: ";
         switch (m_CurrentLightingMode)
         {
@@ -238,18 +358,288 @@ namespace dae
             std::cout << "COMBINED" << std::endl;
             break;
         }
-    }
-
-    void Renderer::UpdateColor(ColorRGB& finalColor, int px, int py) const
-    {
-        //Update Color in Buffer
-        finalColor.MaxToOne();
+    }
+
+    void Renderer::TogglePacketTracing()
+    {
+        m_PacketTracingEnabled = not m_PacketTracingEnabled;
+        std::cout << "PACKET TRACING: " << (m_PacketTracingEnabled ? "ON" : "OFF") << std::endl;
+    }
+
+    void Renderer::ToggleAccumulation()
+    {
+        SetAccumulation(not m_AccumulationEnabled);
+        std::cout << "ACCUMULATION: " << (m_AccumulationEnabled ? "ON" : "OFF") << std::endl;
+    }
+
+    void Renderer::SetAccumulation(bool isEnabled)
+    {
+        m_AccumulationEnabled = isEnabled;
+        m_IsAccumulationDirty = true;
+    }
+
+    void Renderer::SetGBufferReuse(bool isEnabled)
+    {
+        m_GBufferReuseEnabled = isEnabled;
+    }
+
+    void Renderer::ToggleAdaptiveAA()
+    {
+        SetAdaptiveAA(not m_AdaptiveAAEnabled);
+        std::cout << "ADAPTIVE AA: " << (m_AdaptiveAAEnabled ? "ON" : "OFF") << std::endl;
+    }
+
+    void Renderer::SetAdaptiveAA(bool isEnabled)
+    {
+        m_AdaptiveAAEnabled = isEnabled;
+        m_IsAccumulationDirty = true;
+    }
+
+    void Renderer::SetAASubdivisions(int subdivisions)
+    {
+        m_AASubdivisions = std::clamp(subdivisions, 1, MAX_AA_SUBDIVISIONS);
+        m_IsAccumulationDirty = true;
+    }
+
+    void Renderer::SetAAContrastThreshold(float threshold)
+    {
+        m_AAContrastThreshold = std::max(0.0f, threshold);
+        m_IsAccumulationDirty = true;
+    }
+
+    void Renderer::SetThreadCount(uint32_t threadCount)
+    {
+        m_pScheduler->SetThreadCount(threadCount);
+        ReserveWorkerBuffers();
+    }
+
+    void Renderer::SetTileSize(int tileSize)
+    {
+        m_pScheduler->SetTileSize(tileSize);
+        ReserveWorkerBuffers();
+    }
+
+    uint32_t Renderer::GetThreadCount() const
+    {
+        return m_pScheduler->GetThreadCount();
+    }
+
+    int Renderer::GetTileSize() const
+    {
+        return m_pScheduler->GetTileSize();
+    }
+
+    void Renderer::ReserveWorkerBuffers()
+    {
+        //Tiles are square and never larger than the tile size, which is even, so whole packets fit too
+        const uint32_t tileSize{static_cast<uint32_t>(m_pScheduler->GetTileSize())};
+        m_pWavefrontBuffers = std::make_unique<WavefrontBuffers[]>(m_pScheduler->GetThreadCount());
+        m_pShadowCaches = std::make_unique<ShadowCache[]>(m_pScheduler->GetThreadCount());
+        for (uint32_t workerIdx{0}; workerIdx < m_pScheduler->GetThreadCount(); ++workerIdx)
+        {
+            m_pWavefrontBuffers[workerIdx].Reserve(tileSize * tileSize);
+        }
+    }
+
+    void Renderer::UpdateColor(ColorRGB& finalColor, int px, int py) const
+    {
+        //Update Color in Buffer
+        finalColor.MaxToOne();
+
+        //0x00RRGGBB, the layout of SDL_PIXELFORMAT_RGB888
+        m_pBufferPixels[static_cast<uint32_t>(px) + (static_cast<uint32_t>(py) * m_Width)] =
+            static_cast<uint32_t>(static_cast<uint8_t>(finalColor.r * 255)) << 16 |
+            static_cast<uint32_t>(static_cast<uint8_t>(finalColor.g * 255)) << 8 |
+            static_cast<uint32_t>(static_cast<uint8_t>(finalColor.b * 255));
+    }
+
+    Renderer::RenderContext Renderer::MakeRenderContext(Scene* pScene) const
+    {
+        Camera& camera{pScene->GetCamera()};
+        return {
+            pScene,
+            pScene->GetLights(),
+            pScene->GetMaterials(),
+            pScene->GetMaterialTable(),
+            camera.CalculateCameraToWorld(),
+            camera.origin,
+            camera.GetFOV(),
+            static_cast<float>(m_Width) / static_cast<float>(m_Height)
+        };
+    }
+
+    bool Renderer::BeginAccumulation(const RenderContext& context) const
+    {
+        const Scene* pScene{context.pScene};
+        const Matrix& cameraToWorld{context.cameraToWorld};
+        const float FOV{context.FOV};
+
+        m_IsFrameHDR = true;
+#if PROGRESSIVE_ACCUMULATION
+        const bool isCameraUnchanged{FOV == m_AccumulatedFOV and IsSameMatrix(cameraToWorld, m_AccumulatedCameraToWorld)};
+        const bool isUnchanged{
+            m_AccumulationEnabled and not m_IsAccumulationDirty and isCameraUnchanged and
+            pScene == m_pAccumulatedScene and pScene->GetGeometryVersion() == m_AccumulatedGeometryVersion
+        };
+
+        if (isUnchanged)
+        {
+            if (m_SampleIndex + 1 >= MAX_ACCUMULATED_SAMPLES) return false;
+            ++m_SampleIndex;
+        }
+        else
+        {
+            m_SampleIndex = 0;
+            m_IsAccumulationDirty = false;
+            m_AccumulatedCameraToWorld = cameraToWorld;
+            m_AccumulatedFOV = FOV;
+            m_pAccumulatedScene = pScene;
+            m_AccumulatedGeometryVersion = pScene->GetGeometryVersion();
+        }
+
+        //The first sample looks through the pixel centre, like a frame without accumulation
+        m_SampleWeight = 1.0f / static_cast<float>(m_SampleIndex + 1);
+        m_SampleOffsetX = m_SampleIndex == 0 ? 0.5f : GetHalton(m_SampleIndex, 2);
+        m_SampleOffsetY = m_SampleIndex == 0 ? 0.5f : GetHalton(m_SampleIndex, 3);
+#endif
+        BeginGBuffer(context);
+        return true;
+    }
+
+    void Renderer::BeginGBuffer(const RenderContext& context) const
+    {
+        GBuffer& gBuffer{*m_pGBuffer};
+        gBuffer.frameUsage = GBuffer::FrameUsage::Unused;
+#if GBUFFER_CACHING and WAVEFRONT_SHADING
+        //Jittered samples look through other points of the pixels
+        if (m_SampleIndex != 0) return;
+
+        const Scene* pScene{context.pScene};
+        const bool isPacketTraced{PACKET_TRACING and m_PacketTracingEnabled};
+        const bool isVisibilityUnchanged{
+            gBuffer.isValid and gBuffer.pScene == pScene and gBuffer.geometryVersion == pScene->GetGeometryVersion() and
+            gBuffer.FOV == context.FOV and IsSameMatrix(gBuffer.cameraToWorld, context.cameraToWorld) and gBuffer.isPacketTraced == isPacketTraced
+        };
+        if (isVisibilityUnchanged and m_GBufferReuseEnabled)
+        {
+            gBuffer.frameUsage = GBuffer::FrameUsage::Read;
+            return;
+        }
+
+        //Every tile of this frame writes its pixels
+        gBuffer.cameraToWorld = context.cameraToWorld;
+        gBuffer.FOV = context.FOV;
+        gBuffer.pScene = pScene;
+        gBuffer.geometryVersion = pScene->GetGeometryVersion();
+        gBuffer.isPacketTraced = isPacketTraced;
+        gBuffer.isValid = true;
+        gBuffer.frameUsage = GBuffer::FrameUsage::Write;
+#endif
+    }
+
+    void Renderer::AccumulateColor(const ColorRGB& sample, int px, int py) const
+    {
+        //Averaged before MaxToOne, so bright samples keep their weight
+        //Without PROGRESSIVE_ACCUMULATION every frame is sample 0, the buffer still keeps the HDR frame for the AA and PFM
+        ColorRGB& accumulatedColor{m_AccumulationBuffer[static_cast<uint32_t>(px) + static_cast<uint32_t>(py) * m_Width]};
+        if (m_SampleIndex == 0) accumulatedColor = sample;
+        else accumulatedColor += sample;
+
+        ColorRGB finalColor{accumulatedColor * m_SampleWeight};
+        UpdateColor(finalColor, px, py);
+    }
+
+    void Renderer::RefineEdges(const RenderContext& context) const
+    {
+        //Two passes: the edge test reads the neighbours' base samples, which the refinement overwrites
+        m_pScheduler->Run(m_Width, m_Height, [this](const Tile& tile, uint32_t)
+        {
+            for (int py{tile.minY}; py < tile.maxY; ++py)
+            {
+                for (int px{tile.minX}; px < tile.maxX; ++px)
+                {
+                    m_EdgeMask[static_cast<size_t>(py) * m_Width + px] = IsEdgePixel(px, py);
+                }
+            }
+        });
+
+        m_AARefinedPixelCount = 0;
+        m_pScheduler->Run(m_Width, m_Height, [this, &context](const Tile& tile, uint32_t workerIdx)
+        {
+            uint32_t refinedPixelCount{0};
+            for (int py{tile.minY}; py < tile.maxY; ++py)
+            {
+                for (int px{tile.minX}; px < tile.maxX; ++px)
+                {
+                    if (not m_EdgeMask[static_cast<size_t>(py) * m_Width + px]) continue;
+
+                    RefinePixel(context, px, py, workerIdx);
+                    ++refinedPixelCount;
+                }
+            }
+            m_AARefinedPixelCount.fetch_add(refinedPixelCount, std::memory_order_relaxed);
+        });
+    }
+
+    bool Renderer::IsEdgePixel(int px, int py) const
+    {
+        const auto getLuminance{[this](int x, int y)
+        {
+            return GetDisplayLuminance(m_AccumulationBuffer[static_cast<size_t>(y) * m_Width + x]);
+        }};
+
+        const float luminance{getLuminance(px, py)};
+        return (px > 0 and std::abs(luminance - getLuminance(px - 1, py)) > m_AAContrastThreshold) or
+            (px + 1 < m_Width and std::abs(luminance - getLuminance(px + 1, py)) > m_AAContrastThreshold) or
+            (py > 0 and std::abs(luminance - getLuminance(px, py - 1)) > m_AAContrastThreshold) or
+            (py + 1 < m_Height and std::abs(luminance - getLuminance(px, py + 1)) > m_AAContrastThreshold);
+    }
+
+    void Renderer::RefinePixel(const RenderContext& context, int px, int py, uint32_t workerIdx) const
+    {
+        //One sample in the centre of every stratum of a subdivisions x subdivisions grid over the pixel
+        const int sampleCount{m_AASubdivisions * m_AASubdivisions};
+        const float stratumSize{1.0f / static_cast<float>(m_AASubdivisions)};
+        const auto getSampleX{[&](int sampleIdx) { return static_cast<float>(px) + (static_cast<float>(sampleIdx % m_AASubdivisions) + 0.5f) * stratumSize; }};
+        const auto getSampleY{[&](int sampleIdx) { return static_cast<float>(py) + (static_cast<float>(sampleIdx / m_AASubdivisions) + 0.5f) * stratumSize; }};
+
+        //The base sample counts as one of them
+        ColorRGB& pixelColor{m_AccumulationBuffer[static_cast<size_t>(py) * m_Width + px]};
+        ColorRGB totalColor{pixelColor};
+
+        if (PACKET_TRACING and m_PacketTracingEnabled)
+        {
+            //The strata of one pixel are as coherent as a packet gets
+            for (int firstSampleIdx{0}; firstSampleIdx < sampleCount; firstSampleIdx += PACKET_WIDTH)
+            {
+                float xs[PACKET_WIDTH]{}, ys[PACKET_WIDTH]{};
+                int activeMask{0};
+                for (int lane{0}; lane < PACKET_WIDTH and firstSampleIdx + lane < sampleCount; ++lane)
+                {
+                    xs[lane] = getSampleX(firstSampleIdx + lane);
+                    ys[lane] = getSampleY(firstSampleIdx + lane);
+                    activeMask |= 1 << lane;
+                }
+
+                ColorRGB sampleColors[PACKET_WIDTH]{};
+                ShadeSamplePacket(context, xs, ys, activeMask, sampleColors, workerIdx);
+                for (const ColorRGB& sampleColor : sampleColors)
+                {
+                    totalColor += sampleColor;
+                }
+            }
+        }
+        else
+        {
+            for (int sampleIdx{0}; sampleIdx < sampleCount; ++sampleIdx)
+            {
+                totalColor += ShadeSample(context, getSampleX(sampleIdx), getSampleY(sampleIdx), workerIdx);
+            }
+        }
 
-        m_pBufferPixels[static_cast<uint32_t>(px) + (static_cast<uint32_t>(py) * m_Width)] = SDL_MapRGB(
-            m_pBuffer->format,
-            static_cast<uint8_t>(finalColor.r * 255),
-            static_cast<uint8_t>(finalColor.g * 255),
-            static_cast<uint8_t>(finalColor.b * 255));
+        pixelColor = totalColor * (1.0f / static_cast<float>(sampleCount + 1));
+        ColorRGB finalColor{pixelColor};
+        UpdateColor(finalColor, px, py);
     }
 
 #pragma region Week 1
@@ -303,7 +693,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W1_Todo3(Scene* pScene) const
@@ -339,7 +729,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W1_Todo4(Scene* pScene) const
@@ -375,7 +765,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W1_Todo5(Scene* pScene) const
@@ -410,7 +800,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W1_Todo6(Scene* pScene) const
@@ -445,7 +835,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W1_Todo7(Scene* pScene) const
@@ -481,7 +871,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W1_Todo8(Scene* pScene) const
@@ -517,7 +907,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 #pragma endregion
 
@@ -578,7 +968,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W2_Todo1_2(Scene* pScene) const
@@ -613,7 +1003,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W2_Todo2(Scene* pScene) const
@@ -649,7 +1039,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W2_Todo4_1(Scene* pScene) const
@@ -688,7 +1078,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W2_Todo4_2(Scene* pScene) const
@@ -726,7 +1116,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W2_Todo5(Scene* pScene) const
@@ -776,7 +1166,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 #pragma endregion
 
@@ -852,7 +1242,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W3_Todo3(Scene* pScene) const
@@ -917,7 +1307,7 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W3_Todo4(Scene* pScene) const
@@ -987,23 +1377,28 @@ namespace dae
         }
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 
     void Renderer::RenderScene_W3_Todo6(Scene* pScene) const
     {
-        Camera& camera = pScene->GetCamera();
-        const Matrix cameraToWorld{camera.CalculateCameraToWorld()};
-        const float FOV{camera.GetFOV()};
-        const auto& lights = pScene->GetLights();
-        const auto& materials = pScene->GetMaterials();
-        const float aspectRatio{static_cast<float>(m_Width) / static_cast<float>(m_Height)};
+        const RenderContext context{MakeRenderContext(pScene)};
         
 #if MULTITHREADING
+        //Only the context is shared, by reference: the par algorithm copies its function object per task
         std::for_each(std::execution::par, m_VerticalIter.begin(), m_VerticalIter.end(),
-                      [this, FOV, camera, cameraToWorld, pScene, lights, materials, aspectRatio](int py)
-                      // [&](int py)
+                      [this, &context](int py)
                       {
+                          const Matrix& cameraToWorld{context.cameraToWorld};
+                          const float FOV{context.FOV};
+                          const auto& lights{context.lights};
+                          const auto& materials{context.materials};
+                          const float aspectRatio{context.aspectRatio};
+                          Scene* pScene{context.pScene};
+
+                          //A row runs on a single thread, so it can own the occluder caches
+                          ShadowCache shadowCache{};
+
                           Vector3 rayDirection;
                           for (int px{}; px < m_Width; ++px)
                           {
@@ -1016,7 +1411,7 @@ namespace dae
                               rayDirection = cameraToWorld.TransformVector(rayDirection);
                               rayDirection.Normalize();
 
-                              Ray viewRay{camera.origin, rayDirection};
+                              Ray viewRay{context.cameraOrigin, rayDirection};
 
                               HitRecord closestHit{};
                               pScene->GetClosestHit(viewRay, closestHit);
@@ -1025,8 +1420,9 @@ namespace dae
                               
                               if (closestHit.didHit)
                               {
-                                  for (const auto& light : lights)
+                                  for (uint32_t lightIdx{0}; lightIdx < lights.size(); ++lightIdx)
                                   {
+                                      const Light& light{lights[lightIdx]};
                                       const Vector3 dirToLight{LightUtils::GetDirectionToLight(light, closestHit.origin)};
                                       const float lightDistance{dirToLight.Magnitude()};
                                       const Vector3 dirToLightNormalized{dirToLight / lightDistance};
@@ -1039,20 +1435,20 @@ namespace dae
                                       {
                                       case LightingMode::ObservedArea:
                                           if (observedArea < 0) continue;
-                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay, shadowCache.Get(lightIdx))) continue;
                                           finalColor += observedArea;
                                           break;
                                       case LightingMode::Radiance:
-                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay, shadowCache.Get(lightIdx))) continue;
                                           finalColor += LightUtils::GetRadiance(light, closestHit.origin);
                                           break;
                                       case LightingMode::BRDF:
-                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay, shadowCache.Get(lightIdx))) continue;
                                           finalColor += materials[closestHit.materialIndex]->Shade(closestHit, dirToLightNormalized, -viewRay.direction);
                                           break;
                                       case LightingMode::Combined:
                                           if (observedArea < 0) continue;
-                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                                          if (m_ShadowsEnabled and pScene->DoesHit(shadowRay, shadowCache.Get(lightIdx))) continue;
                                           finalColor +=
                                               LightUtils::GetRadiance(light, closestHit.origin)
                                               *
@@ -1067,6 +1463,12 @@ namespace dae
                           }
                       });
 #else
+        const Matrix& cameraToWorld{context.cameraToWorld};
+        const float FOV{context.FOV};
+        const auto& lights{context.lights};
+        const auto& materials{context.materials};
+        const float aspectRatio{context.aspectRatio};
+        ShadowCache shadowCache{};
         Vector3 rayDirection;
         
         for (int px{}; px < m_Width; ++px)
@@ -1082,7 +1484,7 @@ namespace dae
                 rayDirection = cameraToWorld.TransformVector(rayDirection);
                 rayDirection.Normalize();
 
-                Ray viewRay{camera.origin, rayDirection};
+                Ray viewRay{context.cameraOrigin, rayDirection};
 
                 HitRecord closestHit{};
                 pScene->GetClosestHit(viewRay, closestHit);
@@ -1091,8 +1493,9 @@ namespace dae
                 
                 if (closestHit.didHit)
                 {
-                    for (const auto& light : lights)
+                    for (uint32_t lightIdx{0}; lightIdx < lights.size(); ++lightIdx)
                     {
+                        const Light& light{lights[lightIdx]};
                         const Vector3 dirToLight{LightUtils::GetDirectionToLight(light, closestHit.origin)};
                         const float lightDistance{dirToLight.Magnitude()};
                         const Vector3 dirToLightNormalized{dirToLight / lightDistance};
@@ -1105,20 +1508,20 @@ namespace dae
                         {
                         case LightingMode::ObservedArea:
                             if (observedArea < 0) continue;
-                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay, shadowCache.Get(lightIdx))) continue;
                             finalColor += observedArea;
                             break;
                         case LightingMode::Radiance:
-                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay, shadowCache.Get(lightIdx))) continue;
                             finalColor += LightUtils::GetRadiance(light, closestHit.origin);
                             break;
                         case LightingMode::BRDF:
-                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay, shadowCache.Get(lightIdx))) continue;
                             finalColor += materials[closestHit.materialIndex]->Shade(closestHit, dirToLightNormalized, -viewRay.direction);
                             break;
                         case LightingMode::Combined:
                             if (observedArea < 0) continue;
-                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                            if (m_ShadowsEnabled and pScene->DoesHit(shadowRay, shadowCache.Get(lightIdx))) continue;
                             finalColor +=
                                 LightUtils::GetRadiance(light, closestHit.origin)
                                 *
@@ -1135,7 +1538,7 @@ namespace dae
 #endif
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
     }
 #pragma endregion
 
@@ -1149,92 +1552,571 @@ namespace dae
 #pragma region Week 5
     void Renderer::RenderScene_W5(Scene* pScene) const
     {
-        Camera& camera = pScene->GetCamera();
-        const Matrix cameraToWorld{camera.CalculateCameraToWorld()};
-        const float FOV{camera.GetFOV()};
-        const float aspectRatio{static_cast<float>(m_Width) / static_cast<float>(m_Height)};
-        
-#if MULTITHREADING
-        std::for_each(std::execution::par, m_PixelIndices.begin(), m_PixelIndices.end(),
-                      [this, FOV, camera, cameraToWorld, pScene, aspectRatio](uint32_t pixelIndex)
-                      // [&](uint32_t pixelIndex)
-                      {
-                          RenderPixel(pScene, pixelIndex, FOV, aspectRatio, cameraToWorld, camera.origin);
-                      });
-#else
+#if PACKET_TRACING
+        if (m_PacketTracingEnabled)
+        {
+            RenderPackets(pScene);
+            return;
+        }
+#endif
+        const RenderContext context{MakeRenderContext(pScene)};
+        if (not BeginAccumulation(context))
+        {
+            Present();
+            return;
+        }
+
+        m_pScheduler->Run(m_Width, m_Height, [this, &context](const Tile& tile, uint32_t workerIdx)
+        {
+            (this->*m_ShadingKernels.pRenderTile)(context, tile, workerIdx);
+        });
+#if ADAPTIVE_AA
+        if (m_AdaptiveAAEnabled and m_SampleIndex == 0) RefineEdges(context);
 #endif
         //@END
         //Update SDL Surface
-        SDL_UpdateWindowSurface(m_pWindow);
+        Present();
+    }
+
+    ColorRGB Renderer::ShadeSample(const RenderContext& context, float x, float y, uint32_t workerIdx) const
+    {
+        return (this->*m_ShadingKernels.pShadeSample)(context, x, y, workerIdx);
+    }
+#pragma endregion
+
+#pragma region Packets
+    void Renderer::RenderPackets(Scene* pScene) const
+    {
+        const RenderContext context{MakeRenderContext(pScene)};
+        if (not BeginAccumulation(context))
+        {
+            Present();
+            return;
+        }
+
+        //Tiles have an even size, so every 2x2 packet lies in exactly one tile
+        m_pScheduler->Run(m_Width, m_Height, [this, &context](const Tile& tile, uint32_t workerIdx)
+        {
+            (this->*m_ShadingKernels.pRenderPacketTile)(context, tile, workerIdx);
+        });
+#if ADAPTIVE_AA
+        if (m_AdaptiveAAEnabled and m_SampleIndex == 0) RefineEdges(context);
+#endif
+        //@END
+        //Update SDL Surface
+        Present();
+    }
+
+    void Renderer::ShadeSamplePacket(const RenderContext& context, const float (&xs)[PACKET_WIDTH], const float (&ys)[PACKET_WIDTH], int activeMask,
+                                     ColorRGB (&finalColors)[PACKET_WIDTH], uint32_t workerIdx) const
+    {
+        (this->*m_ShadingKernels.pShadeSamplePacket)(context, xs, ys, activeMask, finalColors, workerIdx);
+    }
+#pragma endregion
+
+#pragma region Shading Kernels
+    template <Renderer::LightingMode lightingMode, bool shadowsEnabled, typename Materials>
+    Renderer::ShadingKernels Renderer::GetShadingKernels()
+    {
+        return {
+#if WAVEFRONT_SHADING
+            &Renderer::RenderWavefrontTileKernel<lightingMode, shadowsEnabled, false>,
+            &Renderer::RenderWavefrontTileKernel<lightingMode, shadowsEnabled, true>,
+#else
+            &Renderer::RenderTileKernel<lightingMode, shadowsEnabled, Materials>,
+            &Renderer::RenderPacketTileKernel<lightingMode, shadowsEnabled, Materials>,
+#endif
+            &Renderer::ShadeSampleKernel<lightingMode, shadowsEnabled, Materials>,
+            &Renderer::ShadeSamplePacketKernel<lightingMode, shadowsEnabled, Materials>
+        };
+    }
+
+    void Renderer::SelectShadingKernels()
+    {
+        static const ShadingKernels kernels[][2]
+        {
+            {GetShadingKernels<LightingMode::ObservedArea, false, AllMaterials>(), GetShadingKernels<LightingMode::ObservedArea, true, AllMaterials>()},
+            {GetShadingKernels<LightingMode::Radiance, false, AllMaterials>(), GetShadingKernels<LightingMode::Radiance, true, AllMaterials>()},
+            {GetShadingKernels<LightingMode::BRDF, false, AllMaterials>(), GetShadingKernels<LightingMode::BRDF, true, AllMaterials>()},
+            {GetShadingKernels<LightingMode::Combined, false, AllMaterials>(), GetShadingKernels<LightingMode::Combined, true, AllMaterials>()}
+        };
+        m_ShadingKernels = kernels[static_cast<int>(m_CurrentLightingMode)][m_ShadowsEnabled ? 1 : 0];
     }
 
-    void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float FOV, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin) const
+    template <Renderer::LightingMode lightingMode, bool shadowsEnabled, typename Materials>
+    void Renderer::RenderTileKernel(const RenderContext& context, const Tile& tile, uint32_t workerIdx) const
     {
-        const auto& materials{pScene->GetMaterials()};
-        const auto& lights = pScene->GetLights();
+        for (int py{tile.minY}; py < tile.maxY; ++py)
+        {
+            for (int px{tile.minX}; px < tile.maxX; ++px)
+            {
+                const ColorRGB finalColor{
+                    ShadeSampleKernel<lightingMode, shadowsEnabled, Materials>(
+                        context, static_cast<float>(px) + m_SampleOffsetX, static_cast<float>(py) + m_SampleOffsetY, workerIdx)
+                };
+                AccumulateColor(finalColor, px, py);
+            }
+        }
+    }
+
+    template <Renderer::LightingMode lightingMode, bool shadowsEnabled, typename Materials>
+    void Renderer::RenderPacketTileKernel(const RenderContext& context, const Tile& tile, uint32_t workerIdx) const
+    {
+        //Tiles have an even size, so every 2x2 packet lies in exactly one tile
+        for (int startY{tile.minY}; startY < tile.maxY; startY += 2)
+        {
+            for (int startX{tile.minX}; startX < tile.maxX; startX += 2)
+            {
+                //Lanes: top-left, top-right, bottom-left, bottom-right
+                int pxs[PACKET_WIDTH], pys[PACKET_WIDTH];
+                float xs[PACKET_WIDTH]{}, ys[PACKET_WIDTH]{};
+                int activeMask{0};
+                for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+                {
+                    pxs[lane] = startX + lane % 2;
+                    pys[lane] = startY + lane / 2;
+                    if (pxs[lane] >= m_Width or pys[lane] >= m_Height) continue;
+                    activeMask |= 1 << lane;
+
+                    xs[lane] = static_cast<float>(pxs[lane]) + m_SampleOffsetX;
+                    ys[lane] = static_cast<float>(pys[lane]) + m_SampleOffsetY;
+                }
+
+                ColorRGB finalColors[PACKET_WIDTH]{};
+                ShadeSamplePacketKernel<lightingMode, shadowsEnabled, Materials>(
+                    context, xs, ys, activeMask, finalColors, workerIdx);
+
+                for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+                {
+                    if (activeMask & (1 << lane)) AccumulateColor(finalColors[lane], pxs[lane], pys[lane]);
+                }
+            }
+        }
+    }
 
-        const uint32_t px{pixelIndex % m_Width};
-        const uint32_t py{pixelIndex / m_Width};
+    template <Renderer::LightingMode lightingMode, bool shadowsEnabled, typename Materials>
+    ColorRGB Renderer::ShadeSampleKernel(const RenderContext& context, float x, float y, uint32_t workerIdx) const
+    {
+        const auto& materials{context.materials};
+        const auto& lights{context.lights};
+        ShadowCache& shadowCache{m_pShadowCaches[workerIdx]};
 
-        const float rx{(static_cast<float>(px) + 0.5f) / static_cast<float>(m_Width) * 2.0f - 1.0f};
-        const float ry{1.0f - (static_cast<float>(py) + 0.5f) / static_cast<float>(m_Height) * 2.0f};
+        const float rx{x / static_cast<float>(m_Width) * 2.0f - 1.0f};
+        const float ry{1.0f - y / static_cast<float>(m_Height) * 2.0f};
         
         Vector3 rayDirection;
-        rayDirection.x = rx * aspectRatio * FOV;
-        rayDirection.y = ry * FOV;
+        rayDirection.x = rx * context.aspectRatio * context.FOV;
+        rayDirection.y = ry * context.FOV;
         rayDirection.z = 1.0f;
-        rayDirection = cameraToWorld.TransformVector(rayDirection);
+        rayDirection = context.cameraToWorld.TransformVector(rayDirection);
         rayDirection.Normalize();
 
-        const Ray viewRay{cameraOrigin, rayDirection};
+        const Ray viewRay{context.cameraOrigin, rayDirection};
 
         HitRecord closestHit{};
-        pScene->GetClosestHit(viewRay, closestHit);
+        context.pScene->GetClosestHit(viewRay, closestHit);
 
         ColorRGB finalColor{};
         if (closestHit.didHit)
         {
-            for (const auto& light : lights)
+            for (uint32_t lightIdx{0}; lightIdx < lights.size(); ++lightIdx)
             {
+                const Light& light{lights[lightIdx]};
                 const Vector3 dirToLight{LightUtils::GetDirectionToLight(light, closestHit.origin)};
                 const float lightDistance{dirToLight.Magnitude()};
                 const Vector3 dirToLightNormalized{dirToLight / lightDistance};
                 
-                Ray shadowRay{closestHit.origin + closestHit.normal * 0.001f, dirToLightNormalized, 0.0001f, lightDistance};
-                
                 const float observedArea{Vector3::Dot(dirToLightNormalized, closestHit.normal)};
-                
-                switch (m_CurrentLightingMode)
+                if constexpr (lightingMode == LightingMode::ObservedArea or lightingMode == LightingMode::Combined)
                 {
-                case LightingMode::ObservedArea:
                     if (observedArea < 0) continue;
-                    if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                }
+
+                if constexpr (shadowsEnabled)
+                {
+                    const Ray shadowRay{closestHit.origin + closestHit.normal * 0.001f, dirToLightNormalized, 0.0001f, lightDistance};
+                    if (context.pScene->DoesHit(shadowRay, shadowCache.Get(lightIdx))) continue;
+                }
+
+                if constexpr (lightingMode == LightingMode::ObservedArea)
+                {
                     finalColor += observedArea;
-                    break;
-                case LightingMode::Radiance:
-                    if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                }
+                else if constexpr (lightingMode == LightingMode::Radiance)
+                {
                     finalColor += LightUtils::GetRadiance(light, closestHit.origin);
-                    break;
-                case LightingMode::BRDF:
-                    if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
-                    finalColor += materials[closestHit.materialIndex]->Shade(
-                        closestHit, dirToLightNormalized, -viewRay.direction);
-                    break;
-                case LightingMode::Combined:
-                    if (observedArea < 0) continue;
-                    if (m_ShadowsEnabled and pScene->DoesHit(shadowRay)) continue;
+                }
+                else if constexpr (lightingMode == LightingMode::BRDF)
+                {
+                    finalColor += Materials::Shade(materials[closestHit.materialIndex], closestHit, dirToLightNormalized, -viewRay.direction);
+                }
+                else
+                {
                     finalColor +=
                         LightUtils::GetRadiance(light, closestHit.origin)
                         *
-                        materials[closestHit.materialIndex]->Shade(
-                            closestHit, dirToLightNormalized, -viewRay.direction)
+                        Materials::Shade(materials[closestHit.materialIndex], closestHit, dirToLightNormalized, -viewRay.direction)
                         *
                         observedArea;
-                    break;
                 }
             }
         }
-        UpdateColor(finalColor, static_cast<int>(px), static_cast<int>(py));
+        return finalColor;
+    }
+
+    template <Renderer::LightingMode lightingMode, bool shadowsEnabled, typename Materials>
+    void Renderer::ShadeSamplePacketKernel(const RenderContext& context, const float (&xs)[PACKET_WIDTH], const float (&ys)[PACKET_WIDTH], int activeMask,
+                                           ColorRGB (&finalColors)[PACKET_WIDTH], uint32_t workerIdx) const
+    {
+        const auto& materials{context.materials};
+        const auto& lights{context.lights};
+        ShadowCache& shadowCache{m_pShadowCaches[workerIdx]};
+
+        Ray viewRays[PACKET_WIDTH]{};
+        for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+        {
+            finalColors[lane] = {};
+            if (not (activeMask & (1 << lane))) continue;
+
+            const float rx{xs[lane] / static_cast<float>(m_Width) * 2.0f - 1.0f};
+            const float ry{1.0f - ys[lane] / static_cast<float>(m_Height) * 2.0f};
+
+            Vector3 rayDirection;
+            rayDirection.x = rx * context.aspectRatio * context.FOV;
+            rayDirection.y = ry * context.FOV;
+            rayDirection.z = 1.0f;
+            rayDirection = context.cameraToWorld.TransformVector(rayDirection);
+            rayDirection.Normalize();
+
+            viewRays[lane] = {context.cameraOrigin, rayDirection};
+        }
+
+        HitRecord closestHits[PACKET_WIDTH]{};
+        context.pScene->GetClosestHitPacket(RayPacket{viewRays, activeMask}, closestHits);
+
+        constexpr bool needsObservedArea{
+            lightingMode == LightingMode::ObservedArea or lightingMode == LightingMode::Combined
+        };
+
+        for (uint32_t lightIdx{0}; lightIdx < lights.size(); ++lightIdx)
+        {
+            const Light& light{lights[lightIdx]};
+            Ray shadowRays[PACKET_WIDTH]{};
+            Vector3 dirsToLight[PACKET_WIDTH]{};
+            float observedAreas[PACKET_WIDTH]{};
+            int shadowMask{0};
+            for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+            {
+                const HitRecord& closestHit{closestHits[lane]};
+                if (not closestHit.didHit) continue;
+
+                const Vector3 dirToLight{LightUtils::GetDirectionToLight(light, closestHit.origin)};
+                const float lightDistance{dirToLight.Magnitude()};
+                dirsToLight[lane] = dirToLight / lightDistance;
+                observedAreas[lane] = Vector3::Dot(dirsToLight[lane], closestHit.normal);
+                if (needsObservedArea and observedAreas[lane] < 0) continue;
+
+                shadowRays[lane] = {closestHit.origin + closestHit.normal * 0.001f, dirsToLight[lane], 0.0001f, lightDistance};
+                shadowMask |= 1 << lane;
+            }
+
+            //All shadow rays of the packet share the light, so they stay as coherent as the view rays
+            if constexpr (shadowsEnabled)
+            {
+                if (shadowMask != 0) shadowMask &= ~context.pScene->DoesHitPacket(RayPacket{shadowRays, shadowMask}, shadowCache.Get(lightIdx));
+            }
+
+            for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+            {
+                if (not (shadowMask & (1 << lane))) continue;
+
+                const HitRecord& closestHit{closestHits[lane]};
+                if constexpr (lightingMode == LightingMode::ObservedArea)
+                {
+                    finalColors[lane] += observedAreas[lane];
+                }
+                else if constexpr (lightingMode == LightingMode::Radiance)
+                {
+                    finalColors[lane] += LightUtils::GetRadiance(light, closestHit.origin);
+                }
+                else if constexpr (lightingMode == LightingMode::BRDF)
+                {
+                    finalColors[lane] += Materials::Shade(materials[closestHit.materialIndex], closestHit, dirsToLight[lane], -viewRays[lane].direction);
+                }
+                else
+                {
+                    finalColors[lane] +=
+                        LightUtils::GetRadiance(light, closestHit.origin)
+                        *
+                        Materials::Shade(materials[closestHit.materialIndex], closestHit, dirsToLight[lane], -viewRays[lane].direction)
+                        *
+                        observedAreas[lane];
+                }
+            }
+        }
+    }
+
+    template <Renderer::LightingMode lightingMode, bool shadowsEnabled, bool packetTracing>
+    void Renderer::RenderWavefrontTileKernel(const RenderContext& context, const Tile& tile, uint32_t workerIdx) const
+    {
+        const auto& materials{context.materialTable};
+        const auto& lights{context.lights};
+
+        //Room for the tile rounded up to whole 2x2 packets
+        WavefrontBuffers& buffers{m_pWavefrontBuffers[workerIdx]};
+        ShadowCache& shadowCache{m_pShadowCaches[workerIdx]};
+        const int tileWidth{(tile.maxX - tile.minX + 1) / 2 * 2};
+        const int tileHeight{(tile.maxY - tile.minY + 1) / 2 * 2};
+        buffers.Reserve(static_cast<uint32_t>(tileWidth * tileHeight));
+
+        const auto getViewRay{[&](int px, int py)
+        {
+            const float rx{(static_cast<float>(px) + m_SampleOffsetX) / static_cast<float>(m_Width) * 2.0f - 1.0f};
+            const float ry{1.0f - (static_cast<float>(py) + m_SampleOffsetY) / static_cast<float>(m_Height) * 2.0f};
+
+            Vector3 rayDirection;
+            rayDirection.x = rx * context.aspectRatio * context.FOV;
+            rayDirection.y = ry * context.FOV;
+            rayDirection.z = 1.0f;
+            rayDirection = context.cameraToWorld.TransformVector(rayDirection);
+            rayDirection.Normalize();
+
+            return Ray{context.cameraOrigin, rayDirection};
+        }};
+
+        //A frame through the pixel centres with unchanged visibility takes the entries from the G-buffer, see GBUFFER_CACHING
+        GBuffer& gBuffer{*m_pGBuffer};
+        const bool isGBufferRead{gBuffer.frameUsage == GBuffer::FrameUsage::Read};
+        const auto readGBufferEntry{[&](uint32_t entryIdx, int px, int py)
+        {
+            const bool isInFrame{px < m_Width and py < m_Height};
+            buffers.pixelXs[entryIdx] = isInFrame ? px : -1;
+            buffers.pixelYs[entryIdx] = py;
+            if (not isInFrame)
+            {
+                buffers.hits[entryIdx] = {};
+                return;
+            }
+
+            const size_t pixelIdx{static_cast<size_t>(py) * m_Width + px};
+            buffers.hits[entryIdx] = gBuffer.hits[pixelIdx];
+            buffers.viewDirections[entryIdx] = gBuffer.viewDirections[pixelIdx];
+        }};
+
+        //Trace stage: one hit per pixel, a packet fills 4 consecutive entries (top-left, top-right, bottom-left, bottom-right)
+        uint32_t entryCount{0};
+        if constexpr (packetTracing)
+        {
+            for (int startY{tile.minY}; startY < tile.maxY; startY += 2)
+            {
+                for (int startX{tile.minX}; startX < tile.maxX; startX += 2)
+                {
+                    if (isGBufferRead)
+                    {
+                        for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+                        {
+                            readGBufferEntry(entryCount++, startX + lane % 2, startY + lane / 2);
+                        }
+                        continue;
+                    }
+
+                    Ray viewRays[PACKET_WIDTH]{};
+                    int activeMask{0};
+                    for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+                    {
+                        const int px{startX + lane % 2};
+                        const int py{startY + lane / 2};
+                        const bool isInFrame{px < m_Width and py < m_Height};
+                        buffers.pixelXs[entryCount + lane] = isInFrame ? px : -1;
+                        buffers.pixelYs[entryCount + lane] = py;
+                        if (not isInFrame) continue;
+
+                        activeMask |= 1 << lane;
+                        viewRays[lane] = getViewRay(px, py);
+                    }
+
+                    HitRecord closestHits[PACKET_WIDTH]{};
+                    context.pScene->GetClosestHitPacket(RayPacket{viewRays, activeMask}, closestHits);
+                    for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+                    {
+                        buffers.hits[entryCount] = closestHits[lane];
+                        buffers.viewDirections[entryCount] = -viewRays[lane].direction;
+                        ++entryCount;
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (int py{tile.minY}; py < tile.maxY; ++py)
+            {
+                for (int px{tile.minX}; px < tile.maxX; ++px)
+                {
+                    if (isGBufferRead)
+                    {
+                        readGBufferEntry(entryCount++, px, py);
+                        continue;
+                    }
+
+                    const Ray viewRay{getViewRay(px, py)};
+                    buffers.hits[entryCount] = {};
+                    context.pScene->GetClosestHit(viewRay, buffers.hits[entryCount]);
+                    buffers.viewDirections[entryCount] = -viewRay.direction;
+                    buffers.pixelXs[entryCount] = px;
+                    buffers.pixelYs[entryCount] = py;
+                    ++entryCount;
+                }
+            }
+        }
+        if (gBuffer.frameUsage == GBuffer::FrameUsage::Write)
+        {
+            for (uint32_t entryIdx{0}; entryIdx < entryCount; ++entryIdx)
+            {
+                if (buffers.pixelXs[entryIdx] < 0) continue;
+
+                const size_t pixelIdx{static_cast<size_t>(buffers.pixelYs[entryIdx]) * m_Width + buffers.pixelXs[entryIdx]};
+                gBuffer.hits[pixelIdx] = buffers.hits[entryIdx];
+                gBuffer.viewDirections[pixelIdx] = buffers.viewDirections[entryIdx];
+            }
+        }
+        std::fill_n(buffers.colors.begin(), entryCount, ColorRGB{});
+
+        constexpr bool needsObservedArea{
+            lightingMode == LightingMode::ObservedArea or lightingMode == LightingMode::Combined
+        };
+
+        //Shading stage, light by light so every pixel sums its lights in the same order as the per-pixel kernels
+        for (uint32_t lightIdx{0}; lightIdx < lights.size(); ++lightIdx)
+        {
+            const Light& light{lights[lightIdx]};
+            PrimitiveHit& lastOccluder{shadowCache.Get(lightIdx)};
+
+            //Direction to the light of an entry, false if the light can not reach it
+            const auto prepareLightSample{[&](uint32_t entryIdx, Ray& shadowRay)
+            {
+                const HitRecord& closestHit{buffers.hits[entryIdx]};
+                if (not closestHit.didHit) return false;
+
+                const Vector3 dirToLight{LightUtils::GetDirectionToLight(light, closestHit.origin)};
+                const float lightDistance{dirToLight.Magnitude()};
+                buffers.dirsToLight[entryIdx] = dirToLight / lightDistance;
+                buffers.observedAreas[entryIdx] = Vector3::Dot(buffers.dirsToLight[entryIdx], closestHit.normal);
+                if (needsObservedArea and buffers.observedAreas[entryIdx] < 0) return false;
+
+                shadowRay = {closestHit.origin + closestHit.normal * 0.001f, buffers.dirsToLight[entryIdx], 0.0001f, lightDistance};
+                return true;
+            }};
+
+            uint32_t sampleCount{0};
+            if constexpr (packetTracing)
+            {
+                //The entries of a packet share the light, so their shadow rays stay as coherent as the view rays
+                for (uint32_t firstIdx{0}; firstIdx < entryCount; firstIdx += PACKET_WIDTH)
+                {
+                    Ray shadowRays[PACKET_WIDTH]{};
+                    int shadowMask{0};
+                    for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+                    {
+                        if (prepareLightSample(firstIdx + lane, shadowRays[lane])) shadowMask |= 1 << lane;
+                    }
+
+                    if constexpr (shadowsEnabled)
+                    {
+                        if (shadowMask != 0) shadowMask &= ~context.pScene->DoesHitPacket(RayPacket{shadowRays, shadowMask}, lastOccluder);
+                    }
+
+                    for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+                    {
+                        if (shadowMask & (1 << lane)) buffers.samples[sampleCount++] = firstIdx + lane;
+                    }
+                }
+            }
+            else
+            {
+                for (uint32_t entryIdx{0}; entryIdx < entryCount; ++entryIdx)
+                {
+                    Ray shadowRay{};
+                    if (not prepareLightSample(entryIdx, shadowRay)) continue;
+
+                    if constexpr (shadowsEnabled)
+                    {
+                        if (context.pScene->DoesHit(shadowRay, lastOccluder)) continue;
+                    }
+                    buffers.samples[sampleCount++] = entryIdx;
+                }
+            }
+
+            if constexpr (lightingMode == LightingMode::ObservedArea)
+            {
+                for (uint32_t sampleIdx{0}; sampleIdx < sampleCount; ++sampleIdx)
+                {
+                    const uint32_t entryIdx{buffers.samples[sampleIdx]};
+                    buffers.colors[entryIdx] += buffers.observedAreas[entryIdx];
+                }
+            }
+            else if constexpr (lightingMode == LightingMode::Radiance)
+            {
+                for (uint32_t sampleIdx{0}; sampleIdx < sampleCount; ++sampleIdx)
+                {
+                    const uint32_t entryIdx{buffers.samples[sampleIdx]};
+                    buffers.colors[entryIdx] += LightUtils::GetRadiance(light, buffers.hits[entryIdx].origin);
+                }
+            }
+            else
+            {
+                //Counting sort by material type, every type then shades one contiguous range of the batch
+                uint32_t typeBegins[MATERIAL_TYPE_COUNT + 1]{};
+                for (uint32_t sampleIdx{0}; sampleIdx < sampleCount; ++sampleIdx)
+                {
+                    const HitRecord& closestHit{buffers.hits[buffers.samples[sampleIdx]]};
+                    ++typeBegins[static_cast<int>(materials[closestHit.materialIndex].type) + 1];
+                }
+                for (int typeIdx{0}; typeIdx < MATERIAL_TYPE_COUNT; ++typeIdx)
+                {
+                    typeBegins[typeIdx + 1] += typeBegins[typeIdx];
+                }
+
+                uint32_t typeCursors[MATERIAL_TYPE_COUNT];
+                std::copy_n(typeBegins, MATERIAL_TYPE_COUNT, typeCursors);
+                for (uint32_t sampleIdx{0}; sampleIdx < sampleCount; ++sampleIdx)
+                {
+                    const uint32_t entryIdx{buffers.samples[sampleIdx]};
+                    const HitRecord& closestHit{buffers.hits[entryIdx]};
+                    const uint32_t batchIdx{typeCursors[static_cast<int>(materials[closestHit.materialIndex].type)]++};
+                    buffers.batch.Set(batchIdx, closestHit.normal, buffers.dirsToLight[entryIdx], buffers.viewDirections[entryIdx], closestHit.materialIndex);
+                    buffers.sortedSamples[batchIdx] = entryIdx;
+                }
+
+                for (int typeIdx{0}; typeIdx < MATERIAL_TYPE_COUNT; ++typeIdx)
+                {
+                    if (typeBegins[typeIdx] == typeBegins[typeIdx + 1]) continue;
+                    ShadeBatch(static_cast<MaterialType>(typeIdx), materials, buffers.batch, typeBegins[typeIdx], typeBegins[typeIdx + 1]);
+                }
+
+                for (uint32_t batchIdx{0}; batchIdx < sampleCount; ++batchIdx)
+                {
+                    const uint32_t entryIdx{buffers.sortedSamples[batchIdx]};
+                    if constexpr (lightingMode == LightingMode::BRDF)
+                    {
+                        buffers.colors[entryIdx] += buffers.batch.GetColor(batchIdx);
+                    }
+                    else
+                    {
+                        buffers.colors[entryIdx] +=
+                            LightUtils::GetRadiance(light, buffers.hits[entryIdx].origin)
+                            *
+                            buffers.batch.GetColor(batchIdx)
+                            *
+                            buffers.observedAreas[entryIdx];
+                    }
+                }
+            }
+        }
+
+        for (uint32_t entryIdx{0}; entryIdx < entryCount; ++entryIdx)
+        {
+            if (buffers.pixelXs[entryIdx] >= 0) AccumulateColor(buffers.colors[entryIdx], buffers.pixelXs[entryIdx], buffers.pixelYs[entryIdx]);
+        }
     }
 #pragma endregion
 }
@@ -1,5 +1,13 @@
 #pragma once
 
+#include "ColorRGB.h"
+#include "Matrix.h"
+#include "RayPacket.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
 struct SDL_Window;
@@ -7,16 +15,24 @@ struct SDL_Surface;
 
 namespace dae
 {
-    struct ColorRGB;
-    struct Matrix;
-    struct Vector3;
     class Scene;
+    class Material;
+    class TileScheduler;
+    class ImageWriter;
+    struct Tile;
+    struct Light;
+    struct MaterialData;
 
     class Renderer final
     {
     public:
         Renderer(SDL_Window* pWindow);
-        ~Renderer() = default;
+
+        /**
+         * \brief Headless renderer: only the in-memory framebuffer, no window and no SDL surface
+         */
+        Renderer(int width, int height);
+        ~Renderer();
 
         Renderer(const Renderer&) = delete;
         Renderer(Renderer&&) noexcept = delete;
@@ -25,11 +41,98 @@ namespace dae
 
         void Render(Scene* pScene) const;
         void DyanmicRender(Scene* pScene) const;
-        bool SaveBufferToImage() const;
+
+        /**
+         * \brief Snapshots the frame and writes it on a background thread, the extension picks the format (.png, .pfm, .ppm) \n
+         * .pfm keeps the HDR colours of Render, RenderScene_W5 and the packets, the week exercises only have 8-bit colours
+         * \return false if the extension is not supported
+         */
+        bool SaveBufferToImage(const std::string& filePath = "RayTracing_Buffer.png") const;
+
+        /**
+         * \brief Saves the G-buffer of the last frame as three images, depth, normal and material index: out.png gives out_depth.png, ... \n
+         * .pfm keeps the raw distance, normal and index, the 8-bit formats show near as bright, normals mapped to 0-1 and a colour per material
+         * \return false if the last frame has no G-buffer (a week exercise, see GBUFFER_CACHING) or the extension is not supported
+         */
+        bool SaveAOVsToImages(const std::string& filePath = "RayTracing_AOV.png") const;
+
+        /**
+         * \brief Waits until every saved image is on disk
+         * \return true if all of them were written
+         */
+        bool WaitForSavedImages() const;
+
         void ToggleShadow();
         void SwitchLightingMode();
+        void TogglePacketTracing();
+
+        /**
+         * \brief While on, frames with an unchanged camera and scene add a jittered sample to the accumulated image
+         */
+        void ToggleAccumulation();
+        void SetAccumulation(bool isEnabled);
+
+        /**
+         * \brief While on, a frame with the camera and geometry of the last one reuses its primary hits, see GBUFFER_CACHING \n
+         * The G-buffer is written either way, so SaveAOVsToImages keeps working
+         */
+        void SetGBufferReuse(bool isEnabled);
+
+        /**
+         * \brief While on, pixels that differ from their neighbours get extra stratified samples, see ADAPTIVE_AA \n
+         * Only frames that restart the accumulation are refined, a still view is anti-aliased by the accumulation itself
+         */
+        void ToggleAdaptiveAA();
+        void SetAdaptiveAA(bool isEnabled);
+
+        /**
+         * \brief Refined pixels trace subdivisions x subdivisions extra samples, clamped to [1, MAX_AA_SUBDIVISIONS]
+         */
+        void SetAASubdivisions(int subdivisions);
+
+        /**
+         * \brief Luminance difference (0-1) between a pixel and one of its 4 neighbours above which the pixel is refined
+         */
+        void SetAAContrastThreshold(float threshold);
+
+        bool IsAdaptiveAAEnabled() const { return m_AdaptiveAAEnabled; }
+        int GetAASubdivisions() const { return m_AASubdivisions; }
+        float GetAAContrastThreshold() const { return m_AAContrastThreshold; }
+
+        /**
+         * \brief Pixels the adaptive AA supersampled in the last frame it ran
+         */
+        uint32_t GetAARefinedPixelCount() const { return m_AARefinedPixelCount; }
+
+        /**
+         * \brief Render threads including the calling one, 0 uses every hardware thread
+         */
+        void SetThreadCount(uint32_t threadCount);
+
+        /**
+         * \brief Edge length of the square tiles the frame is split into, rounded up to an even size
+         */
+        void SetTileSize(int tileSize);
+
+        uint32_t GetThreadCount() const;
+        int GetTileSize() const;
+
+        int GetWidth() const { return m_Width; }
+        int GetHeight() const { return m_Height; }
+
+        /**
+         * \brief Row-major 0x00RRGGBB pixels of the last rendered frame
+         */
+        const std::vector<uint32_t>& GetPixels() const { return m_Pixels; }
 
     private:
+        void Initialize();
+
+        /**
+         * \brief Copies the framebuffer to the window, does nothing for a headless renderer
+         */
+        void Present() const;
+
         void RenderScene_W1(Scene* pScene) const;
         void RenderScene_W1_Todo2(Scene* pScene) const;
         void RenderScene_W1_Todo3(Scene* pScene) const;
@@ -56,10 +159,65 @@ namespace dae
         void RenderScene_W4(Scene* pScene) const;
 
         void RenderScene_W5(Scene* pScene) const;
-        void RenderPixel(Scene* pScene, uint32_t pixelIndex, float FOV, float aspectRatio, const Matrix& cameraToWorld, const Vector3& cameraOrigin) const;
+        void RenderPackets(Scene* pScene) const;
+
+        /**
+         * \brief Everything the render threads read during one frame, built once per frame by MakeRenderContext \n
+         * Immutable while the tiles run and handed to the workers by reference, so no task copies the camera, the lights or the materials
+         */
+        struct RenderContext
+        {
+            Scene*                           pScene;
+            const std::vector<Light>&        lights;
+            const std::vector<Material*>&    materials;
+            const std::vector<MaterialData>& materialTable;
+            Matrix                           cameraToWorld;
+            Vector3                          cameraOrigin;
+            float                            FOV;
+            float                            aspectRatio;
+        };
+
+        RenderContext MakeRenderContext(Scene* pScene) const;
+
+        /**
+         * \brief HDR colour seen through the image position (x, y), in pixels from the top-left corner of the frame
+         * \param workerIdx Scheduler thread that shades the sample, picks its occluder caches
+         */
+        ColorRGB ShadeSample(const RenderContext& context, float x, float y, uint32_t workerIdx) const;
+
+        /**
+         * \brief ShadeSample for up to 4 image positions at once, lanes outside activeMask come back black
+         */
+        void ShadeSamplePacket(const RenderContext& context, const float (&xs)[PACKET_WIDTH], const float (&ys)[PACKET_WIDTH], int activeMask,
+                               ColorRGB (&finalColors)[PACKET_WIDTH], uint32_t workerIdx) const;
+
+        /**
+         * \brief Adaptive AA after the base samples of a frame: flags the high-contrast pixels, then supersamples only those
+         */
+        void RefineEdges(const RenderContext& context) const;
+        bool IsEdgePixel(int px, int py) const;
+        void RefinePixel(const RenderContext& context, int px, int py, uint32_t workerIdx) const;
 
         void UpdateColor(ColorRGB& finalColor, int px, int py) const;
 
+        /**
+         * \brief Picks this frame's sample: restarts the accumulation if the camera, the scene or a render setting changed \n
+         * Sets the sub-pixel offset every ray of the frame uses
+         * \return false once the image has converged, the frame then only has to be presented
+         */
+        bool BeginAccumulation(const RenderContext& context) const;
+
+        /**
+         * \brief Decides whether the frame shades from the G-buffer or traces and refreshes it, see GBUFFER_CACHING \n
+         * Only frames through the pixel centres use it, BeginAccumulation calls it once the sample is picked
+         */
+        void BeginGBuffer(const RenderContext& context) const;
+
+        /**
+         * \brief Adds the sample to the HDR accumulation buffer and writes the running average to the framebuffer
+         */
+        void AccumulateColor(const ColorRGB& sample, int px, int py) const;
+
     private:
         enum class LightingMode
         {
@@ -104,20 +262,134 @@ namespace dae
             Todo13
         };
 
+        /**
+         * \brief Render loops of Render, RenderScene_W5 and RenderPackets, instantiated per lighting mode, shadow setting and MaterialSet \n
+         * The per-light lighting switch and shadow test fold away at compile time and the materials shade without virtual calls
+         */
+        template <LightingMode lightingMode, bool shadowsEnabled, typename Materials>
+        void RenderTileKernel(const RenderContext& context, const Tile& tile, uint32_t workerIdx) const;
+
+        template <LightingMode lightingMode, bool shadowsEnabled, typename Materials>
+        void RenderPacketTileKernel(const RenderContext& context, const Tile& tile, uint32_t workerIdx) const;
+
+        template <LightingMode lightingMode, bool shadowsEnabled, typename Materials>
+        ColorRGB ShadeSampleKernel(const RenderContext& context, float x, float y, uint32_t workerIdx) const;
+
+        template <LightingMode lightingMode, bool shadowsEnabled, typename Materials>
+        void ShadeSamplePacketKernel(const RenderContext& context, const float (&xs)[PACKET_WIDTH], const float (&ys)[PACKET_WIDTH], int activeMask,
+                                     ColorRGB (&finalColors)[PACKET_WIDTH], uint32_t workerIdx) const;
+
+        /**
+         * \brief Wavefront version of RenderTileKernel and RenderPacketTileKernel, see WAVEFRONT_SHADING \n
+         * Traces every pixel of the tile into a hit buffer (as 2x2 packets if packetTracing) or copies it from the G-buffer, then per light tests the shadow rays \n
+         * and shades the lit samples with one ShadeBatch call per material type, from the scene's material table
+         */
+        template <LightingMode lightingMode, bool shadowsEnabled, bool packetTracing>
+        void RenderWavefrontTileKernel(const RenderContext& context, const Tile& tile, uint32_t workerIdx) const;
+
+        /**
+         * \brief One instantiation of every kernel, all for the same lighting mode, shadow setting and materials
+         */
+        struct ShadingKernels
+        {
+            using RenderTileFunction = void (Renderer::*)(const RenderContext&, const Tile&, uint32_t) const;
+            using ShadeSampleFunction = ColorRGB (Renderer::*)(const RenderContext&, float, float, uint32_t) const;
+            using ShadeSamplePacketFunction = void (Renderer::*)(const RenderContext&, const float (&)[PACKET_WIDTH], const float (&)[PACKET_WIDTH], int,
+                                                                 ColorRGB (&)[PACKET_WIDTH], uint32_t) const;
+
+            RenderTileFunction        pRenderTile        {nullptr};
+            RenderTileFunction        pRenderPacketTile  {nullptr};
+            ShadeSampleFunction       pShadeSample       {nullptr};
+            ShadeSamplePacketFunction pShadeSamplePacket {nullptr};
+        };
+
+        template <LightingMode lightingMode, bool shadowsEnabled, typename Materials>
+        static ShadingKernels GetShadingKernels();
+
+        /**
+         * \brief Picks the kernels for the current lighting mode and shadow setting, called whenever one of them changes \n
+         * A frame then costs one indirect call per tile instead of a switch and a virtual Shade per light per pixel
+         */
+        void SelectShadingKernels();
+
+        /**
+         * \brief Allocates the wavefront scratch memory of every worker for a full tile and the occluder caches, called whenever the thread count or tile size changes
+         */
+        void ReserveWorkerBuffers();
+
     private:
         SDL_Window*  m_pWindow       {nullptr};
         SDL_Surface* m_pBuffer       {nullptr};
         uint32_t*    m_pBufferPixels {nullptr};
 
+        //Owned framebuffer, m_pBufferPixels points into it
+        std::vector<uint32_t> m_Pixels {};
+
         int m_Width  {0};
         int m_Height {0};
 
         LightingMode m_CurrentLightingMode {LightingMode::Combined};
+
+        //Kernels for m_CurrentLightingMode and m_ShadowsEnabled, see SelectShadingKernels
+        ShadingKernels m_ShadingKernels {};
         
-        bool m_ShadowsEnabled {true};
+        bool m_ShadowsEnabled       {true};
+        bool m_PacketTracingEnabled {true};
+        bool m_AccumulationEnabled  {true};
+        bool m_GBufferReuseEnabled  {true};
+        bool m_AdaptiveAAEnabled    {false};
+
+        int   m_AASubdivisions      {2};
+        float m_AAContrastThreshold {0.1f};
+
+        std::vector<int> m_HorizontalIter {};
+        std::vector<int> m_VerticalIter   {};
+
+        //Packets are numbered per 2x2 pixel block, rows of m_PacketCountX packets
+        int m_PacketCountX {0};
+
+        //Renders Render, RenderScene_W5 and RenderPackets, the week exercises keep their own loops
+        std::unique_ptr<TileScheduler> m_pScheduler {};
+
+        //One per scheduler thread, indexed by the workerIdx of TileScheduler::Run
+        struct WavefrontBuffers;
+        std::unique_ptr<WavefrontBuffers[]> m_pWavefrontBuffers {};
+
+        //Last occluder per light of every worker, see OCCLUDER_CACHE
+        struct ShadowCache;
+        std::unique_ptr<ShadowCache[]> m_pShadowCaches {};
+
+        //Primary hits of the last frame through the pixel centres, see GBUFFER_CACHING
+        struct GBuffer;
+        std::unique_ptr<GBuffer> m_pGBuffer {};
+
+        //Encodes saved images on its own thread
+        std::unique_ptr<ImageWriter> m_pImageWriter {};
+
+        //Progressive accumulation of those three paths, see PROGRESSIVE_ACCUMULATION
+        //Set by BeginAccumulation before the tiles run, the render threads only read them
+        static constexpr uint32_t MAX_ACCUMULATED_SAMPLES{1024};
+
+        mutable std::vector<ColorRGB> m_AccumulationBuffer  {};
+        mutable uint32_t              m_SampleIndex         {0};
+        mutable float                 m_SampleWeight        {1.0f};
+        mutable float                 m_SampleOffsetX       {0.5f};
+        mutable float                 m_SampleOffsetY       {0.5f};
+        mutable bool                  m_IsAccumulationDirty {true};
+
+        //False after a week exercise, which only writes the 8-bit framebuffer
+        mutable bool m_IsFrameHDR {false};
+
+        //Adaptive AA, 1 for the pixels RefineEdges supersamples this frame
+        static constexpr int MAX_AA_SUBDIVISIONS{8};
+
+        mutable std::vector<uint8_t>  m_EdgeMask            {};
+        mutable std::atomic<uint32_t> m_AARefinedPixelCount {0};
 
-        std::vector<int>      m_HorizontalIter {};
-        std::vector<int>      m_VerticalIter   {};
-        std::vector<uint32_t> m_PixelIndices   {};
+        //What the accumulated samples were rendered with
+        mutable Matrix       m_AccumulatedCameraToWorld   {};
+        mutable float        m_AccumulatedFOV             {0.0f};
+        mutable const Scene* m_pAccumulatedScene          {nullptr};
+        mutable uint64_t     m_AccumulatedGeometryVersion {0};
     };
 }
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+#include <type_traits>
+
+namespace dae
+{
+    /**
+     * \brief Lane types of the wide BRDFs: float (1 lane), Float4 (SSE) and Float8 (AVX2) \n
+     * All three have the same operators and free functions, so one templated function body compiles for every width \n
+     * Comparisons return a mask of the same type (bool for float), which Select consumes
+     */
+#pragma region Float4
+    struct Float4
+    {
+        static constexpr int width{4};
+
+        __m128 v;
+
+        Float4() = default;
+        Float4(__m128 value) : v{value} { }
+        Float4(float value) : v{_mm_set1_ps(value)} { }
+
+        static Float4 Load(const float* pData) { return _mm_loadu_ps(pData); }
+        void Store(float* pData) const { _mm_storeu_ps(pData, v); }
+    };
+
+    inline Float4 operator+(Float4 lhs, Float4 rhs) { return _mm_add_ps(lhs.v, rhs.v); }
+    inline Float4 operator-(Float4 lhs, Float4 rhs) { return _mm_sub_ps(lhs.v, rhs.v); }
+    inline Float4 operator*(Float4 lhs, Float4 rhs) { return _mm_mul_ps(lhs.v, rhs.v); }
+    inline Float4 operator/(Float4 lhs, Float4 rhs) { return _mm_div_ps(lhs.v, rhs.v); }
+    inline Float4 operator-(Float4 value) { return _mm_xor_ps(value.v, _mm_set1_ps(-0.0f)); }
+    inline Float4 operator<(Float4 lhs, Float4 rhs) { return _mm_cmplt_ps(lhs.v, rhs.v); }
+    inline Float4 operator>(Float4 lhs, Float4 rhs) { return _mm_cmpgt_ps(lhs.v, rhs.v); }
+    inline Float4 operator==(Float4 lhs, Float4 rhs) { return _mm_cmpeq_ps(lhs.v, rhs.v); }
+    inline Float4 operator&(Float4 lhs, Float4 rhs) { return _mm_and_ps(lhs.v, rhs.v); }
+
+    inline Float4 Max(Float4 lhs, Float4 rhs) { return _mm_max_ps(lhs.v, rhs.v); }
+    inline Float4 Min(Float4 lhs, Float4 rhs) { return _mm_min_ps(lhs.v, rhs.v); }
+    inline Float4 Sqrt(Float4 value) { return _mm_sqrt_ps(value.v); }
+    inline Float4 Floor(Float4 value) { return _mm_floor_ps(value.v); }
+    inline Float4 Select(Float4 mask, Float4 a, Float4 b) { return _mm_blendv_ps(b.v, a.v, mask.v); }
+
+    /**
+     * \brief Unbiased exponent of every lane as a float, value must be positive and normal
+     */
+    inline Float4 GetExponent(Float4 value)
+    {
+        const __m128i exponent{_mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(value.v), 23), _mm_set1_epi32(127))};
+        return _mm_cvtepi32_ps(exponent);
+    }
+
+    /**
+     * \brief Mantissa of every lane scaled to [1, 2), value must be positive and normal
+     */
+    inline Float4 GetMantissa(Float4 value)
+    {
+        const __m128i bits{_mm_and_si128(_mm_castps_si128(value.v), _mm_set1_epi32(0x007fffff))};
+        return _mm_castsi128_ps(_mm_or_si128(bits, _mm_set1_epi32(0x3f800000)));
+    }
+
+    /**
+     * \brief 2^exponent, exponent must be a whole number in [-126, 127]
+     */
+    inline Float4 Exp2Integer(Float4 exponent)
+    {
+        const __m128i bits{_mm_add_epi32(_mm_cvtps_epi32(exponent.v), _mm_set1_epi32(127))};
+        return _mm_castsi128_ps(_mm_slli_epi32(bits, 23));
+    }
+#pragma endregion
+
+#pragma region Float8
+    struct Float8
+    {
+        static constexpr int width{8};
+
+        __m256 v;
+
+        Float8() = default;
+        Float8(__m256 value) : v{value} { }
+        Float8(float value) : v{_mm256_set1_ps(value)} { }
+
+        static Float8 Load(const float* pData) { return _mm256_loadu_ps(pData); }
+        void Store(float* pData) const { _mm256_storeu_ps(pData, v); }
+    };
+
+    inline Float8 operator+(Float8 lhs, Float8 rhs) { return _mm256_add_ps(lhs.v, rhs.v); }
+    inline Float8 operator-(Float8 lhs, Float8 rhs) { return _mm256_sub_ps(lhs.v, rhs.v); }
+    inline Float8 operator*(Float8 lhs, Float8 rhs) { return _mm256_mul_ps(lhs.v, rhs.v); }
+    inline Float8 operator/(Float8 lhs, Float8 rhs) { return _mm256_div_ps(lhs.v, rhs.v); }
+    inline Float8 operator-(Float8 value) { return _mm256_xor_ps(value.v, _mm256_set1_ps(-0.0f)); }
+    inline Float8 operator<(Float8 lhs, Float8 rhs) { return _mm256_cmp_ps(lhs.v, rhs.v, _CMP_LT_OQ); }
+    inline Float8 operator>(Float8 lhs, Float8 rhs) { return _mm256_cmp_ps(lhs.v, rhs.v, _CMP_GT_OQ); }
+    inline Float8 operator==(Float8 lhs, Float8 rhs) { return _mm256_cmp_ps(lhs.v, rhs.v, _CMP_EQ_OQ); }
+    inline Float8 operator&(Float8 lhs, Float8 rhs) { return _mm256_and_ps(lhs.v, rhs.v); }
+
+    inline Float8 Max(Float8 lhs, Float8 rhs) { return _mm256_max_ps(lhs.v, rhs.v); }
+    inline Float8 Min(Float8 lhs, Float8 rhs) { return _mm256_min_ps(lhs.v, rhs.v); }
+    inline Float8 Sqrt(Float8 value) { return _mm256_sqrt_ps(value.v); }
+    inline Float8 Floor(Float8 value) { return _mm256_floor_ps(value.v); }
+    inline Float8 Select(Float8 mask, Float8 a, Float8 b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+
+    inline Float8 GetExponent(Float8 value)
+    {
+        const __m256i exponent{_mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(value.v), 23), _mm256_set1_epi32(127))};
+        return _mm256_cvtepi32_ps(exponent);
+    }
+
+    inline Float8 GetMantissa(Float8 value)
+    {
+        const __m256i bits{_mm256_and_si256(_mm256_castps_si256(value.v), _mm256_set1_epi32(0x007fffff))};
+        return _mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_set1_epi32(0x3f800000)));
+    }
+
+    inline Float8 Exp2Integer(Float8 exponent)
+    {
+        const __m256i bits{_mm256_add_epi32(_mm256_cvtps_epi32(exponent.v), _mm256_set1_epi32(127))};
+        return _mm256_castsi256_ps(_mm256_slli_epi32(bits, 23));
+    }
+#pragma endregion
+
+#pragma region float
+    //The 1 lane versions, used for the remainder of a batch and as the reference of the tests
+    inline float Max(float lhs, float rhs) { return std::max(lhs, rhs); }
+    inline float Min(float lhs, float rhs) { return std::min(lhs, rhs); }
+    inline float Sqrt(float value) { return std::sqrt(value); }
+    inline float Floor(float value) { return std::floor(value); }
+    inline float Select(bool mask, float a, float b) { return mask ? a : b; }
+
+    inline float GetExponent(float value)
+    {
+        return static_cast<float>(static_cast<int>(std::bit_cast<uint32_t>(value) >> 23) - 127);
+    }
+
+    inline float GetMantissa(float value)
+    {
+        return std::bit_cast<float>((std::bit_cast<uint32_t>(value) & 0x007fffffu) | 0x3f800000u);
+    }
+
+    inline float Exp2Integer(float exponent)
+    {
+        return std::bit_cast<float>(static_cast<uint32_t>(static_cast<int>(exponent) + 127) << 23);
+    }
+#pragma endregion
+
+#pragma region Load/Store
+    template <typename FloatN>
+    FloatN Load(const float* pData)
+    {
+        if constexpr (std::is_same_v<FloatN, float>) return *pData;
+        else return FloatN::Load(pData);
+    }
+
+    template <typename FloatN>
+    void Store(FloatN value, float* pData)
+    {
+        if constexpr (std::is_same_v<FloatN, float>) *pData = value;
+        else value.Store(pData);
+    }
+
+    template <typename FloatN>
+    constexpr int GetWidth()
+    {
+        if constexpr (std::is_same_v<FloatN, float>) return 1;
+        else return FloatN::width;
+    }
+
+    /**
+     * \brief Lane i gets pBase[pIndices[i] * stride], an AVX2 gather for Float4 and Float8
+     */
+    template <typename FloatN>
+    FloatN Gather(const float* pBase, const unsigned char* pIndices, int stride)
+    {
+        if constexpr (std::is_same_v<FloatN, float>)
+        {
+            return pBase[pIndices[0] * stride];
+        }
+        else if constexpr (std::is_same_v<FloatN, Float4>)
+        {
+            int32_t indices;
+            std::memcpy(&indices, pIndices, sizeof(indices));
+            const __m128i offsets{_mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(indices)), _mm_set1_epi32(stride))};
+            return _mm_i32gather_ps(pBase, offsets, sizeof(float));
+        }
+        else
+        {
+            const __m128i indices{_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pIndices))};
+            const __m256i offsets{_mm256_mullo_epi32(_mm256_cvtepu8_epi32(indices), _mm256_set1_epi32(stride))};
+            return _mm256_i32gather_ps(pBase, offsets, sizeof(float));
+        }
+    }
+#pragma endregion
+
+#pragma region Fast Math
+    /**
+     * \brief x^y for x >= 0, evaluated as exp2(y * log2(x)) with short polynomials instead of std::pow \n
+     * Relative error below 2e-5 for x in [0, 1] and y up to 128 (checked by DoBRDFTests), results under 2^-126 flush to 0
+     */
+    template <typename FloatN>
+    FloatN FastPow(FloatN x, FloatN y)
+    {
+        //log2(x) = e + log2(m), with the mantissa m moved to [sqrt(0.5), sqrt(2)) so the series below converges fast
+        FloatN exponent{GetExponent(x)};
+        FloatN mantissa{GetMantissa(x)};
+        const auto isLarge{mantissa > FloatN{1.41421356f}};
+        mantissa = Select(isLarge, mantissa * FloatN{0.5f}, mantissa);
+        exponent = Select(isLarge, exponent + FloatN{1.0f}, exponent);
+
+        //log2(m) = 2 / ln(2) * atanh(t) with t = (m - 1) / (m + 1), |t| < 0.172 so 4 terms are enough
+        const FloatN t{(mantissa - FloatN{1.0f}) / (mantissa + FloatN{1.0f})};
+        const FloatN tSq{t * t};
+        const FloatN log2Mantissa{
+            t * (FloatN{2.88539008f} + tSq * (FloatN{0.961796694f} + tSq * (FloatN{0.577078016f} + tSq * FloatN{0.412198583f})))
+        };
+        const FloatN power{Min(Max(y * (exponent + log2Mantissa), FloatN{-126.0f}), FloatN{127.0f})};
+
+        //2^power = 2^i * 2^f with i the nearest whole number and f in [-0.5, 0.5], 2^f = e^(f ln(2)) as a degree 6 Taylor series
+        const FloatN integer{Floor(power + FloatN{0.5f})};
+        const FloatN fraction{power - integer};
+        const FloatN exp2Fraction{
+            FloatN{1.0f} + fraction * (FloatN{0.693147181f} + fraction * (FloatN{0.240226507f} + fraction * (FloatN{0.0555041087f} +
+                fraction * (FloatN{0.00961812911f} + fraction * (FloatN{0.00133335581f} + fraction * FloatN{0.000154035304f})))))
+        };
+
+        const FloatN result{exp2Fraction * Exp2Integer(integer)};
+        return Select((x > FloatN{0.0f}) & (power > FloatN{-126.0f}), result, FloatN{0.0f});
+    }
+#pragma endregion
+
+#pragma region Vector3N
+    /**
+     * \brief Vector3 with one FloatN per component, the operations mirror Vector3 so every lane computes what Vector3 would
+     */
+    template <typename FloatN>
+    struct Vector3N
+    {
+        FloatN x;
+        FloatN y;
+        FloatN z;
+
+        static Vector3N Load(const float* pX, const float* pY, const float* pZ)
+        {
+            return {dae::Load<FloatN>(pX), dae::Load<FloatN>(pY), dae::Load<FloatN>(pZ)};
+        }
+
+        FloatN Magnitude() const { return Sqrt(x * x + y * y + z * z); }
+
+        static FloatN Dot(const Vector3N& v1, const Vector3N& v2) { return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z; }
+
+        static Vector3N Reflect(const Vector3N& v1, const Vector3N& v2) { return v1 - v2 * (FloatN{2.f} * Dot(v1, v2)); }
+
+        Vector3N operator*(FloatN scale) const { return {x * scale, y * scale, z * scale}; }
+        Vector3N operator/(FloatN scale) const { return {x / scale, y / scale, z / scale}; }
+        Vector3N operator+(const Vector3N& v) const { return {x + v.x, y + v.y, z + v.z}; }
+        Vector3N operator-(const Vector3N& v) const { return {x - v.x, y - v.y, z - v.z}; }
+        Vector3N operator-() const { return {-x, -y, -z}; }
+    };
+
+    /**
+     * \brief ColorRGB with one FloatN per channel
+     */
+    template <typename FloatN>
+    struct ColorRGBN
+    {
+        FloatN r;
+        FloatN g;
+        FloatN b;
+
+        ColorRGBN operator+(const ColorRGBN& c) const { return {r + c.r, g + c.g, b + c.b}; }
+        ColorRGBN operator*(const ColorRGBN& c) const { return {r * c.r, g * c.g, b * c.b}; }
+        ColorRGBN operator*(FloatN scale) const { return {r * scale, g * scale, b * scale}; }
+        ColorRGBN operator/(FloatN scale) const { return {r / scale, g / scale, b / scale}; }
+
+        void Store(float* pR, float* pG, float* pB) const
+        {
+            dae::Store(r, pR);
+            dae::Store(g, pG);
+            dae::Store(b, pB);
+        }
+    };
+#pragma endregion
+}
@@ -1,11 +1,36 @@
 #include "Scene.h"
 
 #include "Utils.h"
+#include "OBJParser.h"
+#include "MeshCache.h"
 #include "Material.h"
 #include "Macros.h"
 
+#include <atomic>
+#include <bit>
+
 namespace dae
 {
+    namespace
+    {
+        /**
+         * \brief Entry of an occluder cache, testing it again does not need the distance along the old shadow ray
+         */
+        PrimitiveHit MakeOccluder(PrimitiveType type, uint32_t primitiveIdx, uint32_t triangleIdx = 0)
+        {
+            return {FLT_MAX, primitiveIdx, triangleIdx, type, true};
+        }
+
+        /**
+         * \brief Shared by every scene, so a scene created at the address of a deleted one never repeats its versions
+         */
+        uint64_t GetNextGeometryVersion()
+        {
+            static std::atomic<uint64_t> nextVersion{1};
+            return nextVersion.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
 #pragma region Base Scene
     //Initialize Scene with Default Solid Color Material (RED)
     Scene::Scene():
@@ -14,7 +39,11 @@ namespace dae
         m_SphereGeometries.reserve(32);
         m_PlaneGeometries.reserve(32);
         m_TriangleMeshGeometries.reserve(32);
+        m_SharedMeshes.reserve(32);
+        m_MeshInstances.reserve(32);
         m_Lights.reserve(32);
+
+        m_MaterialTable.push_back(m_Materials.front()->GetData());
     }
 
     Scene::~Scene()
@@ -30,17 +59,104 @@ namespace dae
 
     void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
     {
-        GetClosestHitSphere(ray, closestHit);
-        GetClosestHitPlane(ray, closestHit);
-        GetClosestHitTriangleMesh(ray, closestHit);
+#if RAY_STATS
+        m_RayStats.primaryRays.Add(1);
+#endif
+        PrimitiveHit hit{closestHit.t};
+#if BVH_SCENE
+        //Planes first, the closest plane hit already limits how far the TLAS has to be traversed
+        GetClosestHitPlane(ray, hit);
+
+        Ray sceneRay{ray};
+        sceneRay.max = std::min(ray.max, hit.t);
+        const auto intersectPrimitive = [this, &hit](uint32_t primIdx, Ray& r)
+        {
+            const PrimitiveRef& primitive{m_TLASPrimitives[primIdx]};
+
+            float t;
+            uint32_t triangleIdx{0};
+            bool didHit{false};
+            switch (primitive.type)
+            {
+            case PrimitiveType::Sphere:
+                didHit = GeometryUtils::HitTest_Sphere(m_SphereGeometries[primitive.index], r, t);
+                break;
+            case PrimitiveType::TriangleMesh:
+                didHit = GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[primitive.index], r, t, triangleIdx);
+                break;
+            case PrimitiveType::MeshInstance:
+                {
+                    const MeshInstance& instance{m_MeshInstances[primitive.index]};
+                    didHit = GeometryUtils::HitTest_MeshInstance(instance, m_SharedMeshes[instance.meshIndex], r, t, triangleIdx);
+                }
+                break;
+            case PrimitiveType::Plane: //Planes are never part of the TLAS
+                break;
+            }
+
+            if (not didHit or t >= hit.t) return false;
+
+            hit = {t, primitive.index, triangleIdx, primitive.type, true};
+            r.max = t;
+            return true;
+        };
+#if SOA_GEOMETRY
+        //The spheres of a leaf go through one SoA call, the other primitives are tested one by one
+        GeometryUtils::IntersectBVHLeaves(m_TLAS, sceneRay, [this, &hit, &intersectPrimitive](uint32_t nodeIdx, Ray& r)
+        {
+            bool didHit{false};
+            const uint32_t firstSphere{m_TLASLeafFirstSphere[nodeIdx]};
+            const uint32_t sphereCount{m_TLASLeafFirstSphere[nodeIdx + 1] - firstSphere};
+            float t;
+            uint32_t slot;
+            if (sphereCount > 0 and GeometryUtils::HitTest_SphereSoA(m_SphereSoA, firstSphere, sphereCount, r, t, slot) and t < hit.t)
+            {
+                hit = {t, m_SphereSoA.sphereIndices[slot], 0, PrimitiveType::Sphere, true};
+                r.max = t;
+                didHit = true;
+            }
+
+            const BVHNode& node{m_TLAS.nodes[nodeIdx]};
+            if (sphereCount == node.primCount) return didHit;
+            for (uint32_t idx{node.leftFirst}; idx < node.leftFirst + node.primCount; ++idx)
+            {
+                const uint32_t primIdx{m_TLAS.primIndices[idx]};
+                if (m_TLASPrimitives[primIdx].type != PrimitiveType::Sphere and intersectPrimitive(primIdx, r)) didHit = true;
+            }
+            return didHit;
+        }, false);
+#else
+        GeometryUtils::IntersectBVH(m_TLAS, sceneRay, intersectPrimitive, false);
+#endif
+#else
+        GetClosestHitSphere(ray, hit);
+        GetClosestHitPlane(ray, hit);
+        GetClosestHitTriangleMesh(ray, hit);
+        GetClosestHitMeshInstance(ray, hit);
+#endif
+        ResolveHit(ray, hit, closestHit);
     }
 
     void Scene::GetClosestHitSphere(const Ray& ray, HitRecord& closestHit) const
     {
-        for (const auto& sphere : m_SphereGeometries)
+        PrimitiveHit hit{closestHit.t};
+        GetClosestHitSphere(ray, hit);
+        ResolveHit(ray, hit, closestHit);
+    }
+
+    void Scene::GetClosestHitPlane(const Ray& ray, HitRecord& closestHit) const
+    {
+        PrimitiveHit hit{closestHit.t};
+        GetClosestHitPlane(ray, hit);
+        ResolveHit(ray, hit, closestHit);
+    }
+
+    void Scene::GetClosestHitTriangle(const Ray& ray, HitRecord& closestHit) const
+    {
+        for (const auto& triangle : m_Triangles)
         {
             HitRecord hit;
-            if (GeometryUtils::HitTest_Sphere(sphere, ray, hit))
+            if (GeometryUtils::HitTest_Triangle(triangle, ray, hit))
             {
                 if (hit.t < closestHit.t)
                 {
@@ -50,76 +166,594 @@ namespace dae
         }
     }
 
-    void Scene::GetClosestHitPlane(const Ray& ray, HitRecord& closestHit) const
+    void Scene::GetClosestHitTriangleMesh(const Ray& ray, HitRecord& closestHit) const
+    {
+        PrimitiveHit hit{closestHit.t};
+        GetClosestHitTriangleMesh(ray, hit);
+        ResolveHit(ray, hit, closestHit);
+    }
+
+    void Scene::GetClosestHitMeshInstance(const Ray& ray, HitRecord& closestHit) const
     {
-        for (const auto& plane : m_PlaneGeometries)
+        PrimitiveHit hit{closestHit.t};
+        GetClosestHitMeshInstance(ray, hit);
+        ResolveHit(ray, hit, closestHit);
+    }
+
+    void Scene::GetClosestHitSphere(const Ray& ray, PrimitiveHit& closestHit) const
+    {
+        float t;
+#if SOA_GEOMETRY
+        uint32_t idx;
+        if (GeometryUtils::HitTest_SphereSoA(m_SphereSoA, ray, t, idx) and t < closestHit.t)
         {
-            HitRecord hit;
-            if (GeometryUtils::HitTest_Plane(plane, ray, hit))
+            closestHit = {t, idx, 0, PrimitiveType::Sphere, true};
+        }
+#else
+        for (uint32_t idx{0}; idx < m_SphereGeometries.size(); ++idx)
+        {
+            if (GeometryUtils::HitTest_Sphere(m_SphereGeometries[idx], ray, t) and t < closestHit.t)
             {
-                if (hit.t < closestHit.t)
-                {
-                    closestHit = hit;
-                }
+                closestHit = {t, idx, 0, PrimitiveType::Sphere, true};
             }
         }
+#endif
     }
 
-    void Scene::GetClosestHitTriangle(const Ray& ray, HitRecord& closestHit) const
+    void Scene::GetClosestHitPlane(const Ray& ray, PrimitiveHit& closestHit) const
     {
-        for (const auto& triangle : m_Triangles)
+        float t;
+        uint32_t idx;
+#if PLANE_ROOM
+        if (m_Room.isValid)
         {
-            HitRecord hit;
-            if (GeometryUtils::HitTest_Triangle(triangle, ray, hit))
+            if (GeometryUtils::HitTest_Room(m_Room, ray, t, idx) and t < closestHit.t)
             {
-                if (hit.t < closestHit.t)
-                {
-                    closestHit = hit;
-                }
+                closestHit = {t, idx, 0, PrimitiveType::Plane, true};
+            }
+            return;
+        }
+#endif
+#if SOA_GEOMETRY
+        if (GeometryUtils::HitTest_PlaneSoA(m_PlaneSoA, ray, t, idx) and t < closestHit.t)
+        {
+            closestHit = {t, idx, 0, PrimitiveType::Plane, true};
+        }
+#else
+        for (idx = 0; idx < m_PlaneGeometries.size(); ++idx)
+        {
+            if (GeometryUtils::HitTest_Plane(m_PlaneGeometries[idx], ray, t) and t < closestHit.t)
+            {
+                closestHit = {t, idx, 0, PrimitiveType::Plane, true};
             }
         }
+#endif
     }
 
-    void Scene::GetClosestHitTriangleMesh(const Ray& ray, HitRecord& closestHit) const
+    void Scene::GetClosestHitTriangleMesh(const Ray& ray, PrimitiveHit& closestHit) const
     {
-        for (const auto& triangleMesh : m_TriangleMeshGeometries)
+        float t;
+        uint32_t triangleIdx;
+        for (uint32_t idx{0}; idx < m_TriangleMeshGeometries.size(); ++idx)
         {
-            HitRecord hit;
-            if (GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray, hit))
+            if (GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[idx], ray, t, triangleIdx) and t < closestHit.t)
             {
-                if (hit.t < closestHit.t)
-                {
-                    closestHit = hit;
-                }
+                closestHit = {t, idx, triangleIdx, PrimitiveType::TriangleMesh, true};
+            }
+        }
+    }
+
+    void Scene::GetClosestHitMeshInstance(const Ray& ray, PrimitiveHit& closestHit) const
+    {
+        float t;
+        uint32_t triangleIdx;
+        for (uint32_t idx{0}; idx < m_MeshInstances.size(); ++idx)
+        {
+            const MeshInstance& instance{m_MeshInstances[idx]};
+            if (GeometryUtils::HitTest_MeshInstance(instance, m_SharedMeshes[instance.meshIndex], ray, t, triangleIdx) and t < closestHit.t)
+            {
+                closestHit = {t, idx, triangleIdx, PrimitiveType::MeshInstance, true};
             }
         }
     }
 
+    void Scene::ResolveHit(const Ray& ray, const PrimitiveHit& hit, HitRecord& hitRecord) const
+    {
+        if (not hit.didHit) return;
+
+        hitRecord.didHit = true;
+        hitRecord.t = hit.t;
+        hitRecord.origin = ray.origin + ray.direction * hit.t;
+        switch (hit.type)
+        {
+        case PrimitiveType::Sphere:
+            {
+                const Sphere& sphere{m_SphereGeometries[hit.primitiveIdx]};
+                hitRecord.normal = (hitRecord.origin - sphere.origin) / sphere.radius;
+                hitRecord.materialIndex = sphere.materialIndex;
+            }
+            break;
+        case PrimitiveType::Plane:
+            {
+                const Plane& plane{m_PlaneGeometries[hit.primitiveIdx]};
+                hitRecord.normal = plane.normal;
+                hitRecord.materialIndex = plane.materialIndex;
+            }
+            break;
+        case PrimitiveType::TriangleMesh:
+            {
+                const TriangleMesh& mesh{m_TriangleMeshGeometries[hit.primitiveIdx]};
+                hitRecord.normal = mesh.transformedNormals[hit.triangleIdx];
+                hitRecord.materialIndex = mesh.materialIndex;
+            }
+            break;
+        case PrimitiveType::MeshInstance:
+            {
+                const MeshInstance& instance{m_MeshInstances[hit.primitiveIdx]};
+                hitRecord.normal = instance.TransformNormal(m_SharedMeshes[instance.meshIndex].normals[hit.triangleIdx]);
+                hitRecord.materialIndex = instance.materialIndex;
+            }
+            break;
+        }
+    }
+
     bool Scene::DoesHit(const Ray& ray) const
     {
-        HitRecord hit;
-        for (const auto& sphere : m_SphereGeometries)
+        PrimitiveHit occluder{};
+        return DoesHit(ray, occluder);
+    }
+
+    bool Scene::DoesHit(const Ray& ray, PrimitiveHit& lastOccluder) const
+    {
+#if RAY_STATS
+        m_RayStats.shadowRays.Add(1);
+#endif
+#if OCCLUDER_CACHE
+        if (DoesHitOccluder(ray, lastOccluder))
+        {
+#if RAY_STATS
+            m_RayStats.occludedRays.Add(1);
+            m_RayStats.occluderCacheHits.Add(1);
+#endif
+            return true;
+        }
+#endif
+        const bool isOccluded{FindOccluder(ray, lastOccluder)};
+#if RAY_STATS
+        if (isOccluded) m_RayStats.occludedRays.Add(1);
+#endif
+        return isOccluded;
+    }
+
+    bool Scene::FindOccluder(const Ray& ray, PrimitiveHit& lastOccluder) const
+    {
+#if BVH_SCENE
+        if (FindOccluderPlane(ray, lastOccluder)) return true;
+
+        Ray sceneRay{ray};
+        const auto findOccluder = [this, &lastOccluder](uint32_t primIdx, Ray& r)
+        {
+            const PrimitiveRef& primitive{m_TLASPrimitives[primIdx]};
+
+            float primitiveT;
+            uint32_t triangleIdx{0};
+            bool didHit{false};
+            switch (primitive.type)
+            {
+            case PrimitiveType::Sphere:
+                didHit = GeometryUtils::HitTest_Sphere(m_SphereGeometries[primitive.index], r, primitiveT);
+                break;
+            case PrimitiveType::TriangleMesh:
+                didHit = GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[primitive.index], r, primitiveT, triangleIdx, true);
+                break;
+            case PrimitiveType::MeshInstance:
+                {
+                    const MeshInstance& instance{m_MeshInstances[primitive.index]};
+                    didHit = GeometryUtils::HitTest_MeshInstance(instance, m_SharedMeshes[instance.meshIndex], r, primitiveT, triangleIdx, true);
+                }
+                break;
+            case PrimitiveType::Plane: //Planes are never part of the TLAS
+                break;
+            }
+
+            if (didHit) lastOccluder = MakeOccluder(primitive.type, primitive.index, triangleIdx);
+            return didHit;
+        };
+#if SOA_GEOMETRY
+        return GeometryUtils::IntersectBVHLeaves(m_TLAS, sceneRay, [this, &lastOccluder, &findOccluder](uint32_t nodeIdx, Ray& r)
         {
-            if (GeometryUtils::HitTest_Sphere(sphere, ray, hit, true))
+            const uint32_t firstSphere{m_TLASLeafFirstSphere[nodeIdx]};
+            const uint32_t sphereCount{m_TLASLeafFirstSphere[nodeIdx + 1] - firstSphere};
+            float t;
+            uint32_t slot;
+            if (sphereCount > 0 and GeometryUtils::HitTest_SphereSoA(m_SphereSoA, firstSphere, sphereCount, r, t, slot, true))
             {
+                lastOccluder = MakeOccluder(PrimitiveType::Sphere, m_SphereSoA.sphereIndices[slot]);
+                return true;
+            }
+
+            const BVHNode& node{m_TLAS.nodes[nodeIdx]};
+            if (sphereCount == node.primCount) return false;
+            for (uint32_t idx{node.leftFirst}; idx < node.leftFirst + node.primCount; ++idx)
+            {
+                const uint32_t primIdx{m_TLAS.primIndices[idx]};
+                if (m_TLASPrimitives[primIdx].type != PrimitiveType::Sphere and findOccluder(primIdx, r)) return true;
+            }
+            return false;
+        }, true);
+#else
+        return GeometryUtils::IntersectBVH(m_TLAS, sceneRay, findOccluder, true);
+#endif
+#else
+        float t;
+        uint32_t idx;
+#if SOA_GEOMETRY
+        if (GeometryUtils::HitTest_SphereSoA(m_SphereSoA, ray, t, idx, true))
+        {
+            lastOccluder = MakeOccluder(PrimitiveType::Sphere, idx);
+            return true;
+        }
+#else
+        for (idx = 0; idx < m_SphereGeometries.size(); ++idx)
+        {
+            if (GeometryUtils::HitTest_Sphere(m_SphereGeometries[idx], ray, t))
+            {
+                lastOccluder = MakeOccluder(PrimitiveType::Sphere, idx);
                 return true;
             }
         }
-        for (const auto& plane : m_PlaneGeometries)
+#endif
+        if (FindOccluderPlane(ray, lastOccluder)) return true;
+        uint32_t triangleIdx;
+        for (idx = 0; idx < m_TriangleMeshGeometries.size(); ++idx)
         {
-            if (GeometryUtils::HitTest_Plane(plane, ray, hit, true))
+            if (GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[idx], ray, t, triangleIdx, true))
             {
+                lastOccluder = MakeOccluder(PrimitiveType::TriangleMesh, idx, triangleIdx);
                 return true;
             }
         }
-        for (const auto& triangleMesh : m_TriangleMeshGeometries)
+        for (idx = 0; idx < m_MeshInstances.size(); ++idx)
         {
-            if (GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray, hit, true))
+            const MeshInstance& instance{m_MeshInstances[idx]};
+            if (GeometryUtils::HitTest_MeshInstance(instance, m_SharedMeshes[instance.meshIndex], ray, t, triangleIdx, true))
             {
+                lastOccluder = MakeOccluder(PrimitiveType::MeshInstance, idx, triangleIdx);
                 return true;
             }
         }
         return false;
+#endif
+    }
+
+    bool Scene::FindOccluderPlane(const Ray& ray, PrimitiveHit& lastOccluder) const
+    {
+        uint32_t idx;
+#if PLANE_ROOM
+        if (m_Room.isValid)
+        {
+            if (not GeometryUtils::HitTest_Room(m_Room, ray, idx)) return false;
+
+            lastOccluder = MakeOccluder(PrimitiveType::Plane, idx);
+            return true;
+        }
+#endif
+#if SOA_GEOMETRY
+        float t;
+        if (GeometryUtils::HitTest_PlaneSoA(m_PlaneSoA, ray, t, idx, true))
+        {
+            lastOccluder = MakeOccluder(PrimitiveType::Plane, idx);
+            return true;
+        }
+#else
+        for (idx = 0; idx < m_PlaneGeometries.size(); ++idx)
+        {
+            if (GeometryUtils::HitTest_Plane(m_PlaneGeometries[idx], ray))
+            {
+                lastOccluder = MakeOccluder(PrimitiveType::Plane, idx);
+                return true;
+            }
+        }
+#endif
+        return false;
+    }
+
+    bool Scene::DoesHitOccluder(const Ray& ray, const PrimitiveHit& occluder) const
+    {
+        if (not occluder.didHit or not IsInScene(occluder)) return false;
+
+        float t;
+        switch (occluder.type)
+        {
+        case PrimitiveType::Sphere:
+            return GeometryUtils::HitTest_Sphere(m_SphereGeometries[occluder.primitiveIdx], ray);
+        case PrimitiveType::Plane:
+            return GeometryUtils::HitTest_Plane(m_PlaneGeometries[occluder.primitiveIdx], ray);
+        case PrimitiveType::TriangleMesh:
+            {
+                const TriangleMesh& mesh{m_TriangleMeshGeometries[occluder.primitiveIdx]};
+                return GeometryUtils::HitTest_MeshTriangle(mesh, mesh.transformedPositions, occluder.triangleIdx, ray, t);
+            }
+        case PrimitiveType::MeshInstance:
+            {
+                const MeshInstance& instance{m_MeshInstances[occluder.primitiveIdx]};
+                const TriangleMesh& mesh{m_SharedMeshes[instance.meshIndex]};
+                return GeometryUtils::HitTest_MeshTriangle(mesh, mesh.positions, occluder.triangleIdx, GeometryUtils::TransformRay(instance, ray), t);
+            }
+        }
+        return false;
+    }
+
+    bool Scene::IsInScene(const PrimitiveHit& occluder) const
+    {
+        switch (occluder.type)
+        {
+        case PrimitiveType::Sphere:
+            return occluder.primitiveIdx < m_SphereGeometries.size();
+        case PrimitiveType::Plane:
+            return occluder.primitiveIdx < m_PlaneGeometries.size();
+        case PrimitiveType::TriangleMesh:
+            return occluder.primitiveIdx < m_TriangleMeshGeometries.size() and
+                occluder.triangleIdx < m_TriangleMeshGeometries[occluder.primitiveIdx].indices.size() / 3;
+        case PrimitiveType::MeshInstance:
+            return occluder.primitiveIdx < m_MeshInstances.size() and
+                occluder.triangleIdx < m_SharedMeshes[m_MeshInstances[occluder.primitiveIdx].meshIndex].indices.size() / 3;
+        }
+        return false;
+    }
+
+    void Scene::GetClosestHitPacket(const RayPacket& packet, HitRecord (&closestHits)[PACKET_WIDTH]) const
+    {
+#if BVH_SCENE and BVH_MESH
+#if RAY_STATS
+        m_RayStats.primaryRays.Add(std::popcount(static_cast<unsigned>(packet.GetActiveMask())));
+#endif
+        alignas(16) float tLanes[PACKET_WIDTH];
+        PrimitiveHit laneHits[PACKET_WIDTH]{};
+        RayPacket sceneRays{packet};
+
+        //Only hits strictly closer than the current closest one are taken, ties keep the first hit like GetClosestHit
+        const auto acceptHits = [&sceneRays, &tLanes](int mask, __m128 t)
+        {
+            mask &= _mm_movemask_ps(_mm_cmplt_ps(t, sceneRays.max));
+            if (mask == 0) return 0;
+
+            sceneRays.max = PacketMath::Select(PacketMath::LaneMask(mask), t, sceneRays.max);
+            _mm_store_ps(tLanes, t);
+            return mask;
+        };
+        //Only the primitive is recorded per lane, ResolveHit derives the hit attributes of the winners at the end
+        const auto recordHits = [&tLanes, &laneHits](int mask, PrimitiveType type, uint32_t primitiveIdx, const uint32_t* pTriangleIdx)
+        {
+            for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+            {
+                if (not (mask & (1 << lane))) continue;
+                laneHits[lane] = {tLanes[lane], primitiveIdx, pTriangleIdx ? pTriangleIdx[lane] : 0, type, true};
+            }
+        };
+
+        const auto intersectSphere = [this, &acceptHits, &recordHits](uint32_t sphereIdx, const RayPacket& rays)
+        {
+            __m128 t{};
+            int mask{GeometryUtils::HitTest_SpherePacket(m_SphereGeometries[sphereIdx], rays, t)};
+            mask = acceptHits(mask, t);
+            recordHits(mask, PrimitiveType::Sphere, sphereIdx, nullptr);
+            return mask;
+        };
+
+        //Planes first, the closest plane hit already limits how far the TLAS has to be traversed
+#if PLANE_ROOM
+        if (m_Room.isValid)
+        {
+            __m128 t{};
+            __m128i wallIdx{};
+            int mask{GeometryUtils::HitTest_RoomPacket(m_Room, sceneRays, t, wallIdx)};
+            mask = acceptHits(mask, t);
+
+            alignas(16) uint32_t wallIndices[PACKET_WIDTH];
+            _mm_store_si128(reinterpret_cast<__m128i*>(wallIndices), wallIdx);
+            for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+            {
+                if (mask & (1 << lane)) recordHits(1 << lane, PrimitiveType::Plane, wallIndices[lane], nullptr);
+            }
+        }
+        else
+#endif
+        for (uint32_t planeIdx{0}; planeIdx < m_PlaneGeometries.size(); ++planeIdx)
+        {
+            __m128 t{};
+            int mask{GeometryUtils::HitTest_PlanePacket(m_PlaneGeometries[planeIdx], sceneRays, t)};
+            mask = acceptHits(mask, t);
+            recordHits(mask, PrimitiveType::Plane, planeIdx, nullptr);
+        }
+
+        //acceptHits shrinks sceneRays.max, which is the packet being traversed, so farther nodes get culled
+        GeometryUtils::IntersectBVHPacket(m_TLAS, sceneRays, [&](uint32_t primIdx, RayPacket& rays)
+        {
+            const PrimitiveRef& primitive{m_TLASPrimitives[primIdx]};
+
+            int mask{0};
+            switch (primitive.type)
+            {
+            case PrimitiveType::Sphere:
+                mask = intersectSphere(primitive.index, rays);
+                break;
+            case PrimitiveType::TriangleMesh:
+                {
+                    const TriangleMesh& mesh{m_TriangleMeshGeometries[primitive.index]};
+                    RayPacket meshRays{rays};
+                    uint32_t closestTriangleIdx[PACKET_WIDTH]{};
+                    mask = GeometryUtils::HitTest_TriangleMeshPacket(mesh, mesh.transformedPositions, meshRays, closestTriangleIdx);
+                    mask = acceptHits(mask, meshRays.max);
+                    recordHits(mask, PrimitiveType::TriangleMesh, primitive.index, closestTriangleIdx);
+                }
+                break;
+            case PrimitiveType::MeshInstance:
+                {
+                    const MeshInstance& instance{m_MeshInstances[primitive.index]};
+                    const TriangleMesh& mesh{m_SharedMeshes[instance.meshIndex]};
+                    RayPacket objectRays{GeometryUtils::TransformPacket(instance, rays)};
+                    uint32_t closestTriangleIdx[PACKET_WIDTH]{};
+                    mask = GeometryUtils::HitTest_TriangleMeshPacket(mesh, mesh.positions, objectRays, closestTriangleIdx);
+                    mask = acceptHits(mask, objectRays.max);
+                    recordHits(mask, PrimitiveType::MeshInstance, primitive.index, closestTriangleIdx);
+                }
+                break;
+            case PrimitiveType::Plane: //Planes are never part of the TLAS
+                break;
+            }
+            return mask;
+        }, false);
+
+        for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+        {
+            if (laneHits[lane].didHit) ResolveHit(packet.GetRay(lane), laneHits[lane], closestHits[lane]);
+        }
+#else
+        //Single-ray fallback, the packet kernels rely on the scene and mesh BVHs
+        const int activeMask{packet.GetActiveMask()};
+        for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+        {
+            if (not (activeMask & (1 << lane))) continue;
+            GetClosestHit(packet.GetRay(lane), closestHits[lane]);
+        }
+#endif
+    }
+
+    int Scene::DoesHitPacket(const RayPacket& packet) const
+    {
+        PrimitiveHit occluder{};
+        return DoesHitPacket(packet, occluder);
+    }
+
+    int Scene::DoesHitPacket(const RayPacket& packet, PrimitiveHit& lastOccluder) const
+    {
+#if BVH_SCENE and BVH_MESH
+#if RAY_STATS
+        m_RayStats.shadowRays.Add(std::popcount(static_cast<unsigned>(packet.GetActiveMask())));
+#endif
+        RayPacket sceneRays{packet};
+        int occludedMask{0};
+#if OCCLUDER_CACHE
+        occludedMask = DoesHitOccluderPacket(sceneRays, lastOccluder);
+        if (occludedMask != 0)
+        {
+#if RAY_STATS
+            m_RayStats.occluderCacheHits.Add(std::popcount(static_cast<unsigned>(occludedMask)));
+#endif
+            sceneRays.active = _mm_andnot_ps(PacketMath::LaneMask(occludedMask), sceneRays.active);
+        }
+#endif
+        if (sceneRays.GetActiveMask() != 0) occludedMask |= FindOccludersPacket(sceneRays, lastOccluder);
+#if RAY_STATS
+        m_RayStats.occludedRays.Add(std::popcount(static_cast<unsigned>(occludedMask)));
+#endif
+        return occludedMask;
+#else
+        const int activeMask{packet.GetActiveMask()};
+        int occludedMask{0};
+        for (int lane{0}; lane < PACKET_WIDTH; ++lane)
+        {
+            if ((activeMask & (1 << lane)) and DoesHit(packet.GetRay(lane), lastOccluder)) occludedMask |= 1 << lane;
+        }
+        return occludedMask;
+#endif
+    }
+
+    int Scene::FindOccludersPacket(RayPacket& sceneRays, PrimitiveHit& lastOccluder) const
+    {
+        int occludedMask{0};
+#if PLANE_ROOM
+        if (m_Room.isValid)
+        {
+            __m128i wallIdx{};
+            occludedMask = GeometryUtils::HitTest_RoomPacket(m_Room, sceneRays, wallIdx);
+            if (occludedMask != 0)
+            {
+                alignas(16) uint32_t wallIndices[PACKET_WIDTH];
+                _mm_store_si128(reinterpret_cast<__m128i*>(wallIndices), wallIdx);
+                lastOccluder = MakeOccluder(PrimitiveType::Plane, wallIndices[std::countr_zero(static_cast<unsigned>(occludedMask))]);
+            }
+        }
+        else
+#endif
+        for (uint32_t planeIdx{0}; planeIdx < m_PlaneGeometries.size(); ++planeIdx)
+        {
+            __m128 t{};
+            const int mask{GeometryUtils::HitTest_PlanePacket(m_PlaneGeometries[planeIdx], sceneRays, t)};
+            if (mask == 0) continue;
+
+            occludedMask |= mask;
+            lastOccluder = MakeOccluder(PrimitiveType::Plane, planeIdx);
+        }
+        sceneRays.active = _mm_andnot_ps(PacketMath::LaneMask(occludedMask), sceneRays.active);
+        if (sceneRays.GetActiveMask() == 0) return occludedMask;
+
+        return occludedMask | GeometryUtils::IntersectBVHPacket(m_TLAS, sceneRays, [this, &lastOccluder](uint32_t primIdx, RayPacket& rays)
+        {
+            const PrimitiveRef& primitive{m_TLASPrimitives[primIdx]};
+            uint32_t closestTriangleIdx[PACKET_WIDTH]{};
+            __m128 t{};
+            int mask{0};
+            switch (primitive.type)
+            {
+            case PrimitiveType::Sphere:
+                mask = GeometryUtils::HitTest_SpherePacket(m_SphereGeometries[primitive.index], rays, t);
+                break;
+            case PrimitiveType::TriangleMesh:
+                {
+                    const TriangleMesh& mesh{m_TriangleMeshGeometries[primitive.index]};
+                    RayPacket meshRays{rays};
+                    mask = GeometryUtils::HitTest_TriangleMeshPacket(mesh, mesh.transformedPositions, meshRays, closestTriangleIdx, true);
+                }
+                break;
+            case PrimitiveType::MeshInstance:
+                {
+                    const MeshInstance& instance{m_MeshInstances[primitive.index]};
+                    const TriangleMesh& mesh{m_SharedMeshes[instance.meshIndex]};
+                    RayPacket objectRays{GeometryUtils::TransformPacket(instance, rays)};
+                    mask = GeometryUtils::HitTest_TriangleMeshPacket(mesh, mesh.positions, objectRays, closestTriangleIdx, true);
+                }
+                break;
+            case PrimitiveType::Plane: //Planes are never part of the TLAS
+                break;
+            }
+
+            //The triangle of the first blocked lane stands for the whole packet
+            if (mask != 0)
+            {
+                const int lane{std::countr_zero(static_cast<unsigned>(mask))};
+                lastOccluder = MakeOccluder(primitive.type, primitive.index, closestTriangleIdx[lane]);
+            }
+            return mask;
+        }, true);
+    }
+
+    int Scene::DoesHitOccluderPacket(const RayPacket& packet, const PrimitiveHit& occluder) const
+    {
+        if (not occluder.didHit or not IsInScene(occluder)) return 0;
+
+        __m128 t{};
+        switch (occluder.type)
+        {
+        case PrimitiveType::Sphere:
+            return GeometryUtils::HitTest_SpherePacket(m_SphereGeometries[occluder.primitiveIdx], packet, t);
+        case PrimitiveType::Plane:
+            return GeometryUtils::HitTest_PlanePacket(m_PlaneGeometries[occluder.primitiveIdx], packet, t);
+        case PrimitiveType::TriangleMesh:
+            {
+                const TriangleMesh& mesh{m_TriangleMeshGeometries[occluder.primitiveIdx]};
+                return GeometryUtils::HitTest_MeshTrianglePacket(mesh, mesh.transformedPositions, occluder.triangleIdx, packet, t);
+            }
+        case PrimitiveType::MeshInstance:
+            {
+                const MeshInstance& instance{m_MeshInstances[occluder.primitiveIdx]};
+                const TriangleMesh& mesh{m_SharedMeshes[instance.meshIndex]};
+                return GeometryUtils::HitTest_MeshTrianglePacket(mesh, mesh.positions, occluder.triangleIdx,
+                                                                 GeometryUtils::TransformPacket(instance, packet), t);
+            }
+        }
+        return 0;
     }
 
 #pragma region Scene Helpers
@@ -155,6 +789,53 @@ namespace dae
         return &m_TriangleMeshGeometries.back();
     }
 
+    uint32_t Scene::AddSharedMesh(const std::string& objFilePath, TriangleCullMode cullMode)
+    {
+        TriangleMesh m{};
+        m.cullMode = cullMode;
+
+        //Instances only ever read the object space data, the transformed copies stay empty
+#if MESH_CACHE
+        const MeshCache cache{objFilePath};
+        const bool isCached{cache.Load(m)};
+#else
+        constexpr bool isCached{false};
+#endif
+        if (not isCached)
+        {
+            const bool isParsed{OBJParser::Parse(objFilePath, m.positions, m.normals, m.indices)};
+            if (not isParsed)
+                std::cout << "Something went wrong. Mesh not loaded from " << objFilePath << std::endl;
+
+            m.UpdateAABB();
+            m.UpdateBVH(m.positions);
+#if TRIANGLE_BLOCKS
+            m.UpdateTriangleBlocks(m.positions);
+#endif
+#if MESH_CACHE
+            if (isParsed and not cache.Save(m))
+                std::cout << "Something went wrong. Mesh cache not saved to " << cache.GetCachePath() << std::endl;
+#endif
+        }
+
+        m_SharedMeshes.emplace_back(std::move(m));
+        return static_cast<uint32_t>(m_SharedMeshes.size() - 1);
+    }
+
+    MeshInstance* Scene::AddMeshInstance(uint32_t meshIndex, unsigned char materialIndex)
+    {
+        const TriangleMesh& mesh{m_SharedMeshes[meshIndex]};
+
+        MeshInstance instance{};
+        instance.meshIndex = meshIndex;
+        instance.materialIndex = materialIndex;
+        instance.objectBounds = {mesh.minAABB, mesh.maxAABB};
+        instance.SetTransform(Matrix{});
+
+        m_MeshInstances.emplace_back(instance);
+        return &m_MeshInstances.back();
+    }
+
     Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
     {
         Light l;
@@ -182,8 +863,138 @@ namespace dae
     unsigned char Scene::AddMaterial(Material* pMaterial)
     {
         m_Materials.push_back(pMaterial);
+        m_MaterialTable.push_back(pMaterial->GetData());
         return static_cast<unsigned char>(m_Materials.size() - 1);
     }
+
+    void Scene::BuildTLAS()
+    {
+        m_PlaneSoA.Build(m_PlaneGeometries);
+        BuildRoom();
+
+        m_TLASPrimitives.clear();
+        m_TLASPrimitives.reserve(m_SphereGeometries.size() + m_TriangleMeshGeometries.size() + m_MeshInstances.size());
+
+        for (uint32_t idx{0}; idx < m_SphereGeometries.size(); ++idx)
+        {
+            m_TLASPrimitives.push_back({PrimitiveType::Sphere, idx});
+        }
+        for (uint32_t idx{0}; idx < m_TriangleMeshGeometries.size(); ++idx)
+        {
+            m_TLASPrimitives.push_back({PrimitiveType::TriangleMesh, idx});
+        }
+        for (uint32_t idx{0}; idx < m_MeshInstances.size(); ++idx)
+        {
+            m_TLASPrimitives.push_back({PrimitiveType::MeshInstance, idx});
+        }
+
+#if SOA_GEOMETRY
+        //Leaves gather up to one SoA block of primitives, without spheres there is nothing to test 8 at a time
+        m_TLAS.leafBatchSize = m_SphereGeometries.empty() ? 1 : SOA_WIDTH;
+#endif
+        UpdateTLASBounds();
+        m_TLAS.Build(m_TLASBounds);
+        BuildSphereSoA();
+        m_GeometryVersion = GetNextGeometryVersion();
+    }
+
+    void Scene::BuildSphereSoA()
+    {
+        std::vector<uint32_t> order{};
+        order.reserve(m_SphereGeometries.size());
+        m_TLASLeafFirstSphere.assign(m_TLAS.nodes.size() + 1, 0);
+
+        for (uint32_t nodeIdx{0}; nodeIdx < m_TLAS.nodes.size(); ++nodeIdx)
+        {
+            m_TLASLeafFirstSphere[nodeIdx] = static_cast<uint32_t>(order.size());
+
+            const BVHNode& node{m_TLAS.nodes[nodeIdx]};
+            for (uint32_t idx{node.leftFirst}; node.IsLeaf() and idx < node.leftFirst + node.primCount; ++idx)
+            {
+                const PrimitiveRef& primitive{m_TLASPrimitives[m_TLAS.primIndices[idx]]};
+                if (primitive.type == PrimitiveType::Sphere) order.push_back(primitive.index);
+            }
+        }
+        m_TLASLeafFirstSphere.back() = static_cast<uint32_t>(order.size());
+
+        m_SphereSoA.Build(m_SphereGeometries, order);
+    }
+
+    void Scene::BuildRoom()
+    {
+        m_Room = {};
+#if PLANE_ROOM
+        if (m_PlaneGeometries.empty()) return;
+
+        Room room{};
+        for (uint32_t idx{0}; idx < m_PlaneGeometries.size(); ++idx)
+        {
+            const Plane& plane{m_PlaneGeometries[idx]};
+
+            //The normal has to be exactly +-1 on one axis and 0 on the others, anything else keeps the plane path
+            int axis{-1};
+            for (int component{0}; component < 3; ++component)
+            {
+                const float value{plane.normal[component]};
+                if (value == 0.0f) continue;
+                if (axis != -1 or (value != 1.0f and value != -1.0f)) return;
+                axis = component;
+            }
+            if (axis == -1) return;
+
+            //The slab test keeps a single wall per side
+            const int side{plane.normal[axis] > 0.0f ? 0 : 1};
+            if (room.planeIndices[axis][side] != -1) return;
+
+            room.planeIndices[axis][side] = static_cast<int>(idx);
+            room.bounds[axis][side] = plane.origin[axis];
+        }
+
+        //Facing walls must enclose something
+        for (int axis{0}; axis < 3; ++axis)
+        {
+            if (room.planeIndices[axis][0] != -1 and room.planeIndices[axis][1] != -1 and room.bounds[axis][0] >= room.bounds[axis][1]) return;
+        }
+
+        room.isValid = true;
+        m_Room = room;
+#endif
+    }
+
+    void Scene::UpdateTLAS()
+    {
+        UpdateTLASBounds();
+        //Spheres never move, the SoA only has to follow a new leaf layout
+        if (m_TLAS.Update(m_TLASBounds)) BuildSphereSoA();
+        m_GeometryVersion = GetNextGeometryVersion();
+    }
+
+    void Scene::UpdateTLASBounds()
+    {
+        m_TLASBounds.resize(m_TLASPrimitives.size());
+        for (size_t idx{0}; idx < m_TLASPrimitives.size(); ++idx)
+        {
+            const PrimitiveRef& primitive{m_TLASPrimitives[idx]};
+            switch (primitive.type)
+            {
+            case PrimitiveType::Sphere:
+                {
+                    const Sphere& sphere{m_SphereGeometries[primitive.index]};
+                    const Vector3 extent{sphere.radius, sphere.radius, sphere.radius};
+                    m_TLASBounds[idx] = {sphere.origin - extent, sphere.origin + extent};
+                }
+                break;
+            case PrimitiveType::TriangleMesh:
+                m_TLASBounds[idx] = m_TriangleMeshGeometries[primitive.index].GetTransformedBounds();
+                break;
+            case PrimitiveType::MeshInstance:
+                m_TLASBounds[idx] = m_MeshInstances[primitive.index].bounds;
+                break;
+            case PrimitiveType::Plane: //Planes are never part of the TLAS
+                break;
+            }
+        }
+    }
 #pragma endregion
 #pragma endregion
 
@@ -207,6 +1018,8 @@ namespace dae
         AddPlane({0.f, -75.f, 0.f}, {0.f, 1.f, 0.f}, matId_Solid_Yellow);
         AddPlane({0.f, 75.f, 0.f}, {0.f, -1.f, 0.f}, matId_Solid_Yellow);
         AddPlane({0.f, 0.f, 125.f}, {0.f, 0.f, -1.f}, matId_Solid_Magenta);
+
+        BuildTLAS();
     }
 #pragma endregion
 
@@ -241,6 +1054,8 @@ namespace dae
 
         //Light
         AddPointLight({0.f, 5.f, -5.f}, 70.f, colors::White);
+
+        BuildTLAS();
     }
 #pragma endregion
 
@@ -290,6 +1105,8 @@ namespace dae
         AddPointLight(Vector3{0.f, 5.f, 5.f}, 50.f, ColorRGB{1.f, .61f, .45f}); //Backlight
         AddPointLight(Vector3{-2.5f, 5.f, -5.f}, 70.f, ColorRGB{1.f, .8f, .45f}); //Front Light Left
         AddPointLight(Vector3{2.5f, 2.5f, -5.f}, 50.f, ColorRGB{.34f, .47f, .68f});
+
+        BuildTLAS();
     }
 
 #pragma endregion
@@ -347,6 +1164,8 @@ namespace dae
         AddPointLight(Vector3{0.f, 5.f, 5.f}, 50.f, ColorRGB{1.f, .61f, .45f}); //Backlight
         AddPointLight(Vector3{-2.5f, 5.f, -5.f}, 70.f, ColorRGB{1.f, .8f, .45f}); //Front Light Left
         AddPointLight(Vector3{2.5f, 2.5f, -5.f}, 50.f, ColorRGB{.34f, .47f, .68f});
+
+        BuildTLAS();
     }
 
     void Scene_W4::Update(dae::Timer* pTimer)
@@ -359,6 +1178,7 @@ namespace dae
             mesh->RotateY(yawAngle);
             mesh->UpdateTransforms();
         }
+        UpdateTLAS();
     }
 
 #pragma endregion
@@ -386,7 +1206,6 @@ namespace dae
 
         ////OBJ
          ////===
-        pMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
         std::string path = "Resources/lowpoly_bunny.obj";
 #if SIMPLE_CUBE
         path = "Resources/simple_cube.obj";
@@ -395,29 +1214,24 @@ namespace dae
 #elif SIMPLE_QUAD
         path = "Resources/simple_quad.obj";
 #endif
-        Utils::ParseOBJ(path,
-                        pMesh->positions,
-                        pMesh->normals,
-                        pMesh->indices);
-
-        //No need to Calculate the normals, these are calculated inside the ParseOBJ function
-        pMesh->transformedPositions.resize(pMesh->positions.size());
-        pMesh->transformedNormals.resize(pMesh->normals.size());
+        //The mesh stays in object space, only the instance transform changes every frame
+        const uint32_t meshIdx{AddSharedMesh(path, TriangleCullMode::BackFaceCulling)};
+        pMeshInstance = AddMeshInstance(meshIdx, matLambert_White);
 
-        pMesh->Scale({2.0f, 2.0f, 2.0f});
+        m_MeshScale = Matrix::CreateScale({2.0f, 2.0f, 2.0f});
 #if SIMPLE_CUBE or SIMPLE_OBJECT or SIMPLE_QUAD
-        pMesh->Scale({0.7f, 0.7f, 0.7f});
-        pMesh->Translate({0.0f, 1.0f, 0.0f});
+        m_MeshScale = Matrix::CreateScale({0.7f, 0.7f, 0.7f});
+        m_MeshTranslation = Matrix::CreateTranslation({0.0f, 1.0f, 0.0f});
 #endif
-
-        pMesh->UpdateAABB();
-        pMesh->UpdateTransforms();
+        pMeshInstance->SetTransform(m_MeshScale * m_MeshTranslation);
 
 
         //Light
         AddPointLight(Vector3{0.f, 5.f, 5.f}, 50.f, ColorRGB{1.f, .61f, .45f}); //Backlight
         AddPointLight(Vector3{-2.5f, 5.f, -5.f}, 70.f, ColorRGB{1.f, .8f, .45f}); //Front Light Left
         AddPointLight(Vector3{2.5f, 2.5f, -5.f}, 50.f, ColorRGB{.34f, .47f, .68f});
+
+        BuildTLAS();
     }
 
     void Scene_W5::Update(dae::Timer* pTimer)
@@ -425,9 +1239,101 @@ namespace dae
         Scene::Update(pTimer);
 
         const auto yawAngle{(std::cos(pTimer->GetTotal()) + 1.0f) * 0.5f * PI_2};
-        pMesh->RotateY(yawAngle);
-        pMesh->UpdateAABB();
-        pMesh->UpdateTransforms();
+        pMeshInstance->SetTransform(m_MeshScale * Matrix::CreateRotationY(yawAngle) * m_MeshTranslation);
+        UpdateTLAS();
+    }
+#pragma endregion
+
+#pragma region BENCHMARK SCENES
+
+    void Scene_SphereGrid::Initialize()
+    {
+        sceneName = "Sphere Grid";
+        m_Camera.origin = {0.f, 3.f, -9.f};
+        m_Camera.fovAngle = 45.f;
+
+        const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({.972f, .960f, .915f}, 1.f, .6f));
+        const auto matCT_GrayRoughPlastic = AddMaterial(new Material_CookTorrence({.75f, .75f, .75f}, .0f, 1.f));
+        const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({.49f, 0.57f, 0.57f}, 1.f));
+
+        AddPlane(Vector3{0.f, 0.f, 10.f}, Vector3{0.f, 0.f, -1.f}, matLambert_GrayBlue); //BACK
+        AddPlane(Vector3{0.f, 0.f, 0.f}, Vector3{0.f, 1.f, 0.f}, matLambert_GrayBlue); //BOTTOM
+        AddPlane(Vector3{0.f, 10.f, 0.f}, Vector3{0.f, -1.f, 0.f}, matLambert_GrayBlue); //TOP
+        AddPlane(Vector3{5.f, 0.f, 0.f}, Vector3{-1.f, 0.f, 0.f}, matLambert_GrayBlue); //RIGHT
+        AddPlane(Vector3{-5.f, 0.f, 0.f}, Vector3{1.f, 0.f, 0.f}, matLambert_GrayBlue); //LEFT
+
+        //32 x 32 spheres on a slanted wall, every other one metal
+        constexpr int gridSize{32};
+        for (int row{0}; row < gridSize; ++row)
+        {
+            for (int column{0}; column < gridSize; ++column)
+            {
+                const Vector3 origin{
+                    -4.5f + 9.f * static_cast<float>(column) / (gridSize - 1),
+                    0.5f + 6.f * static_cast<float>(row) / (gridSize - 1),
+                    2.f + 4.f * static_cast<float>(row) / (gridSize - 1)
+                };
+                AddSphere(origin, .12f, (row + column) % 2 ? matCT_GrayMediumMetal : matCT_GrayRoughPlastic);
+            }
+        }
+
+        AddPointLight(Vector3{0.f, 5.f, 5.f}, 50.f, ColorRGB{1.f, .61f, .45f}); //Backlight
+        AddPointLight(Vector3{-2.5f, 5.f, -5.f}, 70.f, ColorRGB{1.f, .8f, .45f}); //Front Light Left
+        AddPointLight(Vector3{2.5f, 2.5f, -5.f}, 50.f, ColorRGB{.34f, .47f, .68f});
+
+        BuildTLAS();
+    }
+
+    void Scene_InstanceGrid::Initialize()
+    {
+        sceneName = "Instance Grid";
+        m_Camera.origin = {0.f, 3.f, -9.f};
+        m_Camera.fovAngle = 45.f;
+
+        const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({.49f, 0.57f, 0.57f}, 1.f));
+        const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+
+        AddPlane(Vector3{0.f, 0.f, 10.f}, Vector3{0.f, 0.f, -1.f}, matLambert_GrayBlue); //BACK
+        AddPlane(Vector3{0.f, 0.f, 0.f}, Vector3{0.f, 1.f, 0.f}, matLambert_GrayBlue); //BOTTOM
+        AddPlane(Vector3{0.f, 10.f, 0.f}, Vector3{0.f, -1.f, 0.f}, matLambert_GrayBlue); //TOP
+        AddPlane(Vector3{5.f, 0.f, 0.f}, Vector3{-1.f, 0.f, 0.f}, matLambert_GrayBlue); //RIGHT
+        AddPlane(Vector3{-5.f, 0.f, 0.f}, Vector3{1.f, 0.f, 0.f}, matLambert_GrayBlue); //LEFT
+
+        //GRID_SIZE x GRID_SIZE bunnies on the floor, receding towards the back wall
+        const uint32_t meshIdx{AddSharedMesh("Resources/lowpoly_bunny.obj", TriangleCullMode::BackFaceCulling)};
+        const Matrix scale{Matrix::CreateScale({.6f, .6f, .6f})};
+        for (int row{0}; row < GRID_SIZE; ++row)
+        {
+            for (int column{0}; column < GRID_SIZE; ++column)
+            {
+                const Vector3 position{
+                    -4.f + 8.f * static_cast<float>(column) / (GRID_SIZE - 1),
+                    0.f,
+                    -1.f + 10.f * static_cast<float>(row) / (GRID_SIZE - 1)
+                };
+                m_InstancePlacement.push_back(scale * Matrix::CreateTranslation(position));
+                AddMeshInstance(meshIdx, matLambert_White)->SetTransform(m_InstancePlacement.back());
+            }
+        }
+
+        AddPointLight(Vector3{0.f, 5.f, 5.f}, 50.f, ColorRGB{1.f, .61f, .45f}); //Backlight
+        AddPointLight(Vector3{-2.5f, 5.f, -5.f}, 70.f, ColorRGB{1.f, .8f, .45f}); //Front Light Left
+        AddPointLight(Vector3{2.5f, 2.5f, -5.f}, 50.f, ColorRGB{.34f, .47f, .68f});
+
+        BuildTLAS();
+    }
+
+    void Scene_InstanceGrid::Update(dae::Timer* pTimer)
+    {
+        Scene::Update(pTimer);
+
+        //Every bunny gets its own phase, so the instance bounds all change differently
+        for (size_t idx{0}; idx < m_MeshInstances.size(); ++idx)
+        {
+            const float yawAngle{(std::cos(pTimer->GetTotal() + static_cast<float>(idx)) + 1.0f) * 0.5f * PI_2};
+            m_MeshInstances[idx].SetTransform(Matrix::CreateRotationY(yawAngle) * m_InstancePlacement[idx]);
+        }
+        UpdateTLAS();
     }
 #pragma endregion
 }
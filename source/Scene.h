@@ -6,6 +6,9 @@
 
 #include "Math.h"
 #include "DataTypes.h"
+#include "GeometrySoA.h"
+#include "RayPacket.h"
+#include "RayStats.h"
 #include "Camera.h"
 
 namespace dae
@@ -42,12 +45,47 @@ namespace dae
         void GetClosestHitPlane(const Ray& ray, HitRecord& closestHit) const;
         void GetClosestHitTriangle(const Ray& ray, HitRecord& closestHit) const;
         void GetClosestHitTriangleMesh(const Ray& ray, HitRecord& closestHit) const;
+        void GetClosestHitMeshInstance(const Ray& ray, HitRecord& closestHit) const;
         bool DoesHit(const Ray& ray) const;
 
+        /**
+         * \brief DoesHit that first tests lastOccluder, the primitive that blocked the previous shadow ray towards the same light \n
+         * Keep one per render thread and light, it is replaced by every occluder the traversal finds, see OCCLUDER_CACHE
+         */
+        bool DoesHit(const Ray& ray, PrimitiveHit& lastOccluder) const;
+
+        /**
+         * \brief Closest hit for every active lane of the packet, inactive lanes keep their HitRecord untouched
+         */
+        void GetClosestHitPacket(const RayPacket& packet, HitRecord (&closestHits)[PACKET_WIDTH]) const;
+
+        /**
+         * \return Bit mask of the active lanes that are occluded
+         */
+        int DoesHitPacket(const RayPacket& packet) const;
+        int DoesHitPacket(const RayPacket& packet, PrimitiveHit& lastOccluder) const;
+
         const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
         const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
         const std::vector<Light>& GetLights() const { return m_Lights; }
-        const std::vector<Material*> GetMaterials() const { return m_Materials; }
+        const std::vector<Material*>& GetMaterials() const { return m_Materials; }
+
+        /**
+         * \brief GetData of every material, same indices as GetMaterials
+         */
+        const std::vector<MaterialData>& GetMaterialTable() const { return m_MaterialTable; }
+
+        /**
+         * \brief Rays traced since the last ResetRayStats, only counted with RAY_STATS
+         */
+        const RayStats& GetRayStats() const { return m_RayStats; }
+        void ResetRayStats() { m_RayStats.Reset(); }
+
+        /**
+         * \brief Changed by BuildTLAS and UpdateTLAS and never the same for two scenes \n
+         * The renderer restarts its accumulation and retraces its G-buffer when it changes
+         */
+        uint64_t GetGeometryVersion() const { return m_GeometryVersion; }
 
     protected:
         std::string sceneName;
@@ -55,11 +93,33 @@ namespace dae
         std::vector<Plane>        m_PlaneGeometries        {};
         std::vector<Sphere>       m_SphereGeometries       {};
         std::vector<TriangleMesh> m_TriangleMeshGeometries {};
+        std::vector<TriangleMesh> m_SharedMeshes           {};
+        std::vector<MeshInstance> m_MeshInstances          {};
         std::vector<Light>        m_Lights                 {};
         std::vector<Material*>    m_Materials              {};
+        std::vector<MaterialData> m_MaterialTable          {};
 
         std::map<Vector3, int> m_Hits {};
 
+        //Copies of the sphere and plane vectors for the 8-wide hit tests, see SOA_GEOMETRY
+        SphereSoA m_SphereSoA {};
+        PlaneSoA  m_PlaneSoA  {};
+
+        //The spheres of TLAS leaf n are the m_SphereSoA slots [m_TLASLeafFirstSphere[n], m_TLASLeafFirstSphere[n + 1])
+        std::vector<uint32_t> m_TLASLeafFirstSphere {};
+
+        //The planes as one primitive when they are the walls of a room, see PLANE_ROOM
+        Room m_Room {};
+
+        //Top-level acceleration structure, each TriangleMesh keeps its own bottom-level BVH
+        BVH                       m_TLAS            {};
+        std::vector<PrimitiveRef> m_TLASPrimitives  {};
+        std::vector<AABB>         m_TLASBounds      {};
+        uint64_t                  m_GeometryVersion {0};
+
+        //The hit queries are const and run on every render thread
+        mutable RayStats m_RayStats {};
+
         // temp
         std::vector<Triangle> m_Triangles {};
         Camera m_Camera {};
@@ -68,9 +128,73 @@ namespace dae
         Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
         TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
 
+        /**
+         * \brief Loads an OBJ once and keeps it in object space, place it in the scene with AddMeshInstance
+         * \return index of the shared mesh
+         */
+        uint32_t AddSharedMesh(const std::string& objFilePath, TriangleCullMode cullMode);
+        MeshInstance* AddMeshInstance(uint32_t meshIndex, unsigned char materialIndex = 0);
+
         Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
         Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
         unsigned char AddMaterial(Material* pMaterial);
+
+        /**
+         * \brief (Re)builds the top-level BVH and the SoA geometry, call after adding geometry or moving meshes
+         */
+        void BuildTLAS();
+
+        /**
+         * \brief Refits the top-level BVH to the current object bounds, call after moving meshes
+         */
+        void UpdateTLAS();
+
+    private:
+        void UpdateTLASBounds();
+
+        /**
+         * \brief Copies the spheres into m_SphereSoA grouped per TLAS leaf, call whenever the TLAS changed
+         */
+        void BuildSphereSoA();
+
+        /**
+         * \brief Merges the planes into m_Room if all of them are axis-aligned walls of one box, see PLANE_ROOM
+         */
+        void BuildRoom();
+
+        //Closest hit traversal, only the distance and the primitive of the closest hit are tracked
+        void GetClosestHitSphere(const Ray& ray, PrimitiveHit& closestHit) const;
+        void GetClosestHitPlane(const Ray& ray, PrimitiveHit& closestHit) const;
+        void GetClosestHitTriangleMesh(const Ray& ray, PrimitiveHit& closestHit) const;
+        void GetClosestHitMeshInstance(const Ray& ray, PrimitiveHit& closestHit) const;
+
+        /**
+         * \brief Fills hit point, normal and material of the primitive that won the traversal, leaves hitRecord untouched if nothing was hit
+         */
+        void ResolveHit(const Ray& ray, const PrimitiveHit& hit, HitRecord& hitRecord) const;
+
+        /**
+         * \brief Any-hit traversal of DoesHit, occluder receives the primitive that blocked the ray
+         */
+        bool FindOccluder(const Ray& ray, PrimitiveHit& occluder) const;
+        bool FindOccluderPlane(const Ray& ray, PrimitiveHit& occluder) const;
+
+        /**
+         * \brief Any-hit traversal of DoesHitPacket, the active lanes retire as they get blocked \n
+         * occluder receives the primitive that blocked the last of them
+         */
+        int FindOccludersPacket(RayPacket& sceneRays, PrimitiveHit& occluder) const;
+
+        /**
+         * \brief Whether the cached occluder blocks the ray, false for an empty entry
+         */
+        bool DoesHitOccluder(const Ray& ray, const PrimitiveHit& occluder) const;
+        int DoesHitOccluderPacket(const RayPacket& packet, const PrimitiveHit& occluder) const;
+
+        /**
+         * \brief The occluder caches outlive scene switches, an entry of another scene may point past the geometry of this one
+         */
+        bool IsInScene(const PrimitiveHit& occluder) const;
     };
 
     //+++++++++++++++++++++++++++++++++++++++++
@@ -159,7 +283,52 @@ namespace dae
         void Update(dae::Timer* pTimer) override;
 
     private:
-        TriangleMesh* pMesh       {nullptr};
-        TriangleMesh* m_Meshes[3] {};
+        MeshInstance* pMeshInstance {nullptr};
+
+        Matrix m_MeshScale       {};
+        Matrix m_MeshTranslation {};
+    };
+
+    //+++++++++++++++++++++++++++++++++++++++++
+    //BENCHMARK Scenes, larger than the week scenes
+    /**
+     * \brief Grid of small spheres in front of the reference room, stresses the sphere tests and shadow rays
+     */
+    class Scene_SphereGrid final : public Scene
+    {
+    public:
+        Scene_SphereGrid() = default;
+        ~Scene_SphereGrid() override = default;
+
+        Scene_SphereGrid(const Scene_SphereGrid&) = delete;
+        Scene_SphereGrid(Scene_SphereGrid&&) noexcept = delete;
+        Scene_SphereGrid& operator=(const Scene_SphereGrid&) = delete;
+        Scene_SphereGrid& operator=(Scene_SphereGrid&&) noexcept = delete;
+
+        void Initialize() override;
+    };
+
+    /**
+     * \brief Grid of rotating bunny instances sharing one mesh, stresses the top-level BVH and its refit
+     */
+    class Scene_InstanceGrid final : public Scene
+    {
+    public:
+        Scene_InstanceGrid() = default;
+        ~Scene_InstanceGrid() override = default;
+
+        Scene_InstanceGrid(const Scene_InstanceGrid&) = delete;
+        Scene_InstanceGrid(Scene_InstanceGrid&&) noexcept = delete;
+        Scene_InstanceGrid& operator=(const Scene_InstanceGrid&) = delete;
+        Scene_InstanceGrid& operator=(Scene_InstanceGrid&&) noexcept = delete;
+
+        void Initialize() override;
+        void Update(dae::Timer* pTimer) override;
+
+    private:
+        static constexpr int GRID_SIZE{8};
+
+        //Scale and translation of every entry in m_MeshInstances, the rotation is added in Update
+        std::vector<Matrix> m_InstancePlacement {};
     };
 }
@@ -0,0 +1,167 @@
+#include "ShadingBatch.h"
+
+#include <cstddef>
+
+namespace dae
+{
+    namespace
+    {
+        //Materials are gathered as floats, MATERIAL_STRIDE floats apart
+        static_assert(sizeof(MaterialData) % sizeof(float) == 0 and sizeof(ColorRGB) == 3 * sizeof(float));
+        constexpr int MATERIAL_STRIDE{sizeof(MaterialData) / sizeof(float)};
+
+        /**
+         * \brief Lanes of one block of the batch, starting at idx: the inputs as Vector3N and the material parameters gathered from the material table
+         */
+        template <typename FloatN>
+        struct ShadingBlock
+        {
+            const MaterialData*  pMaterials;
+            const unsigned char* pMaterialIndices;
+            Vector3N<FloatN>     n;
+            Vector3N<FloatN>     l;
+            Vector3N<FloatN>     v;
+
+            ShadingBlock(const MaterialData* pMaterialTable, const ShadingBatch& batch, uint32_t idx)
+                : pMaterials{pMaterialTable}
+                  , pMaterialIndices{&batch.materialIndices[idx]}
+                  , n{Vector3N<FloatN>::Load(&batch.normalX[idx], &batch.normalY[idx], &batch.normalZ[idx])}
+                  , l{Vector3N<FloatN>::Load(&batch.lightX[idx], &batch.lightY[idx], &batch.lightZ[idx])}
+                  , v{Vector3N<FloatN>::Load(&batch.viewX[idx], &batch.viewY[idx], &batch.viewZ[idx])}
+            {
+            }
+
+            /**
+             * \brief The float at fieldOffset bytes into the MaterialData of every lane
+             */
+            FloatN Get(size_t fieldOffset) const
+            {
+                const float* pField{reinterpret_cast<const float*>(reinterpret_cast<const char*>(pMaterials) + fieldOffset)};
+                return Gather<FloatN>(pField, pMaterialIndices, MATERIAL_STRIDE);
+            }
+
+            ColorRGBN<FloatN> GetColor(size_t fieldOffset) const
+            {
+                return {Get(fieldOffset), Get(fieldOffset + sizeof(float)), Get(fieldOffset + 2 * sizeof(float))};
+            }
+        };
+
+        template <typename FloatN>
+        ColorRGBN<FloatN> Shade_SolidColor(const ShadingBlock<FloatN>& block)
+        {
+            return block.GetColor(offsetof(MaterialData, color));
+        }
+
+        template <typename FloatN>
+        ColorRGBN<FloatN> Shade_Lambert(const ShadingBlock<FloatN>& block)
+        {
+            return BRDF::Lambert(block.Get(offsetof(MaterialData, diffuseReflectance)), block.GetColor(offsetof(MaterialData, color)));
+        }
+
+        template <typename FloatN>
+        ColorRGBN<FloatN> Shade_LambertPhong(const ShadingBlock<FloatN>& block)
+        {
+            const ColorRGBN<FloatN> diffuse{BRDF::Lambert(block.Get(offsetof(MaterialData, diffuseReflectance)), block.GetColor(offsetof(MaterialData, color)))};
+            const FloatN specular{
+                BRDF::Phong(block.Get(offsetof(MaterialData, specularReflectance)), block.Get(offsetof(MaterialData, phongExponent)), block.l, block.v, block.n)
+            };
+            return {diffuse.r + specular, diffuse.g + specular, diffuse.b + specular};
+        }
+
+        //See Material_CookTorrence::Shade
+        template <typename FloatN>
+        ColorRGBN<FloatN> Shade_CookTorrence(const ShadingBlock<FloatN>& block)
+        {
+            const Vector3N<FloatN>& n{block.n};
+            const Vector3N<FloatN>& l{block.l};
+            const Vector3N<FloatN>& v{block.v};
+            const FloatN roughness{block.Get(offsetof(MaterialData, roughness))};
+
+            const Vector3N<FloatN> h{(v + l) / (v + l).Magnitude()};
+
+            const ColorRGBN<FloatN> F{BRDF::FresnelFunction_Schlick(h, v, block.GetColor(offsetof(MaterialData, f0)))};
+            const FloatN D{BRDF::NormalDistribution_GGX(n, h, roughness)};
+            const FloatN G{BRDF::GeometryFunction_Smith(n, v, l, roughness)};
+
+            const ColorRGBN<FloatN> specular{
+                (F * D * G) /
+                (FloatN{4.0f} * Vector3N<FloatN>::Dot(v, n) * Vector3N<FloatN>::Dot(l, n))
+            };
+
+            //Metals have no diffuse part
+            const auto isDielectric{block.Get(offsetof(MaterialData, metalness)) == FloatN{0.0f}};
+            const ColorRGBN<FloatN> kd{
+                Select(isDielectric, FloatN{1.0f} - specular.r, FloatN{0.0f}),
+                Select(isDielectric, FloatN{1.0f} - specular.g, FloatN{0.0f}),
+                Select(isDielectric, FloatN{1.0f} - specular.b, FloatN{0.0f})
+            };
+            const ColorRGBN<FloatN> diffuse{BRDF::Lambert(kd, block.GetColor(offsetof(MaterialData, color)))};
+
+            return diffuse + specular;
+        }
+
+        template <MaterialType type, typename FloatN>
+        void ShadeBlock(const MaterialData* pMaterials, ShadingBatch& batch, uint32_t idx)
+        {
+            const ShadingBlock<FloatN> block{pMaterials, batch, idx};
+
+            ColorRGBN<FloatN> color;
+            if constexpr (type == MaterialType::SolidColor) color = Shade_SolidColor(block);
+            else if constexpr (type == MaterialType::Lambert) color = Shade_Lambert(block);
+            else if constexpr (type == MaterialType::LambertPhong) color = Shade_LambertPhong(block);
+            else color = Shade_CookTorrence(block);
+
+            color.Store(&batch.r[idx], &batch.g[idx], &batch.b[idx]);
+        }
+
+        /**
+         * \brief Shades [begin, end) in blocks of 8 lanes, then at most one block of 4 and the rest one by one
+         */
+        template <MaterialType type>
+        void ShadeBlocks(const MaterialData* pMaterials, ShadingBatch& batch, uint32_t begin, uint32_t end)
+        {
+            uint32_t idx{begin};
+            for (; idx + Float8::width <= end; idx += Float8::width)
+            {
+                ShadeBlock<type, Float8>(pMaterials, batch, idx);
+            }
+            if (idx + Float4::width <= end)
+            {
+                ShadeBlock<type, Float4>(pMaterials, batch, idx);
+                idx += Float4::width;
+            }
+            for (; idx < end; ++idx)
+            {
+                ShadeBlock<type, float>(pMaterials, batch, idx);
+            }
+        }
+    }
+
+    void ShadingBatch::Resize(uint32_t count)
+    {
+        for (std::vector<float>* pArray : {&normalX, &normalY, &normalZ, &lightX, &lightY, &lightZ, &viewX, &viewY, &viewZ, &r, &g, &b})
+        {
+            pArray->resize(count);
+        }
+        materialIndices.resize(count);
+    }
+
+    void ShadeBatch(MaterialType type, const std::vector<MaterialData>& materials, ShadingBatch& batch, uint32_t begin, uint32_t end)
+    {
+        switch (type)
+        {
+        case MaterialType::SolidColor:
+            ShadeBlocks<MaterialType::SolidColor>(materials.data(), batch, begin, end);
+            break;
+        case MaterialType::Lambert:
+            ShadeBlocks<MaterialType::Lambert>(materials.data(), batch, begin, end);
+            break;
+        case MaterialType::LambertPhong:
+            ShadeBlocks<MaterialType::LambertPhong>(materials.data(), batch, begin, end);
+            break;
+        case MaterialType::CookTorrence:
+            ShadeBlocks<MaterialType::CookTorrence>(materials.data(), batch, begin, end);
+            break;
+        }
+    }
+}
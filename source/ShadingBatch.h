@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Material.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+    /**
+     * \brief Light samples of one shading pass in structure-of-arrays layout: normal, direction to the light and view direction \n
+     * The wavefront shading stage fills it sorted by material type, so every ShadeBatch call runs one branch-free loop over contiguous arrays
+     */
+    struct ShadingBatch
+    {
+        std::vector<float>         normalX         {};
+        std::vector<float>         normalY         {};
+        std::vector<float>         normalZ         {};
+        std::vector<float>         lightX          {};
+        std::vector<float>         lightY          {};
+        std::vector<float>         lightZ          {};
+        std::vector<float>         viewX           {};
+        std::vector<float>         viewY           {};
+        std::vector<float>         viewZ           {};
+        std::vector<unsigned char> materialIndices {};
+
+        //Output of ShadeBatch, the BRDF of every sample
+        std::vector<float> r {};
+        std::vector<float> g {};
+        std::vector<float> b {};
+
+        /**
+         * \brief Makes room for count samples, only allocates when count grows past every earlier call
+         */
+        void Resize(uint32_t count);
+
+        void Set(uint32_t idx, const Vector3& normal, const Vector3& l, const Vector3& v, unsigned char materialIndex)
+        {
+            normalX[idx] = normal.x;
+            normalY[idx] = normal.y;
+            normalZ[idx] = normal.z;
+            lightX[idx] = l.x;
+            lightY[idx] = l.y;
+            lightZ[idx] = l.z;
+            viewX[idx] = v.x;
+            viewY[idx] = v.y;
+            viewZ[idx] = v.z;
+            materialIndices[idx] = materialIndex;
+        }
+
+        ColorRGB GetColor(uint32_t idx) const { return {r[idx], g[idx], b[idx]}; }
+    };
+
+    /**
+     * \brief Shades the samples [begin, end) of the batch, which must all use materials of the given type \n
+     * 8 samples at a time with the wide BRDFs, the same expressions as the Shade of that material class except for Phong's FastPow
+     */
+    void ShadeBatch(MaterialType type, const std::vector<MaterialData>& materials, ShadingBatch& batch, uint32_t begin, uint32_t end);
+}
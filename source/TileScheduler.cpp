@@ -0,0 +1,218 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+
+namespace dae
+{
+    namespace
+    {
+        uint64_t PackRange(uint32_t begin, uint32_t end)
+        {
+            return static_cast<uint64_t>(begin) << 32 | end;
+        }
+
+        //Spreads the lower 16 bits so a zero sits between every two of them
+        uint32_t SpreadBits(uint32_t value)
+        {
+            value &= 0x0000ffff;
+            value = (value | value << 8) & 0x00ff00ff;
+            value = (value | value << 4) & 0x0f0f0f0f;
+            value = (value | value << 2) & 0x33333333;
+            value = (value | value << 1) & 0x55555555;
+            return value;
+        }
+
+        uint32_t GetMortonCode(uint32_t x, uint32_t y)
+        {
+            return SpreadBits(x) | SpreadBits(y) << 1;
+        }
+    }
+
+    TileScheduler::TileScheduler(uint32_t threadCount, int tileSize)
+    {
+        SetTileSize(tileSize);
+        StartWorkers(threadCount);
+    }
+
+    TileScheduler::~TileScheduler()
+    {
+        StopWorkers();
+    }
+
+    void TileScheduler::Run(int width, int height, const std::function<void(const Tile&, uint32_t workerIdx)>& renderTile)
+    {
+        if (width != m_FrameWidth or height != m_FrameHeight) BuildTiles(width, height);
+        if (m_Tiles.empty()) return;
+
+        //Every worker starts on its own contiguous run of the Morton order
+        const uint64_t tileCount{m_Tiles.size()};
+        for (uint32_t workerIdx{0}; workerIdx < m_ThreadCount; ++workerIdx)
+        {
+            const uint32_t begin{static_cast<uint32_t>(tileCount * workerIdx / m_ThreadCount)};
+            const uint32_t end{static_cast<uint32_t>(tileCount * (workerIdx + 1) / m_ThreadCount)};
+            m_Queues[workerIdx].range.store(PackRange(begin, end));
+        }
+
+        m_pRenderTile = &renderTile;
+        {
+            std::lock_guard lock{m_Mutex};
+            ++m_Generation;
+            m_BusyWorkers = static_cast<uint32_t>(m_Workers.size());
+        }
+        m_StartCondition.notify_all();
+
+        //The calling thread is worker 0
+        RenderTiles(0);
+
+        std::unique_lock lock{m_Mutex};
+        m_DoneCondition.wait(lock, [this] { return m_BusyWorkers == 0; });
+        m_pRenderTile = nullptr;
+    }
+
+    void TileScheduler::SetThreadCount(uint32_t threadCount)
+    {
+        StopWorkers();
+        StartWorkers(threadCount);
+    }
+
+    void TileScheduler::SetTileSize(int tileSize)
+    {
+        m_TileSize = std::max(2, (tileSize + 1) & ~1);
+
+        //Force a rebuild on the next Run
+        m_FrameWidth = 0;
+        m_FrameHeight = 0;
+    }
+
+    void TileScheduler::StartWorkers(uint32_t threadCount)
+    {
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+        m_ThreadCount = threadCount;
+        m_Queues = std::make_unique<TileQueue[]>(threadCount);
+
+        m_Workers.reserve(threadCount - 1);
+        for (uint32_t workerIdx{1}; workerIdx < threadCount; ++workerIdx)
+        {
+            //Handed over here rather than read by the thread, a Run that starts first must not be missed
+            m_Workers.emplace_back(&TileScheduler::WorkerLoop, this, workerIdx, m_Generation);
+        }
+    }
+
+    void TileScheduler::StopWorkers()
+    {
+        {
+            std::lock_guard lock{m_Mutex};
+            m_IsStopping = true;
+        }
+        m_StartCondition.notify_all();
+
+        for (std::thread& worker : m_Workers)
+        {
+            worker.join();
+        }
+        m_Workers.clear();
+        m_IsStopping = false;
+    }
+
+    void TileScheduler::WorkerLoop(uint32_t workerIdx, uint64_t generation)
+    {
+        std::unique_lock lock{m_Mutex};
+        while (true)
+        {
+            m_StartCondition.wait(lock, [this, generation] { return m_IsStopping or m_Generation != generation; });
+            if (m_IsStopping) return;
+            generation = m_Generation;
+
+            lock.unlock();
+            RenderTiles(workerIdx);
+            lock.lock();
+
+            if (--m_BusyWorkers == 0) m_DoneCondition.notify_one();
+        }
+    }
+
+    void TileScheduler::BuildTiles(int width, int height)
+    {
+        m_FrameWidth = width;
+        m_FrameHeight = height;
+        m_Tiles.clear();
+        if (width <= 0 or height <= 0) return;
+
+        const int tileCountX{(width + m_TileSize - 1) / m_TileSize};
+        const int tileCountY{(height + m_TileSize - 1) / m_TileSize};
+
+        std::vector<std::pair<uint32_t, Tile>> mortonTiles{};
+        mortonTiles.reserve(static_cast<size_t>(tileCountX) * tileCountY);
+        for (int tileY{0}; tileY < tileCountY; ++tileY)
+        {
+            for (int tileX{0}; tileX < tileCountX; ++tileX)
+            {
+                Tile tile{};
+                tile.minX = tileX * m_TileSize;
+                tile.minY = tileY * m_TileSize;
+                tile.maxX = std::min(tile.minX + m_TileSize, width);
+                tile.maxY = std::min(tile.minY + m_TileSize, height);
+                mortonTiles.emplace_back(GetMortonCode(tileX, tileY), tile);
+            }
+        }
+
+        std::sort(mortonTiles.begin(), mortonTiles.end(),
+                  [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+        m_Tiles.reserve(mortonTiles.size());
+        for (const auto& mortonTile : mortonTiles)
+        {
+            m_Tiles.push_back(mortonTile.second);
+        }
+    }
+
+    void TileScheduler::RenderTiles(uint32_t workerIdx)
+    {
+        uint32_t tileIdx;
+        while (PopTile(workerIdx, tileIdx) or StealTile(workerIdx, tileIdx))
+        {
+            (*m_pRenderTile)(m_Tiles[tileIdx], workerIdx);
+        }
+    }
+
+    bool TileScheduler::PopTile(uint32_t workerIdx, uint32_t& tileIdx)
+    {
+        std::atomic<uint64_t>& range{m_Queues[workerIdx].range};
+        uint64_t current{range.load()};
+        while (true)
+        {
+            const uint32_t begin{static_cast<uint32_t>(current >> 32)};
+            const uint32_t end{static_cast<uint32_t>(current)};
+            if (begin >= end) return false;
+
+            if (range.compare_exchange_weak(current, PackRange(begin + 1, end)))
+            {
+                tileIdx = begin;
+                return true;
+            }
+        }
+    }
+
+    bool TileScheduler::StealTile(uint32_t workerIdx, uint32_t& tileIdx)
+    {
+        for (uint32_t offset{1}; offset < m_ThreadCount; ++offset)
+        {
+            std::atomic<uint64_t>& range{m_Queues[(workerIdx + offset) % m_ThreadCount].range};
+            uint64_t current{range.load()};
+            while (true)
+            {
+                const uint32_t begin{static_cast<uint32_t>(current >> 32)};
+                const uint32_t end{static_cast<uint32_t>(current)};
+                if (begin >= end) break;
+
+                if (range.compare_exchange_weak(current, PackRange(begin, end - 1)))
+                {
+                    tileIdx = end - 1;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+}
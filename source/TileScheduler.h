@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+    /**
+     * \brief Pixel rectangle [minX, maxX) x [minY, maxY), clamped to the frame
+     */
+    struct Tile
+    {
+        int minX {0};
+        int minY {0};
+        int maxX {0};
+        int maxY {0};
+    };
+
+    /**
+     * \brief Splits the frame into square tiles in Morton order and renders them on a persistent thread pool \n
+     * Every worker owns a contiguous run of the Morton order, so neighbouring tiles (and their BVH nodes) stay on one core \n
+     * A worker that runs dry steals single tiles from the back of the other runs, uneven scenes still keep every core busy
+     */
+    class TileScheduler final
+    {
+    public:
+        static constexpr int DEFAULT_TILE_SIZE{16};
+
+        /**
+         * \param threadCount 0 uses every hardware thread, the calling thread always counts as one of them
+         */
+        explicit TileScheduler(uint32_t threadCount = 0, int tileSize = DEFAULT_TILE_SIZE);
+        ~TileScheduler();
+
+        TileScheduler(const TileScheduler&) = delete;
+        TileScheduler(TileScheduler&&) noexcept = delete;
+        TileScheduler& operator=(const TileScheduler&) = delete;
+        TileScheduler& operator=(TileScheduler&&) noexcept = delete;
+
+        /**
+         * \brief Calls renderTile once for every tile of a width x height frame, returns when all tiles are done \n
+         * renderTile runs concurrently on all threads, it must only write to pixels inside its tile \n
+         * Its workerIdx in [0, GetThreadCount()) names the calling thread, for scratch memory owned per worker
+         */
+        void Run(int width, int height, const std::function<void(const Tile&, uint32_t workerIdx)>& renderTile);
+
+        /**
+         * \brief Joins the current workers and starts threadCount - 1 new ones, 0 uses every hardware thread
+         */
+        void SetThreadCount(uint32_t threadCount);
+
+        /**
+         * \brief Rounded up to an even size, so the 2x2 pixel packets never straddle two tiles
+         */
+        void SetTileSize(int tileSize);
+
+        uint32_t GetThreadCount() const { return m_ThreadCount; }
+        int GetTileSize() const { return m_TileSize; }
+
+    private:
+        /**
+         * \brief Remaining part [begin, end) of one worker's run in m_Tiles, packed in 64 bits so both ends change with one CAS \n
+         * The owner pops from the front, thieves from the back
+         */
+        struct alignas(64) TileQueue
+        {
+            std::atomic<uint64_t> range {0};
+        };
+
+        std::vector<std::thread>     m_Workers {};
+        std::unique_ptr<TileQueue[]> m_Queues  {};
+        std::vector<Tile>            m_Tiles   {};
+
+        uint32_t m_ThreadCount {0};
+        int      m_TileSize    {DEFAULT_TILE_SIZE};
+        int      m_FrameWidth  {0};
+        int      m_FrameHeight {0};
+
+        const std::function<void(const Tile&, uint32_t)>* m_pRenderTile {nullptr};
+
+        std::mutex              m_Mutex          {};
+        std::condition_variable m_StartCondition {};
+        std::condition_variable m_DoneCondition  {};
+        uint64_t                m_Generation     {0};
+        uint32_t                m_BusyWorkers    {0};
+        bool                    m_IsStopping     {false};
+
+        void StartWorkers(uint32_t threadCount);
+        void StopWorkers();
+        void WorkerLoop(uint32_t workerIdx, uint64_t generation);
+
+        void BuildTiles(int width, int height);
+        void RenderTiles(uint32_t workerIdx);
+        bool PopTile(uint32_t workerIdx, uint32_t& tileIdx);
+        bool StealTile(uint32_t workerIdx, uint32_t& tileIdx);
+    };
+}
@@ -75,6 +75,13 @@ namespace dae
             return;
         }
 
+        if (m_FixedTimeStep > 0.0f)
+        {
+            m_ElapsedTime = m_FixedTimeStep;
+            m_TotalTime += m_FixedTimeStep;
+            return;
+        }
+
         const uint64_t currentTime = SDL_GetPerformanceCounter();
         m_CurrentTime = currentTime;
 
@@ -19,6 +19,12 @@ namespace dae
 
         void StartBenchmark(int numFrames = 10);
 
+        /**
+         * \brief Every Update advances the time by exactly this step instead of the measured time, 0 measures again \n
+         * Makes the animated scenes render the same frames on every run
+         */
+        void SetFixedTimeStep(float seconds) { m_FixedTimeStep = seconds; }
+
         void Reset();
         void Start();
         void Update();
@@ -46,6 +52,7 @@ namespace dae
         float m_SecondsPerCount   {0.0f};
         float m_ElapsedUpperBound {0.03f};
         float m_FPSTimer          {0.0f};
+        float m_FixedTimeStep     {0.0f};
 
         bool m_IsStopped              {true};
         bool m_ForceElapsedUpperBound {false};
@@ -4,7 +4,8 @@
 #include "DataTypes.h"
 #include "Macros.h"
 
-#include <fstream>
+#include <bit>
+#include <immintrin.h>
 
 namespace dae
 {
@@ -15,7 +16,10 @@ namespace dae
 
         inline float Remap(float a, float b, float t) { return (t - a) / (b - a); }
 
-        inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+        /**
+         * \brief Distance of the hit only, the hit attributes are left to the caller
+         */
+        inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, float& t)
         {
             // https://gamedev.stackexchange.com/questions/96459/fast-ray-sphere-collision-code
 #if SPHERE_INTERSECTION_ANALYTIC
@@ -33,15 +37,8 @@ namespace dae
             const float t0{(-B - std::sqrt(discriminant))};
             
             if (t0 < ray.min or t0 > ray.max) return false;
-            
-            if (not ignoreHitRecord)
-            {
-                hitRecord.didHit = true;
-                hitRecord.t = t0;
-                hitRecord.origin = ray.origin + ray.direction * hitRecord.t;
-                hitRecord.normal = (hitRecord.origin - sphere.origin) / sphere.radius;
-                hitRecord.materialIndex = sphere.materialIndex;
-            }
+
+            t = t0;
             return true;
 #else
             const Vector3 L{sphere.origin - ray.origin}; // vector from ray's origin to sphere's center
@@ -56,36 +53,54 @@ namespace dae
             float t0{tca - thc}; // distance from ray's origin to sphere surface
             //float t1{tca + thc}; // distance from ray's origin to sphere surface
             if (t0 < ray.min or t0 > ray.max) return false;
-            
+
+            t = t0;
+            return true;
+#endif
+        }
+
+        inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+        {
+            float t;
+            if (not HitTest_Sphere(sphere, ray, t)) return false;
+
             if (not ignoreHitRecord)
             {
                 hitRecord.didHit = true;
-                hitRecord.t = t0;
+                hitRecord.t = t;
                 hitRecord.origin = ray.origin + ray.direction * hitRecord.t;
                 hitRecord.normal = (hitRecord.origin - sphere.origin) / sphere.radius;
                 hitRecord.materialIndex = sphere.materialIndex;
             }
             return true;
-#endif
         }
 
         inline bool HitTest_Sphere(const Sphere& sphere, const Ray& ray)
         {
-            HitRecord temp{};
-            return HitTest_Sphere(sphere, ray, temp, true);
+            float t;
+            return HitTest_Sphere(sphere, ray, t);
         }
 #pragma endregion
 #pragma region Plane HitTest
         //PLANE HIT-TESTS
-        inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+        /**
+         * \brief Distance of the hit only, the hit attributes are left to the caller
+         */
+        inline bool HitTest_Plane(const Plane& plane, const Ray& ray, float& t)
         {
             const float denom{Vector3::Dot(plane.normal, ray.direction)};
             
             if (denom >= 0.0f) return false;
             
-            const float t{Vector3::Dot(plane.origin - ray.origin, plane.normal) / denom};
+            t = Vector3::Dot(plane.origin - ray.origin, plane.normal) / denom;
             
-            if (t < ray.min or t > ray.max) return false;
+            return t >= ray.min and t <= ray.max;
+        }
+
+        inline bool HitTest_Plane(const Plane& plane, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+        {
+            float t;
+            if (not HitTest_Plane(plane, ray, t)) return false;
             
             if (not ignoreHitRecord)
             {
@@ -100,8 +115,66 @@ namespace dae
 
         inline bool HitTest_Plane(const Plane& plane, const Ray& ray)
         {
-            HitRecord temp{};
-            return HitTest_Plane(plane, ray, temp, true);
+            float t;
+            return HitTest_Plane(plane, ray, t);
+        }
+#pragma endregion
+#pragma region Room HitTest
+        //ROOM HIT-TESTS
+        /**
+         * \brief Closest wall of the room, same t as HitTest_Plane of that wall: the dot products of an axis-aligned normal reduce to one component \n
+         * Only the wall ahead of the ray can face it on every axis, equal distances go to the lower plane index like the plane loop
+         * \param planeIdx index of the hit wall in the plane vector of the scene
+         */
+        inline bool HitTest_Room(const Room& room, const Ray& ray, float& t, uint32_t& planeIdx)
+        {
+            bool didHit{false};
+            for (int axis{0}; axis < 3; ++axis)
+            {
+                const float direction{ray.direction[axis]};
+                if (direction == 0.0f) continue;
+
+                const int side{direction > 0.0f ? 1 : 0};
+                const int wallIdx{room.planeIndices[axis][side]};
+                if (wallIdx < 0) continue;
+
+                const float wallT{(room.bounds[axis][side] - ray.origin[axis]) / direction};
+                if (wallT < ray.min or wallT > ray.max) continue;
+
+                if (not didHit or wallT < t or (wallT == t and static_cast<uint32_t>(wallIdx) < planeIdx))
+                {
+                    t = wallT;
+                    planeIdx = static_cast<uint32_t>(wallIdx);
+                    didHit = true;
+                }
+            }
+            return didHit;
+        }
+
+        /**
+         * \brief Whether point lies in front of every wall by more than margin
+         */
+        inline bool IsInsideRoom(const Room& room, const Vector3& point, float margin)
+        {
+            for (int axis{0}; axis < 3; ++axis)
+            {
+                if (room.planeIndices[axis][0] >= 0 and not (point[axis] - room.bounds[axis][0] > margin)) return false;
+                if (room.planeIndices[axis][1] >= 0 and not (room.bounds[axis][1] - point[axis] > margin)) return false;
+            }
+            return true;
+        }
+
+        /**
+         * \brief Any-hit test for shadow rays, a ray ending inside the room can't have crossed a wall before, the room being convex \n
+         * So rays towards a point light in the room skip the slab test, the margin covers the rounding of their end point
+         */
+        inline bool HitTest_Room(const Room& room, const Ray& ray, uint32_t& planeIdx)
+        {
+            constexpr float margin{0.001f};
+            if (IsInsideRoom(room, ray.origin + ray.direction * ray.max, margin)) return false;
+
+            float t;
+            return HitTest_Room(room, ray, t, planeIdx);
         }
 #pragma endregion
 #pragma region Triangle HitTest
@@ -232,12 +305,332 @@ namespace dae
             return tmax > 0 and tmax >= tmin;
         }
 
-        inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+        /**
+         * \brief Slab test against an axis aligned bounding box
+         * \param invDirection Component-wise reciprocal of the ray direction, computed once per ray
+         * \return Distance to the entry point, FLT_MAX if the box is missed or lies outside [ray.min, ray.max]
+         */
+        inline float SlabTest_AABB(const Vector3& minAABB, const Vector3& maxAABB, const Ray& ray, const Vector3& invDirection)
+        {
+            const float tx1{(minAABB.x - ray.origin.x) * invDirection.x};
+            const float tx2{(maxAABB.x - ray.origin.x) * invDirection.x};
+
+            float tmin{std::min(tx1, tx2)};
+            float tmax{std::max(tx1, tx2)};
+
+            const float ty1{(minAABB.y - ray.origin.y) * invDirection.y};
+            const float ty2{(maxAABB.y - ray.origin.y) * invDirection.y};
+
+            tmin = std::max(tmin, std::min(ty1, ty2));
+            tmax = std::min(tmax, std::max(ty1, ty2));
+
+            const float tz1{(minAABB.z - ray.origin.z) * invDirection.z};
+            const float tz2{(maxAABB.z - ray.origin.z) * invDirection.z};
+
+            tmin = std::max(tmin, std::min(tz1, tz2));
+            tmax = std::min(tmax, std::max(tz1, tz2));
+
+            if (tmax >= tmin and tmax > ray.min and tmin < ray.max) return tmin;
+            return FLT_MAX;
+        }
+
+        /**
+         * \brief Stack based BVH traversal, the nearest child is visited first
+         * \param ray Its max is shrunk by intersectLeaf on every hit, so farther nodes get culled
+         * \param intersectLeaf bool(uint32_t nodeIdx, Ray& ray), tests all primitives of the leaf, returns true on a hit closer than ray.max
+         * \param anyHit Stop at the first leaf that hits (shadow rays)
+         */
+        template <typename IntersectLeaf>
+        bool IntersectBVHLeaves(const BVH& bvh, Ray& ray, IntersectLeaf&& intersectLeaf, bool anyHit)
+        {
+            if (bvh.IsEmpty()) return false;
+
+            const Vector3 invDirection{1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+
+            const BVHNode* pNode{&bvh.nodes[0]};
+            if (SlabTest_AABB(pNode->minAABB, pNode->maxAABB, ray, invDirection) == FLT_MAX) return false;
+
+            const BVHNode* stack[BVH::maxDepth];
+            int stackPtr{0};
+
+            bool didHit{false};
+            while (true)
+            {
+                if (pNode->IsLeaf())
+                {
+                    if (intersectLeaf(static_cast<uint32_t>(pNode - bvh.nodes.data()), ray))
+                    {
+                        didHit = true;
+                        if (anyHit) return true;
+                    }
+                    if (stackPtr == 0) break;
+                    pNode = stack[--stackPtr];
+                    continue;
+                }
+
+                const BVHNode* pChild1{&bvh.nodes[pNode->leftFirst]};
+                const BVHNode* pChild2{&bvh.nodes[pNode->leftFirst + 1]};
+                float dist1{SlabTest_AABB(pChild1->minAABB, pChild1->maxAABB, ray, invDirection)};
+                float dist2{SlabTest_AABB(pChild2->minAABB, pChild2->maxAABB, ray, invDirection)};
+                if (dist1 > dist2)
+                {
+                    std::swap(dist1, dist2);
+                    std::swap(pChild1, pChild2);
+                }
+
+                if (dist1 == FLT_MAX)
+                {
+                    if (stackPtr == 0) break;
+                    pNode = stack[--stackPtr];
+                }
+                else
+                {
+                    pNode = pChild1;
+                    if (dist2 != FLT_MAX) stack[stackPtr++] = pChild2;
+                }
+            }
+            return didHit;
+        }
+
+        /**
+         * \brief IntersectBVHLeaves with one callback per primitive
+         * \param intersectPrimitive bool(uint32_t primIdx, Ray& ray), returns true on a hit closer than ray.max
+         */
+        template <typename IntersectPrimitive>
+        bool IntersectBVH(const BVH& bvh, Ray& ray, IntersectPrimitive&& intersectPrimitive, bool anyHit)
+        {
+            return IntersectBVHLeaves(bvh, ray, [&bvh, &intersectPrimitive, anyHit](uint32_t nodeIdx, Ray& r)
+            {
+                const BVHNode& leaf{bvh.nodes[nodeIdx]};
+
+                bool didHit{false};
+                for (uint32_t idx{leaf.leftFirst}; idx < leaf.leftFirst + leaf.primCount; ++idx)
+                {
+                    if (intersectPrimitive(bvh.primIndices[idx], r))
+                    {
+                        didHit = true;
+                        if (anyHit) return true;
+                    }
+                }
+                return didHit;
+            }, anyHit);
+        }
+
+        /**
+         * \brief Moller-Trumbore of one ray against the 8 triangles of a block, same operations as HitTest_MeshTriangle
+         * \return true if a triangle hits between ray.min and ray.max, t and triangleIdx belong to the closest one
+         */
+        inline bool HitTest_TriangleBlock(const TriangleBlock& block, TriangleCullMode cullMode, const Ray& ray,
+                                          float& t, uint32_t& triangleIdx)
+        {
+            const __m256 dx{_mm256_set1_ps(ray.direction.x)};
+            const __m256 dy{_mm256_set1_ps(ray.direction.y)};
+            const __m256 dz{_mm256_set1_ps(ray.direction.z)};
+            const __m256 zero{_mm256_setzero_ps()};
+            const __m256 one{_mm256_set1_ps(1.0f)};
+
+            const __m256 e1x{_mm256_load_ps(block.e1x)}, e1y{_mm256_load_ps(block.e1y)}, e1z{_mm256_load_ps(block.e1z)};
+            const __m256 e2x{_mm256_load_ps(block.e2x)}, e2y{_mm256_load_ps(block.e2y)}, e2z{_mm256_load_ps(block.e2z)};
+
+            //P = d x e2, det = e1 . P
+            const __m256 Px{_mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y))};
+            const __m256 Py{_mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z))};
+            const __m256 Pz{_mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x))};
+            const __m256 det{
+                _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, Px), _mm256_mul_ps(e1y, Py)), _mm256_mul_ps(e1z, Pz))
+            };
+
+            const __m256 absDet{_mm256_andnot_ps(_mm256_set1_ps(-0.0f), det)};
+            __m256 mask{_mm256_cmp_ps(absDet, _mm256_set1_ps(FLT_EPSILON), _CMP_GE_OQ)};
+            if (cullMode == TriangleCullMode::BackFaceCulling)
+            {
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(det, zero, _CMP_GE_OQ));
+            }
+            else if (cullMode == TriangleCullMode::FrontFaceCulling)
+            {
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(det, zero, _CMP_LE_OQ));
+            }
+            if (_mm256_movemask_ps(mask) == 0) return false;
+
+            const __m256 invDet{_mm256_div_ps(one, det)};
+            const __m256 Tx{_mm256_sub_ps(_mm256_set1_ps(ray.origin.x), _mm256_load_ps(block.v0x))};
+            const __m256 Ty{_mm256_sub_ps(_mm256_set1_ps(ray.origin.y), _mm256_load_ps(block.v0y))};
+            const __m256 Tz{_mm256_sub_ps(_mm256_set1_ps(ray.origin.z), _mm256_load_ps(block.v0z))};
+            const __m256 u{
+                _mm256_mul_ps(
+                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Tx, Px), _mm256_mul_ps(Ty, Py)), _mm256_mul_ps(Tz, Pz)),
+                    invDet)
+            };
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+            if (_mm256_movemask_ps(mask) == 0) return false;
+
+            //Q = T x e1
+            const __m256 Qx{_mm256_sub_ps(_mm256_mul_ps(Ty, e1z), _mm256_mul_ps(Tz, e1y))};
+            const __m256 Qy{_mm256_sub_ps(_mm256_mul_ps(Tz, e1x), _mm256_mul_ps(Tx, e1z))};
+            const __m256 Qz{_mm256_sub_ps(_mm256_mul_ps(Tx, e1y), _mm256_mul_ps(Ty, e1x))};
+            const __m256 v{
+                _mm256_mul_ps(
+                    invDet,
+                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, Qx), _mm256_mul_ps(dy, Qy)), _mm256_mul_ps(dz, Qz)))
+            };
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+            if (_mm256_movemask_ps(mask) == 0) return false;
+
+            const __m256 tLanes{
+                _mm256_mul_ps(
+                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, Qx), _mm256_mul_ps(e2y, Qy)), _mm256_mul_ps(e2z, Qz)),
+                    invDet)
+            };
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(tLanes, _mm256_set1_ps(ray.min), _CMP_GE_OQ));
+            mask = _mm256_and_ps(mask, _mm256_cmp_ps(tLanes, _mm256_set1_ps(ray.max), _CMP_LE_OQ));
+
+            int hitMask{_mm256_movemask_ps(mask)};
+            if (hitMask == 0) return false;
+
+            alignas(32) float ts[TriangleBlock::size];
+            _mm256_store_ps(ts, tLanes);
+
+            int closestLane{std::countr_zero(static_cast<unsigned>(hitMask))};
+            for (hitMask &= hitMask - 1; hitMask != 0; hitMask &= hitMask - 1)
+            {
+                const int lane{std::countr_zero(static_cast<unsigned>(hitMask))};
+                if (ts[lane] <= ts[closestLane]) closestLane = lane;
+            }
+
+            t = ts[closestLane];
+            triangleIdx = block.triangleIndices[closestLane];
+            return true;
+        }
+
+        /**
+         * \brief Tests every block of a mesh BVH leaf, shrinks ray.max to the closest hit
+         */
+        inline bool HitTest_TriangleLeaf(const TriangleMesh& mesh, uint32_t nodeIdx, Ray& ray, uint32_t& closestTriangleIdx)
+        {
+            const BVHNode& leaf{mesh.bvh.nodes[nodeIdx]};
+            const uint32_t firstBlock{mesh.leafFirstBlock[nodeIdx]};
+            const uint32_t blockCount{(leaf.primCount + TriangleBlock::size - 1) / TriangleBlock::size};
+
+            bool didHit{false};
+            for (uint32_t blockIdx{firstBlock}; blockIdx < firstBlock + blockCount; ++blockIdx)
+            {
+                float t;
+                if (HitTest_TriangleBlock(mesh.triangleBlocks[blockIdx], mesh.cullMode, ray, t, closestTriangleIdx))
+                {
+                    ray.max = t;
+                    didHit = true;
+                }
+            }
+            return didHit;
+        }
+
+        /**
+         * \brief Moller-Trumbore against a single triangle of the mesh, using the given vertices \n
+         * (transformedPositions for world space meshes, positions for instanced meshes)
+         * \return true if hit between ray.min and ray.max, t holds the distance
+         */
+        inline bool HitTest_MeshTriangle(const TriangleMesh& mesh, const std::vector<Vector3>& vertices,
+                                         uint32_t triangleIdx, const Ray& ray, float& t)
+        {
+            const size_t idx{triangleIdx * 3ull};
+            const Vector3& v0{vertices[mesh.indices[idx]]};
+            const Vector3& v1{vertices[mesh.indices[idx + 1]]};
+            const Vector3& v2{vertices[mesh.indices[idx + 2]]};
+
+            const Vector3 e1{v1 - v0};
+            const Vector3 e2{v2 - v0};
+
+            const Vector3 P{Vector3::Cross(ray.direction, e2)};
+            const float det{Vector3::Dot(e1, P)};
+
+            if (mesh.cullMode == TriangleCullMode::BackFaceCulling)
+            {
+                if (det < 0.0f) return false;
+            }
+            else if (mesh.cullMode == TriangleCullMode::FrontFaceCulling)
+            {
+                if (det > 0.0f) return false;
+            }
+
+            if (AreEqual(det, 0.0f)) return false;
+
+            const float invDet{1.0f / det};
+            const Vector3 T{ray.origin - v0};
+            const float u{Vector3::Dot(T, P) * invDet};
+
+            if (u < 0.0f or u > 1.0f) return false;
+
+            const Vector3 Q{Vector3::Cross(T, e1)};
+            const float v{invDet * Vector3::Dot(ray.direction, Q)};
+
+            if (v < 0.0f or u + v > 1.0f) return false;
+
+            t = Vector3::Dot(e2, Q) * invDet;
+
+            return t >= ray.min and t <= ray.max;
+        }
+
+        /**
+         * \brief Closest triangle of the mesh, only its distance and index, the hit attributes are left to the caller
+         * \param anyHit stop at the first triangle that is hit (shadow rays)
+         */
+        inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, float& t, uint32_t& triangleIdx, bool anyHit = false)
         {
 #if SLAB_TEST
             if (not SlabTest_TriangleMesh(mesh, ray)) return false;
 #endif
-#if TRIANGLE_MESH_WITH_FUNCTION_CALL
+#if BVH_MESH
+            Ray meshRay{ray};
+            uint32_t closestTriangleIdx{0};
+#if TRIANGLE_BLOCKS
+            const bool didHit{
+                IntersectBVHLeaves(mesh.bvh, meshRay, [&mesh, &closestTriangleIdx](uint32_t nodeIdx, Ray& r)
+                {
+                    return HitTest_TriangleLeaf(mesh, nodeIdx, r, closestTriangleIdx);
+                }, anyHit)
+            };
+#else
+            const bool didHit{
+                IntersectBVH(mesh.bvh, meshRay, [&mesh, &closestTriangleIdx](uint32_t idx, Ray& r)
+                {
+                    float triangleT;
+                    if (not HitTest_MeshTriangle(mesh, mesh.transformedPositions, idx, r, triangleT)) return false;
+                    r.max = triangleT;
+                    closestTriangleIdx = idx;
+                    return true;
+                }, anyHit)
+            };
+#endif
+            if (not didHit) return false;
+
+            t = meshRay.max;
+            triangleIdx = closestTriangleIdx;
+            return true;
+#else
+            bool didHit{false};
+            t = FLT_MAX;
+            const uint32_t triangleCount{static_cast<uint32_t>(mesh.indices.size() / 3)};
+            for (uint32_t idx{0}; idx < triangleCount; ++idx)
+            {
+                float triangleT;
+                if (not HitTest_MeshTriangle(mesh, mesh.transformedPositions, idx, ray, triangleT)) continue;
+                if (triangleT < t)
+                {
+                    t = triangleT;
+                    triangleIdx = idx;
+                    didHit = true;
+                    if (anyHit) return true;
+                }
+            }
+            return didHit;
+#endif
+        }
+
+        inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+        {
+#if TRIANGLE_MESH_WITH_FUNCTION_CALL and not BVH_MESH
             HitRecord hit;
             for (size_t idx{0}, normIdx{0}; idx < mesh.indices.size(); idx += 3, ++normIdx)
             {
@@ -263,69 +656,101 @@ namespace dae
             }
             return hitRecord.didHit;
 #else
-            HitRecord tempHit{};
+            float t;
+            uint32_t triangleIdx;
+            if (not HitTest_TriangleMesh(mesh, ray, t, triangleIdx, ignoreHitRecord)) return false;
 
-            for (size_t idx{0}, normIdx{0}; idx < mesh.indices.size(); idx += 3, normIdx++)
+            hitRecord.didHit = true;
+            if (not ignoreHitRecord)
             {
-                const Vector3& v0{mesh.transformedPositions[mesh.indices[idx]]};
-                const Vector3& v1{mesh.transformedPositions[mesh.indices[idx + 1]]};
-                const Vector3& v2{mesh.transformedPositions[mesh.indices[idx + 2]]};
+                //Only the closest triangle gets its hit attributes computed
+                hitRecord.t = t;
+                hitRecord.origin = ray.origin + ray.direction * hitRecord.t;
+                hitRecord.normal = mesh.transformedNormals[triangleIdx];
+                hitRecord.materialIndex = mesh.materialIndex;
+            }
+            return true;
+#endif
+        }
 
-                const Vector3 e1{v1 - v0};
-                const Vector3 e2{v2 - v0};
+        inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+        {
+            float t;
+            uint32_t triangleIdx;
+            return HitTest_TriangleMesh(mesh, ray, t, triangleIdx, true);
+        }
 
-                const Vector3 P{Vector3::Cross(ray.direction, e2)};
-                const float det{Vector3::Dot(e1, P)};
+        /**
+         * \brief Moves the ray into the object space of the shared mesh of the instance \n
+         * The direction is not normalized, that way t along the object space ray equals t along the world space ray
+         */
+        inline Ray TransformRay(const MeshInstance& instance, const Ray& ray)
+        {
+            Ray objectRay{ray};
+            objectRay.origin = instance.inverseTransform.TransformPoint(ray.origin);
+            objectRay.direction = instance.inverseTransform.TransformVector(ray.direction);
+            return objectRay;
+        }
+
+        /**
+         * \brief The ray is moved into the object space of the shared mesh instead of transforming the vertices, see TransformRay
+         * \param anyHit stop at the first triangle that is hit (shadow rays)
+         */
+        inline bool HitTest_MeshInstance(const MeshInstance& instance, const TriangleMesh& mesh, const Ray& ray,
+                                         float& t, uint32_t& triangleIdx, bool anyHit = false)
+        {
+            Ray objectRay{TransformRay(instance, ray)};
 
-                if (mesh.cullMode == TriangleCullMode::BackFaceCulling)
+            uint32_t closestTriangleIdx{0};
+#if TRIANGLE_BLOCKS
+            const bool didHit{
+                IntersectBVHLeaves(mesh.bvh, objectRay, [&mesh, &closestTriangleIdx](uint32_t nodeIdx, Ray& r)
                 {
-                    if (det < 0.0f) continue;
-                }
-                else if (mesh.cullMode == TriangleCullMode::FrontFaceCulling)
+                    return HitTest_TriangleLeaf(mesh, nodeIdx, r, closestTriangleIdx);
+                }, anyHit)
+            };
+#else
+            const bool didHit{
+                IntersectBVH(mesh.bvh, objectRay, [&mesh, &closestTriangleIdx](uint32_t idx, Ray& r)
                 {
-                    if (det > 0.0f) continue;
-                }
-
-                if (AreEqual(det, 0.0f)) continue;
-
-                const float invDet{1.0f / det};
-                const Vector3 T{ray.origin - v0};
-                const float u{Vector3::Dot(T, P) * invDet};
-
-                if (u < 0.0f or u > 1.0f) continue;
-
-                const Vector3 Q{Vector3::Cross(T, e1)};
-                const float v{invDet * Vector3::Dot(ray.direction, Q)};
-
-                if (v < 0.0f or u + v > 1.0f) continue;
-
-                const float t{Vector3::Dot(e2, Q) * invDet};
+                    float triangleT;
+                    if (not HitTest_MeshTriangle(mesh, mesh.positions, idx, r, triangleT)) return false;
+                    r.max = triangleT;
+                    closestTriangleIdx = idx;
+                    return true;
+                }, anyHit)
+            };
+#endif
+            if (not didHit) return false;
 
-                if (t < ray.min or t > ray.max) continue;
+            t = objectRay.max;
+            triangleIdx = closestTriangleIdx;
+            return true;
+        }
 
-                if (t < tempHit.t)
-                {
-                    tempHit.t = t;
-                    hitRecord.didHit = true;
+        inline bool HitTest_MeshInstance(const MeshInstance& instance, const TriangleMesh& mesh, const Ray& ray,
+                                         HitRecord& hitRecord, bool ignoreHitRecord = false)
+        {
+            float t;
+            uint32_t triangleIdx;
+            if (not HitTest_MeshInstance(instance, mesh, ray, t, triangleIdx, ignoreHitRecord)) return false;
 
-                    if (not ignoreHitRecord)
-                    {
-                        hitRecord.t = t;
-                        hitRecord.origin = ray.origin + ray.direction * t;
-                        // hitRecord.normal = Vector3::Cross(e1, e2).Normalized();
-                        hitRecord.normal = mesh.transformedNormals[normIdx];
-                        hitRecord.materialIndex = mesh.materialIndex;
-                    }
-                }
+            hitRecord.didHit = true;
+            if (not ignoreHitRecord)
+            {
+                hitRecord.t = t;
+                hitRecord.origin = ray.origin + ray.direction * hitRecord.t;
+                hitRecord.normal = instance.TransformNormal(mesh.normals[triangleIdx]);
+                hitRecord.materialIndex = instance.materialIndex;
             }
-            return hitRecord.didHit;
-#endif
+            return true;
         }
 
-        inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+        inline bool HitTest_MeshInstance(const MeshInstance& instance, const TriangleMesh& mesh, const Ray& ray)
         {
-            HitRecord temp{};
-            return HitTest_TriangleMesh(mesh, ray, temp, true);
+            float t;
+            uint32_t triangleIdx;
+            return HitTest_MeshInstance(instance, mesh, ray, t, triangleIdx, true);
         }
 
 #pragma endregion
@@ -354,80 +779,4 @@ namespace dae
             return radiance;
         }
     }
-
-    namespace Utils
-    {
-        //Just parses vertices and indices
-#pragma warning(push)
-#pragma warning(disable : 4505) //Warning unreferenced local function
-        static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions,
-                             std::vector<Vector3>& normals, std::vector<int>& indices)
-        {
-            std::ifstream file(filename);
-            if (!file)
-                return false;
-
-            std::string sCommand;
-            // start a while iteration ending when the end of file is reached (ios::eof)
-            while (!file.eof())
-            {
-                //read the first word of the string, use the >> operator (istream::operator>>) 
-                file >> sCommand;
-                //use conditional statements to process the different commands	
-                if (sCommand == "#")
-                {
-                    // Ignore Comment
-                }
-                else if (sCommand == "v")
-                {
-                    //Vertex
-                    float x, y, z;
-                    file >> x >> y >> z;
-                    positions.push_back({x, y, z});
-                }
-                else if (sCommand == "f")
-                {
-                    float i0, i1, i2;
-                    file >> i0 >> i1 >> i2;
-
-                    indices.push_back((int)i0 - 1);
-                    indices.push_back((int)i1 - 1);
-                    indices.push_back((int)i2 - 1);
-                }
-                //read till end of line and ignore all remaining chars
-                file.ignore(1000, '\n');
-
-                if (file.eof())
-                    break;
-            }
-
-            //Precompute normals
-            for (uint64_t index = 0; index < indices.size(); index += 3)
-            {
-                uint32_t i0 = indices[index];
-                uint32_t i1 = indices[index + 1];
-                uint32_t i2 = indices[index + 2];
-
-                Vector3 edgeV0V1 = positions[i1] - positions[i0];
-                Vector3 edgeV0V2 = positions[i2] - positions[i0];
-                Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
-
-                if (isnan(normal.x))
-                {
-                    int k = 0;
-                }
-
-                normal.Normalize();
-                if (isnan(normal.x))
-                {
-                    int k = 0;
-                }
-
-                normals.push_back(normal);
-            }
-
-            return true;
-        }
-#pragma warning(pop)
-    }
 }
@@ -1,5 +1,11 @@
 #pragma once
 
+#include "MathHelpers.h"
+#include "Macros.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <iostream>
 
 
@@ -7,60 +13,223 @@ namespace dae
 {
     struct Vector4;
 
+    /**
+     * \brief Header-only so every operator inlines into the hit tests \n
+     * Kept at 12 bytes on purpose: vertex buffers, BVH nodes and triangle blocks rely on the packed layout
+     */
     struct Vector3
     {
         float x {0.0f};
         float y {0.0f};
         float z {0.0f};
 
-        Vector3() = default;
-        Vector3(float _x, float _y, float _z);
-        Vector3(const Vector3& from, const Vector3& to);
-        Vector3(const Vector4& v);
+        constexpr Vector3() = default;
+        constexpr Vector3(float _x, float _y, float _z) : x(_x), y(_y), z(_z)
+        {
+        }
+
+        constexpr Vector3(const Vector3& from, const Vector3& to) : x(to.x - from.x), y(to.y - from.y), z(to.z - from.z)
+        {
+        }
+
+        constexpr Vector3(const Vector4& v);
+
+        float Magnitude() const
+        {
+#if QRSQRT
+            const float magnitudeSq {x * x + y * y + z * z};
+            return 1.0f / Q_rsqrt(magnitudeSq);
+#else
+            return std::sqrt(x * x + y * y + z * z);
+#endif
+        }
+
+        constexpr float SqrMagnitude() const
+        {
+            return x * x + y * y + z * z;
+        }
+
+        float Normalize()
+        {
+#if QRSQRT
+            const float m {Q_rsqrt(x * x + y * y + z * z)};
+            x *= m;
+            y *= m;
+            z *= m;
+            return m;
+#else
+            const float m{Magnitude()};
+            x /= m;
+            y /= m;
+            z /= m;
+            return m;
+#endif
+        }
+
+        Vector3 Normalized() const
+        {
+#if QRSQRT
+            const float m {Q_rsqrt(x * x + y * y + z * z)};
+            return {x * m, y * m, z * m};
+#else
+            const float m{Magnitude()};
+            return {x / m, y / m, z / m};
+#endif
+        }
 
-        float Magnitude() const;
-        float SqrMagnitude() const;
-        float Normalize();
-        Vector3 Normalized() const;
+        static constexpr float Dot(const Vector3& v1, const Vector3& v2)
+        {
+            return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+        }
 
-        static float Dot(const Vector3& v1, const Vector3& v2);
-        static Vector3 Cross(const Vector3& v1, const Vector3& v2);
-        static Vector3 Project(const Vector3& v1, const Vector3& v2);
-        static Vector3 Reject(const Vector3& v1, const Vector3& v2);
-        static Vector3 Reflect(const Vector3& v1, const Vector3& v2);
-        static Vector3 Lico(float f1, const Vector3& v1, float f2, const Vector3& v2, float f3, const Vector3& v3);
+        static constexpr Vector3 Cross(const Vector3& v1, const Vector3& v2)
+        {
+            return {
+                v1.y * v2.z - v1.z * v2.y,
+                v1.z * v2.x - v1.x * v2.z,
+                v1.x * v2.y - v1.y * v2.x
+            };
+        }
 
-        static Vector3 Max(const Vector3& v1, const Vector3& v2);
-        static Vector3 Min(const Vector3& v1, const Vector3& v2);
+        static constexpr Vector3 Project(const Vector3& v1, const Vector3& v2)
+        {
+            return (v2 * (Dot(v1, v2) / Dot(v2, v2)));
+        }
 
-        Vector4 ToPoint4() const;
-        Vector4 ToVector4() const;
+        static constexpr Vector3 Reject(const Vector3& v1, const Vector3& v2)
+        {
+            return (v1 - v2 * (Dot(v1, v2) / Dot(v2, v2)));
+        }
 
+        static constexpr Vector3 Reflect(const Vector3& v1, const Vector3& v2)
+        {
+            return v1 - v2 * (2.f * Dot(v1, v2));
+        }
+
+        // implementation of barycentric coordinates
+        static constexpr Vector3 Lico(float f1, const Vector3& v1, float f2, const Vector3& v2, float f3, const Vector3& v3)
+        {
+            return {
+                f1 * v1.x + f2 * v2.x + f3 * v3.x,
+                f1 * v1.y + f2 * v2.y + f3 * v3.y,
+                f1 * v1.z + f2 * v2.z + f3 * v3.z
+            };
+        }
+
+        static constexpr Vector3 Max(const Vector3& v1, const Vector3& v2)
+        {
+            return {std::max(v1.x, v2.x), std::max(v1.y, v2.y), std::max(v1.z, v2.z)};
+        }
+
+        static constexpr Vector3 Min(const Vector3& v1, const Vector3& v2)
+        {
+            return {std::min(v1.x, v2.x), std::min(v1.y, v2.y), std::min(v1.z, v2.z)};
+        }
+
+        constexpr Vector4 ToPoint4() const;
+        constexpr Vector4 ToVector4() const;
+
+#pragma region Operator Overloads
         //Member Operators
-        Vector3 operator*(float scale) const;
-        Vector3 operator/(float scale) const;
-        Vector3 operator+(const Vector3& v) const;
-        Vector3 operator-(const Vector3& v) const;
-        Vector3 operator-() const;
-        //Vector3& operator-();
-        Vector3& operator+=(const Vector3& v);
-        Vector3& operator-=(const Vector3& v);
-        Vector3& operator/=(float scale);
-        Vector3& operator*=(float scale);
-        float& operator[](int index);
-        float operator[](int index) const;
+        constexpr Vector3 operator*(float scale) const
+        {
+            return {x * scale, y * scale, z * scale};
+        }
+
+        constexpr Vector3 operator/(float scale) const
+        {
+            return {x / scale, y / scale, z / scale};
+        }
+
+        constexpr Vector3 operator+(const Vector3& v) const
+        {
+            return {x + v.x, y + v.y, z + v.z};
+        }
+
+        constexpr Vector3 operator-(const Vector3& v) const
+        {
+            return {x - v.x, y - v.y, z - v.z};
+        }
+
+        constexpr Vector3 operator-() const
+        {
+            return {-x, -y, -z};
+        }
+
+        constexpr Vector3& operator+=(const Vector3& v)
+        {
+            x += v.x;
+            y += v.y;
+            z += v.z;
+            return *this;
+        }
+
+        constexpr Vector3& operator-=(const Vector3& v)
+        {
+            x -= v.x;
+            y -= v.y;
+            z -= v.z;
+            return *this;
+        }
+
+        constexpr Vector3& operator/=(float scale)
+        {
+            x /= scale;
+            y /= scale;
+            z /= scale;
+            return *this;
+        }
+
+        constexpr Vector3& operator*=(float scale)
+        {
+            x *= scale;
+            y *= scale;
+            z *= scale;
+            return *this;
+        }
+
+        constexpr float& operator[](int index)
+        {
+            assert(index <= 2 && index >= 0);
+
+            if (index == 0) return x;
+            if (index == 1) return y;
+            return z;
+        }
+
+        constexpr float operator[](int index) const
+        {
+            assert(index <= 2 && index >= 0);
+
+            if (index == 0) return x;
+            if (index == 1) return y;
+            return z;
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const Vector3& v)
+        {
+            os << '[' << v.x << ", " << v.y << ", " << v.z << "]";
+            return os;
+        }
+#pragma endregion
 
         static const Vector3 UnitX;
         static const Vector3 UnitY;
         static const Vector3 UnitZ;
         static const Vector3 Zero;
-
-        friend std::ostream& operator<<(std::ostream& os, const Vector3& v);
     };
 
+    inline constexpr Vector3 Vector3::UnitX {1, 0, 0};
+    inline constexpr Vector3 Vector3::UnitY {0, 1, 0};
+    inline constexpr Vector3 Vector3::UnitZ {0, 0, 1};
+    inline constexpr Vector3 Vector3::Zero  {0, 0, 0};
+
     //Global Operators
-    inline Vector3 operator*(float scale, const Vector3& v)
+    constexpr Vector3 operator*(float scale, const Vector3& v)
     {
         return {v.x * scale, v.y * scale, v.z * scale};
     }
 }
+
+//The Vector4 conversions of Vector3 are defined there, every user of Vector3 gets them
+#include "Vector4.h"
@@ -1,37 +1,166 @@
 #pragma once
+
+#include "Vector3.h"
+#include "MathHelpers.h"
+#include "Macros.h"
+
+#include <cassert>
+#include <cmath>
 #include <ostream>
 
+#if SIMD_MATH
+#include <immintrin.h>
+#endif
+
 namespace dae
 {
-    struct Vector3;
-
-    struct Vector4
+    /**
+     * \brief 16 byte aligned, so a Vector4 is loaded into one SSE register with a single aligned load
+     */
+    struct alignas(16) Vector4
     {
         float x {0.0f};
         float y {0.0f};
         float z {0.0f};
         float w {0.0f};
 
-        Vector4() = default;
-        Vector4(float _x, float _y, float _z, float _w);
-        Vector4(const Vector3& v, float _w);
+        constexpr Vector4() = default;
+        constexpr Vector4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w)
+        {
+        }
+
+        constexpr Vector4(const Vector3& v, float _w) : x(v.x), y(v.y), z(v.z), w(_w)
+        {
+        }
+
+        float Magnitude() const
+        {
+#if QRSQRT
+            const float magnitudeSq {x * x + y * y + z * z + w * w};
+            return 1.0f / Q_rsqrt(magnitudeSq);
+#else
+            return std::sqrt(x * x + y * y + z * z + w * w);
+#endif
+        }
 
-        float Magnitude() const;
-        float SqrMagnitude() const;
-        float Normalize();
-        Vector4 Normalized() const;
+        constexpr float SqrMagnitude() const
+        {
+            return x * x + y * y + z * z + w * w;
+        }
 
-        static float Dot(const Vector4& v1, const Vector4& v2);
+        float Normalize()
+        {
+#if QRSQRT
+            const float m {Q_rsqrt(x * x + y * y + z * z + w * w)};
+            x *= m;
+            y *= m;
+            z *= m;
+            w *= m;
+            return m;
+#else
+            const float m{Magnitude()};
+            x /= m;
+            y /= m;
+            z /= m;
+            w /= m;
+            return m;
+#endif
+        }
 
+        Vector4 Normalized() const
+        {
+#if QRSQRT
+            const float m {Q_rsqrt(x * x + y * y + z * z + w * w)};
+            return {x * m, y * m, z * m, w * m};
+#else
+            const float m{Magnitude()};
+            return {x / m, y / m, z / m, w / m};
+#endif
+        }
+
+        static constexpr float Dot(const Vector4& v1, const Vector4& v2)
+        {
+            return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
+        }
+
+#if SIMD_MATH
+        __m128 Load() const
+        {
+            return _mm_load_ps(&x);
+        }
+
+        void Store(__m128 v)
+        {
+            _mm_store_ps(&x, v);
+        }
+#endif
+
+#pragma region Operator Overloads
         // operator overloading
-        Vector4 operator*(float scale) const;
-        Vector4 operator+(const Vector4& v) const;
-        Vector4 operator-(const Vector4& v) const;
-        Vector4& operator+=(const Vector4& v);
-        float& operator[](int index);
-        float operator[](int index) const;
-
-    public:
-        friend std::ostream& operator<<(std::ostream& os, const Vector4& v);
+        constexpr Vector4 operator*(float scale) const
+        {
+            return {x * scale, y * scale, z * scale, w * scale};
+        }
+
+        constexpr Vector4 operator+(const Vector4& v) const
+        {
+            return {x + v.x, y + v.y, z + v.z, w + v.w};
+        }
+
+        constexpr Vector4 operator-(const Vector4& v) const
+        {
+            return {x - v.x, y - v.y, z - v.z, w - v.w};
+        }
+
+        constexpr Vector4& operator+=(const Vector4& v)
+        {
+            x += v.x;
+            y += v.y;
+            z += v.z;
+            w += v.w;
+            return *this;
+        }
+
+        constexpr float& operator[](int index)
+        {
+            assert(index <= 3 && index >= 0);
+
+            if (index == 0)return x;
+            if (index == 1)return y;
+            if (index == 2)return z;
+            return w;
+        }
+
+        constexpr float operator[](int index) const
+        {
+            assert(index <= 3 && index >= 0);
+
+            if (index == 0)return x;
+            if (index == 1)return y;
+            if (index == 2)return z;
+            return w;
+        }
+#pragma endregion
+
+        friend std::ostream& operator<<(std::ostream& os, const Vector4& v)
+        {
+            return os << '[' << v.x << ", " << v.y << ", " << v.z << ", " << v.w << ']';
+        }
     };
+
+#pragma region Vector3 Conversions
+    constexpr Vector3::Vector3(const Vector4& v) : x(v.x), y(v.y), z(v.z)
+    {
+    }
+
+    constexpr Vector4 Vector3::ToPoint4() const
+    {
+        return {x, y, z, 1};
+    }
+
+    constexpr Vector4 Vector3::ToVector4() const
+    {
+        return {x, y, z, 0};
+    }
+#pragma endregion
 }
@@ -5,12 +5,23 @@
 #undef main
 
 //Standard includes
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <random>
+#include <string>
+#include <vector>
 
 //Project includes
 #include "Timer.h"
+#include "BRDFs.h"
+#include "Benchmark.h"
+#include "ImageWriter.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "TileScheduler.h"
 #include "Vector3.h"
 #include "Macros.h"
 
@@ -41,14 +52,491 @@ void DoVectorTests()
     std::cout << crossResult << '\n';
 }
 
+/**
+ * \brief Runs the wide BRDFs at every width (float, Float4, Float8) on random inputs and compares every lane with the scalar BRDFs \n
+ * Without fused multiply-adds the direct ports are exact, 1e-4 leaves room for a compiler that fuses scalar and vector code differently \n
+ * FastPow must stay within its 2e-5 of std::pow, Phong (FastPow against std::powf) within 1e-4, all errors are relative
+ * \return true if every BRDF stays within its tolerance
+ */
+bool DoBRDFTests()
+{
+    constexpr int sampleCount{1024};
+    std::mt19937 generator{5489};
+    std::uniform_real_distribution<float> signedDistribution{-1.0f, 1.0f};
+    std::uniform_real_distribution<float> unitDistribution{0.0f, 1.0f};
+    std::uniform_real_distribution<float> exponentDistribution{1.0f, 128.0f};
+
+    //Directions on the side of the normal, the shading stage only sees samples that face the light and the camera
+    const auto getDirection{[&](const Vector3& normal)
+    {
+        Vector3 direction{};
+        do
+        {
+            direction = {signedDistribution(generator), signedDistribution(generator), signedDistribution(generator)};
+        }
+        while (direction.SqrMagnitude() < 0.01f or direction.SqrMagnitude() > 1.0f);
+        direction.Normalize();
+        return Vector3::Dot(direction, normal) < 0.0f ? -direction : direction;
+    }};
+
+    std::vector<float> nx(sampleCount), ny(sampleCount), nz(sampleCount);
+    std::vector<float> lx(sampleCount), ly(sampleCount), lz(sampleCount);
+    std::vector<float> vx(sampleCount), vy(sampleCount), vz(sampleCount);
+    std::vector<float> roughness(sampleCount), exponent(sampleCount), ks(sampleCount), f0(sampleCount), cd(sampleCount);
+    for (int idx{0}; idx < sampleCount; ++idx)
+    {
+        const Vector3 n{getDirection(Vector3::UnitY)};
+        const Vector3 l{getDirection(n)};
+        const Vector3 v{getDirection(n)};
+        nx[idx] = n.x;
+        ny[idx] = n.y;
+        nz[idx] = n.z;
+        lx[idx] = l.x;
+        ly[idx] = l.y;
+        lz[idx] = l.z;
+        vx[idx] = v.x;
+        vy[idx] = v.y;
+        vz[idx] = v.z;
+        roughness[idx] = 0.05f + 0.95f * unitDistribution(generator);
+        exponent[idx] = exponentDistribution(generator);
+        ks[idx] = unitDistribution(generator);
+        f0[idx] = unitDistribution(generator);
+        cd[idx] = unitDistribution(generator);
+    }
+
+    //Relative error, small references are compared absolutely
+    const auto getError{[](float value, float reference)
+    {
+        return std::abs(value - reference) / std::max(std::abs(reference), 1e-6f);
+    }};
+
+    bool isPassed{true};
+    const auto testWidth{[&]<typename FloatN>(const char* widthName)
+    {
+        constexpr int width{GetWidth<FloatN>()};
+        float maxErrorGGX{0.0f}, maxErrorSmith{0.0f}, maxErrorSchlick{0.0f}, maxErrorLambert{0.0f}, maxErrorPhong{0.0f}, maxErrorPow{0.0f};
+
+        for (int idx{0}; idx < sampleCount; idx += width)
+        {
+            const Vector3N<FloatN> n{Vector3N<FloatN>::Load(&nx[idx], &ny[idx], &nz[idx])};
+            const Vector3N<FloatN> l{Vector3N<FloatN>::Load(&lx[idx], &ly[idx], &lz[idx])};
+            const Vector3N<FloatN> v{Vector3N<FloatN>::Load(&vx[idx], &vy[idx], &vz[idx])};
+            const FloatN laneRoughness{Load<FloatN>(&roughness[idx])};
+            const FloatN laneF0{Load<FloatN>(&f0[idx])};
+            const FloatN laneCd{Load<FloatN>(&cd[idx])};
+            const Vector3N<FloatN> h{(v + l) / (v + l).Magnitude()};
+
+            float ggx[width], smith[width], schlick[width], lambert[width], phong[width], fastPow[width];
+            Store(BRDF::NormalDistribution_GGX(n, h, laneRoughness), ggx);
+            Store(BRDF::GeometryFunction_Smith(n, v, l, laneRoughness), smith);
+            Store(BRDF::FresnelFunction_Schlick(h, v, ColorRGBN<FloatN>{laneF0, laneF0, laneF0}).r, schlick);
+            Store(BRDF::Lambert(laneF0, ColorRGBN<FloatN>{laneCd, laneCd, laneCd}).g, lambert);
+            Store(BRDF::Phong(Load<FloatN>(&ks[idx]), Load<FloatN>(&exponent[idx]), l, v, n), phong);
+            Store(FastPow(Vector3N<FloatN>::Dot(n, l), Load<FloatN>(&exponent[idx])), fastPow);
+
+            for (int lane{0}; lane < width; ++lane)
+            {
+                const int sampleIdx{idx + lane};
+                const Vector3 sampleN{nx[sampleIdx], ny[sampleIdx], nz[sampleIdx]};
+                const Vector3 sampleL{lx[sampleIdx], ly[sampleIdx], lz[sampleIdx]};
+                const Vector3 sampleV{vx[sampleIdx], vy[sampleIdx], vz[sampleIdx]};
+                const Vector3 sampleH{(sampleV + sampleL) / (sampleV + sampleL).Magnitude()};
+
+                maxErrorGGX = std::max(maxErrorGGX, getError(ggx[lane], BRDF::NormalDistribution_GGX(sampleN, sampleH, roughness[sampleIdx])));
+                maxErrorSmith = std::max(maxErrorSmith, getError(smith[lane], BRDF::GeometryFunction_Smith(sampleN, sampleV, sampleL, roughness[sampleIdx])));
+                maxErrorSchlick = std::max(maxErrorSchlick, getError(schlick[lane], BRDF::FresnelFunction_Schlick(sampleH, sampleV, ColorRGB{f0[sampleIdx]}).r));
+                maxErrorLambert = std::max(maxErrorLambert, getError(lambert[lane], BRDF::Lambert(f0[sampleIdx], ColorRGB{cd[sampleIdx]}).g));
+                maxErrorPhong = std::max(maxErrorPhong, getError(phong[lane], BRDF::Phong(ks[sampleIdx], exponent[sampleIdx], sampleL, sampleV, sampleN).r));
+                maxErrorPow = std::max(maxErrorPow, getError(fastPow[lane], std::pow(Vector3::Dot(sampleN, sampleL), exponent[sampleIdx])));
+            }
+        }
+
+        const auto report{[&](const char* name, float maxError, float tolerance)
+        {
+            const bool isWithinTolerance{maxError <= tolerance};
+            isPassed = isPassed and isWithinTolerance;
+            std::cout << name << " (" << widthName << "): max relative error " << maxError << (isWithinTolerance ? " OK" : " FAILED") << '\n';
+        }};
+        report("GGX", maxErrorGGX, 1e-4f);
+        report("Smith", maxErrorSmith, 1e-4f);
+        report("Schlick", maxErrorSchlick, 1e-4f);
+        report("Lambert", maxErrorLambert, 1e-4f);
+        report("Phong", maxErrorPhong, 1e-4f);
+        report("FastPow", maxErrorPow, 2e-5f);
+    }};
+    testWidth.template operator()<float>("float");
+    testWidth.template operator()<Float4>("Float4");
+    testWidth.template operator()<Float8>("Float8");
+
+    std::cout << (isPassed ? "BRDF TESTS PASSED" : "BRDF TESTS FAILED") << std::endl;
+    return isPassed;
+}
+
+/**
+ * \brief Command line of the headless and benchmark modes, see PrintUsage
+ */
+struct HeadlessOptions
+{
+    int         scene          {4};
+    int         width          {640};
+    int         height         {480};
+    int         frames         {0};
+    int         warmupFrames   {5};
+    uint32_t    threads        {0};
+    int         tileSize       {TileScheduler::DEFAULT_TILE_SIZE};
+    int         aaSubdivisions {0};
+    float       aaThreshold    {0.1f};
+    float       timeStep       {1.0f / 30.0f};
+    std::string output         {"RayTracing_Buffer.ppm"};
+    std::string sequence       {};
+    std::string aov            {};
+    std::string json           {"benchmark.json"};
+};
+
+void PrintUsage()
+{
+    std::cout << "Usage: RayTracer --headless [options]\n"
+        << "       RayTracer --batch [options]\n"
+        << "       RayTracer --benchmark [options]\n"
+        << "       RayTracer --brdf-tests      compares the wide BRDFs with the scalar ones, exit code 1 on failure\n"
+        << "  --scene <1-7>       week scene 1-5, 6 sphere grid, 7 instance grid, headless and batch (default 4)\n"
+        << "  --width <pixels>    (default 640)\n"
+        << "  --height <pixels>   (default 480)\n"
+        << "  --frames <count>    frames to render and time, a still headless scene accumulates one sample per frame\n"
+        << "                      (default 1, benchmark 60)\n"
+        << "  --warmup <count>    benchmark frames rendered before measuring (default 5)\n"
+        << "  --threads <count>   render threads, 0 uses every hardware thread (default 0)\n"
+        << "  --tile-size <size>  edge of the square render tiles (default 16)\n"
+        << "  --aa <n>            adaptive AA, edge pixels get n x n extra samples, 0 turns it off (default 0)\n"
+        << "  --aa-threshold <t>  luminance difference to a neighbour that makes a pixel an edge (default 0.1)\n"
+        << "  --time-step <s>     batch only, simulated seconds between frames, frame n shows time n * step\n"
+        << "                      (default 0.0333)\n"
+        << "  --output <file>     last headless or batch frame, .png, .pfm (HDR) or .ppm (default RayTracing_Buffer.ppm)\n"
+        << "  --sequence <file>   also save every headless or batch frame, frame 7 of out.png is out_0007.png\n"
+        << "  --aov <file>        also save the depth, normal and material index of the last headless or batch frame,\n"
+        << "                      out.pfm gives out_depth.pfm, out_normal.pfm and out_material.pfm\n"
+        << "  --json <file>       benchmark report (default benchmark.json)\n";
+}
+
+bool HasArgument(int argc, char* args[], const std::string& argument)
+{
+    return std::find(args + 1, args + argc, argument) != args + argc;
+}
+
+bool ParseHeadlessOptions(int argc, char* args[], HeadlessOptions& options)
+{
+    for (int idx{1}; idx < argc; ++idx)
+    {
+        const std::string argument{args[idx]};
+        if (argument == "--headless" or argument == "--batch" or argument == "--benchmark") continue;
+        if (idx + 1 >= argc) return false;
+
+        const std::string value{args[++idx]};
+        try
+        {
+            if (argument == "--scene") options.scene = std::stoi(value);
+            else if (argument == "--width") options.width = std::stoi(value);
+            else if (argument == "--height") options.height = std::stoi(value);
+            else if (argument == "--frames") options.frames = std::stoi(value);
+            else if (argument == "--warmup") options.warmupFrames = std::stoi(value);
+            else if (argument == "--threads") options.threads = static_cast<uint32_t>(std::stoul(value));
+            else if (argument == "--tile-size") options.tileSize = std::stoi(value);
+            else if (argument == "--aa") options.aaSubdivisions = std::stoi(value);
+            else if (argument == "--aa-threshold") options.aaThreshold = std::stof(value);
+            else if (argument == "--time-step") options.timeStep = std::stof(value);
+            else if (argument == "--output") options.output = value;
+            else if (argument == "--sequence") options.sequence = value;
+            else if (argument == "--aov") options.aov = value;
+            else if (argument == "--json") options.json = value;
+            else return false;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+    ImageFormat format;
+    return options.scene >= 1 and options.scene <= 7 and options.width > 0 and options.height > 0 and
+        options.frames >= 0 and options.warmupFrames >= 0 and options.aaSubdivisions >= 0 and
+        options.timeStep > 0.0f and ImageWriter::GetFormat(options.output, format) and
+        (options.sequence.empty() or ImageWriter::GetFormat(options.sequence, format)) and
+        (options.aov.empty() or ImageWriter::GetFormat(options.aov, format));
+}
+
+/**
+ * \brief Frame number in front of the extension: out.png becomes out_0007.png
+ */
+std::string GetSequenceFilePath(const std::string& filePath, int frame)
+{
+    std::string number{std::to_string(frame)};
+    number.insert(0, number.size() < 4 ? 4 - number.size() : 0, '0');
+
+    const size_t dotIdx{filePath.find_last_of('.')};
+    if (dotIdx == std::string::npos) return filePath + '_' + number;
+    return filePath.substr(0, dotIdx) + '_' + number + filePath.substr(dotIdx);
+}
+
+Scene* CreateScene(int sceneIdx)
+{
+    switch (sceneIdx)
+    {
+    case 1: return new Scene_W1();
+    case 2: return new Scene_W2();
+    case 3: return new Scene_W3();
+    case 4: return new Scene_W4();
+    case 5: return new Scene_W5();
+    case 6: return new Scene_SphereGrid();
+    default: return new Scene_InstanceGrid();
+    }
+}
+
+/**
+ * \brief Week 4 and the benchmark scenes use the reference renderer, the other weeks their own renderers
+ */
+void RenderScene(Renderer* pRenderer, Scene* pScene, int sceneIdx)
+{
+    if (sceneIdx == 4 or sceneIdx > 5) pRenderer->Render(pScene);
+    else pRenderer->DyanmicRender(pScene);
+}
+
+/**
+ * \brief Frame times of a headless or batch run
+ */
+struct FrameStats
+{
+    int   frameCount {0};
+    float totalMs    {0.0f};
+    float minMs      {FLT_MAX};
+    float maxMs      {0.0f};
+
+    void Add(float frameMs)
+    {
+        ++frameCount;
+        totalMs += frameMs;
+        minMs = std::min(minMs, frameMs);
+        maxMs = std::max(maxMs, frameMs);
+    }
+};
+
+/**
+ * \brief Prints the statistics, waits for the sequence and saves the last frame to options.output
+ * \return exit code of the run
+ */
+int FinishHeadless(const HeadlessOptions& options, const Renderer* pRenderer, const FrameStats& stats)
+{
+    std::cout << "Scene " << options.scene << ", " << options.width << 'x' << options.height << ", "
+        << stats.frameCount << " frame(s), " << pRenderer->GetThreadCount() << " thread(s), "
+        << pRenderer->GetTileSize() << 'x' << pRenderer->GetTileSize() << " tiles\n"
+        << "Frame time (ms): avg " << stats.totalMs / static_cast<float>(stats.frameCount)
+        << ", min " << stats.minMs << ", max " << stats.maxMs << std::endl;
+    if (pRenderer->IsAdaptiveAAEnabled())
+    {
+        const uint32_t pixelCount{static_cast<uint32_t>(options.width * options.height)};
+        std::cout << "Adaptive AA: " << pRenderer->GetAARefinedPixelCount() << " of " << pixelCount << " pixels refined with "
+            << pRenderer->GetAASubdivisions() * pRenderer->GetAASubdivisions() << " extra samples\n";
+    }
+
+    const bool isSequenceSaved{pRenderer->WaitForSavedImages()};
+    if (not isSequenceSaved)
+        std::cout << "Something went wrong. Not every frame of " << options.sequence << " was saved" << std::endl;
+
+    pRenderer->SaveBufferToImage(options.output);
+    const bool isSaved{pRenderer->WaitForSavedImages()};
+    if (isSaved)
+        std::cout << "Image saved to " << options.output << std::endl;
+    else
+        std::cout << "Something went wrong. Image not saved to " << options.output << std::endl;
+
+    bool isAOVSaved{true};
+    if (not options.aov.empty())
+    {
+        isAOVSaved = pRenderer->SaveAOVsToImages(options.aov) and pRenderer->WaitForSavedImages();
+        if (isAOVSaved)
+            std::cout << "AOVs saved next to " << options.aov << std::endl;
+        else
+            std::cout << "Something went wrong. AOVs not saved to " << options.aov << std::endl;
+    }
+
+    return isSaved and isSequenceSaved and isAOVSaved ? 0 : 1;
+}
+
+void ApplyRenderOptions(Renderer* pRenderer, const HeadlessOptions& options)
+{
+    pRenderer->SetThreadCount(options.threads);
+    pRenderer->SetTileSize(options.tileSize);
+    pRenderer->SetAdaptiveAA(options.aaSubdivisions > 0);
+    pRenderer->SetAASubdivisions(options.aaSubdivisions);
+    pRenderer->SetAAContrastThreshold(options.aaThreshold);
+}
+
+/**
+ * \brief Renders into the in-memory framebuffer only: no window, no event loop and no camera input
+ */
+int RunHeadless(const HeadlessOptions& options)
+{
+    const auto pTimer = new Timer();
+    const auto pRenderer = new Renderer(options.width, options.height);
+    ApplyRenderOptions(pRenderer, options);
+
+    const auto pScene = CreateScene(options.scene);
+    pScene->Initialize();
+    pScene->GetCamera().SetInputEnabled(false);
+
+    pTimer->Start();
+
+    FrameStats stats{};
+    const int frameCount{std::max(1, options.frames)};
+    for (int frame{0}; frame < frameCount; ++frame)
+    {
+        pScene->Update(pTimer);
+
+        const auto start{std::chrono::steady_clock::now()};
+        RenderScene(pRenderer, pScene, options.scene);
+        const auto end{std::chrono::steady_clock::now()};
+        stats.Add(std::chrono::duration<float, std::milli>(end - start).count());
+
+        //Only copies the frame, the encoding overlaps with the next frames
+        if (not options.sequence.empty()) pRenderer->SaveBufferToImage(GetSequenceFilePath(options.sequence, frame));
+
+        pTimer->Update();
+    }
+    pTimer->Stop();
+
+    const int exitCode{FinishHeadless(options, pRenderer, stats)};
+
+    delete pScene;
+    delete pRenderer;
+    delete pTimer;
+    return exitCode;
+}
+
+/**
+ * \brief One stage of the batch pipeline: a copy of the scene with its own simulated clock
+ */
+struct BatchSlot
+{
+    Scene* pScene {nullptr};
+    Timer  timer  {};
+    int    frame  {0};
+};
+
+/**
+ * \brief Animates the slot to the given frame and refits its acceleration structures \n
+ * The clock always takes one fixed step per frame, so frame n gets the same time on every slot and every run
+ */
+void UpdateBatchSlot(BatchSlot& slot, int frame)
+{
+    for (; slot.frame < frame; ++slot.frame)
+    {
+        slot.timer.Update();
+    }
+    slot.pScene->Update(&slot.timer);
+}
+
+/**
+ * \brief Renders frames 0..N-1 at a fixed simulated time step, the output does not depend on the speed of the machine \n
+ * Two copies of the scene take turns: while frame n is traced on one, the other is animated to frame n + 1 \n
+ * The accumulation is off, every frame is rendered from scratch and the same on every run
+ */
+int RunBatch(const HeadlessOptions& options)
+{
+    const auto pRenderer = new Renderer(options.width, options.height);
+    ApplyRenderOptions(pRenderer, options);
+    pRenderer->SetAccumulation(false);
+
+    const int frameCount{std::max(1, options.frames)};
+
+    //A single frame has nothing to overlap with, the second copy would only cost loading time
+    constexpr int maxSlotCount{2};
+    const int slotCount{std::min(frameCount, maxSlotCount)};
+    BatchSlot slots[maxSlotCount]{};
+    for (int slotIdx{0}; slotIdx < slotCount; ++slotIdx)
+    {
+        BatchSlot& slot{slots[slotIdx]};
+        slot.pScene = CreateScene(options.scene);
+        slot.pScene->Initialize();
+        slot.pScene->GetCamera().SetInputEnabled(false);
+        slot.timer.SetFixedTimeStep(options.timeStep);
+        slot.timer.Start();
+    }
+
+    const auto batchStart{std::chrono::steady_clock::now()};
+    UpdateBatchSlot(slots[0], 0);
+
+    FrameStats stats{};
+    for (int frame{0}; frame < frameCount; ++frame)
+    {
+        BatchSlot& slot{slots[frame % slotCount]};
+
+        //The render threads trace this slot, the other one is animated next to them
+        std::future<void> nextFrame{};
+        if (frame + 1 < frameCount)
+        {
+            BatchSlot& nextSlot{slots[(frame + 1) % slotCount]};
+            nextFrame = std::async(std::launch::async, UpdateBatchSlot, std::ref(nextSlot), frame + 1);
+        }
+
+        const auto start{std::chrono::steady_clock::now()};
+        RenderScene(pRenderer, slot.pScene, options.scene);
+        const auto end{std::chrono::steady_clock::now()};
+        stats.Add(std::chrono::duration<float, std::milli>(end - start).count());
+
+        //Only copies the frame, the encoding overlaps with the next frames
+        if (not options.sequence.empty()) pRenderer->SaveBufferToImage(GetSequenceFilePath(options.sequence, frame));
+
+        if (nextFrame.valid()) nextFrame.get();
+    }
+    const auto batchEnd{std::chrono::steady_clock::now()};
+
+    const float batchSeconds{std::chrono::duration<float>(batchEnd - batchStart).count()};
+    std::cout << "Batch: " << frameCount << " frame(s) in " << batchSeconds << " s, "
+        << static_cast<float>(frameCount) / batchSeconds << " frames/s, time step " << options.timeStep << " s\n";
+
+    const int exitCode{FinishHeadless(options, pRenderer, stats)};
+
+    for (int slotIdx{0}; slotIdx < slotCount; ++slotIdx)
+    {
+        delete slots[slotIdx].pScene;
+    }
+    delete pRenderer;
+    return exitCode;
+}
+
+int RunBenchmark(const HeadlessOptions& options)
+{
+    BenchmarkSettings settings{};
+    settings.width = options.width;
+    settings.height = options.height;
+    if (options.frames > 0) settings.frames = options.frames;
+    settings.warmupFrames = options.warmupFrames;
+    settings.threads = options.threads;
+    settings.tileSize = options.tileSize;
+    settings.jsonPath = options.json;
+
+    Benchmark benchmark{settings};
+    return benchmark.Run() ? 0 : 1;
+}
+
 int main(int argc, char* args[])
 {
-    //Unreferenced parameters
-    (void)argc;
-    (void)args;
+    const bool isHeadless{HasArgument(argc, args, "--headless")};
+    const bool isBatch{HasArgument(argc, args, "--batch")};
+    const bool isBenchmark{HasArgument(argc, args, "--benchmark")};
+    if (isHeadless or isBatch or isBenchmark)
+    {
+        HeadlessOptions options{};
+        if (not ParseHeadlessOptions(argc, args, options))
+        {
+            PrintUsage();
+            return 1;
+        }
+        if (isBenchmark) return RunBenchmark(options);
+        return isBatch ? RunBatch(options) : RunHeadless(options);
+    }
 
     // Test cases
     // DoVectorTests();
+    if (HasArgument(argc, args, "--brdf-tests")) return DoBRDFTests() ? 0 : 1;
 
     //Create window + surfaces
     SDL_Init(SDL_INIT_VIDEO);
@@ -95,6 +583,10 @@ int main(int argc, char* args[])
     float printTimer = 0.f;
     bool isLooping = true;
     bool takeScreenshot = false;
+    bool takeHDRScreenshot = false;
+    bool takeAOVScreenshot = false;
+    bool isRecording = false;
+    int recordedFrame = 0;
     while (isLooping)
     {
         //--------- Get input events ---------
@@ -109,12 +601,27 @@ int main(int argc, char* args[])
             case SDL_KEYUP:
                 if (e.key.keysym.scancode == SDL_SCANCODE_X)
                     takeScreenshot = true;
+                if (e.key.keysym.scancode == SDL_SCANCODE_H)
+                    takeHDRScreenshot = true;
+                if (e.key.keysym.scancode == SDL_SCANCODE_G)
+                    takeAOVScreenshot = true;
                 if (e.key.keysym.scancode == SDL_SCANCODE_F2)
                     pRenderer->ToggleShadow();
                 if (e.key.keysym.scancode == SDL_SCANCODE_F3)
                     pRenderer->SwitchLightingMode();
+                if (e.key.keysym.scancode == SDL_SCANCODE_F4)
+                    pRenderer->TogglePacketTracing();
+                if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+                    pRenderer->ToggleAccumulation();
                 if (e.key.keysym.scancode == SDL_SCANCODE_F6)
                     pTimer->StartBenchmark();
+                if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+                    pRenderer->ToggleAdaptiveAA();
+                if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+                {
+                    isRecording = not isRecording;
+                    std::cout << "RECORDING: " << (isRecording ? "ON" : "OFF") << std::endl;
+                }
                 if (e.key.keysym.scancode == SDL_SCANCODE_E)
                     pScene->GetCamera().IncreaseFOV();
                 if (e.key.keysym.scancode == SDL_SCANCODE_Q)
@@ -145,15 +652,31 @@ int main(int argc, char* args[])
             std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
         }
 
-        //Save screenshot after full render
+        //Save screenshot after full render, the image writer encodes it while the next frames render
         if (takeScreenshot)
         {
-            if (!pRenderer->SaveBufferToImage())
-                std::cout << "Screenshot saved!" << std::endl;
-            else
-                std::cout << "Something went wrong. Screenshot not saved!" << std::endl;
+            if (pRenderer->SaveBufferToImage("RayTracing_Buffer.png"))
+                std::cout << "Saving screenshot to RayTracing_Buffer.png" << std::endl;
             takeScreenshot = false;
         }
+        if (takeHDRScreenshot)
+        {
+            if (pRenderer->SaveBufferToImage("RayTracing_Buffer.pfm"))
+                std::cout << "Saving HDR screenshot to RayTracing_Buffer.pfm" << std::endl;
+            takeHDRScreenshot = false;
+        }
+        if (takeAOVScreenshot)
+        {
+            if (pRenderer->SaveAOVsToImages("RayTracing_AOV.png"))
+                std::cout << "Saving depth, normal and material AOVs to RayTracing_AOV_*.png" << std::endl;
+            else
+                std::cout << "Something went wrong. This frame has no G-buffer to save" << std::endl;
+            takeAOVScreenshot = false;
+        }
+        if (isRecording)
+        {
+            pRenderer->SaveBufferToImage(GetSequenceFilePath("RayTracing_Sequence.png", recordedFrame++));
+        }
     }
     pTimer->Stop();
 